@@ -5,125 +5,109 @@
 //               such as pan/tilt/roll/dolly/etc.
 // Version :     2-01-00 1.00 Initial implementation.
 //               2-03-03 1.01 Version not dependent on CGrPoint and CGrTransform.
+//               10-19-26 2.00 Float storage, quaternion camera frame and
+//                             closed-form rotations, cached view matrix,
+//                             no GLU dependency.
 // Author :      Charles B. Owen
 //
 
 #include <cmath>
 #include "GrCamera.h"
 
-const double GR_PI = 3.1415926535897932384626433832795;
-const double GR_PI2 = 2. * GR_PI;
-const double GR_RTOD = 180. / GR_PI;      // Converts radians to degrees
-const double GR_DTOR = GR_PI / 180.;      // Converts degrees to radians
+const float GR_PI = 3.1415926535897932384626433832795f;
+const float GR_DTOR = GR_PI / 180.f;      // Converts degrees to radians
 
 
 // Some linear algebra helper routines
 inline void 
-_Subtract(const double *a, const double *b, double *c) {
+_Subtract(const float *a, const float *b, float *c) {
   c[0] = a[0] - b[0];
   c[1] = a[1] - b[1];
   c[2] = a[2] - b[2];
 }
 
 
-inline double 
-_Length(const double *a) {
-  return sqrt(a[0]*a[0] + a[1]*a[1] + a[2]*a[2]);
+inline float 
+_Dot(const float *a, const float *b) {
+  return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+}
+
+
+inline float 
+_Length(const float *a) {
+  return std::sqrt(_Dot(a, a));
 }
 
 
 inline void 
-_Normalize(double *a) {
-  double len = _Length(a);
+_Normalize(float *a) {
+  float len = _Length(a);
   a[0] /= len;        a[1] /= len;        a[2] /= len;
 }
 
 
 inline void 
-_Cross(const double *a, const double *b, double *c) {
+_Cross(const float *a, const float *b, float *c) {
   c[0] = a[1]*b[2] - a[2]*b[1];
   c[1] = a[2]*b[0] - a[0]*b[2];
   c[2] = a[0]*b[1] - a[1]*b[0];
 }
 
 
+//
+// Name :         _RotateVector()
+// Description :  Rotates v by the unit quaternion (w, u) in closed form:
+//                v' = v + 2w (u x v) + 2 u x (u x v).
+//
 inline void 
-_Identity(double t[4][4]) {
-  for(int i=0;  i<4;  i++)
-    for(int j=0;  j<4;  j++)
-      t[i][j] = i == j ? 1. : 0.;
-}
-
-
-inline void 
-_Translate(double t[4][4], double x, double y, double z) {
-  _Identity(t);
-  t[0][3] = x;        t[1][3] = y;        t[2][3] = z;
-}
-
-
-inline void 
-_RotateX(double m[4][4], double r) {
-  double rr = r * GR_DTOR;
-  double cr = cos(rr);
-  double sr = sin(rr);
-
-  m[0][0] = 1;  m[0][1] = 0;  m[0][2] = 0;  m[0][3] = 0;
-  m[1][0] = 0;  m[1][1] = cr;  m[1][2] = -sr;  m[1][3] = 0;
-  m[2][0] = 0;  m[2][1] = sr;  m[2][2] = cr;  m[2][3] = 0;
-  m[3][0] = 0;  m[3][1] = 0;  m[3][2] = 0;  m[3][3] = 1;
-}
-
-
-inline void 
-_RotateY(double m[4][4], double r) {
-  double rr = r * GR_DTOR;
-  double cr = cos(rr);
-  double sr = sin(rr);
-
-  m[0][0] = cr;  m[0][1] = 0;  m[0][2] = sr;  m[0][3] = 0;
-  m[1][0] = 0;  m[1][1] = 1;  m[1][2] = 0;  m[1][3] = 0;
-  m[2][0] = -sr;  m[2][1] = 0;  m[2][2] = cr;  m[2][3] = 0;
-  m[3][0] = 0;  m[3][1] = 0;  m[3][2] = 0;  m[3][3] = 1;
-}
-
-
-inline void 
-_RotateZ(double m[4][4], double r) {
-  double rr = r * GR_DTOR;
-  double cr = cos(rr);
-  double sr = sin(rr);
-
-  m[0][0] = cr;  m[0][1] = -sr;  m[0][2] = 0;  m[0][3] = 0;
-  m[1][0] = sr;  m[1][1] = cr;  m[1][2] = 0;  m[1][3] = 0;
-  m[2][0] = 0;  m[2][1] = 0;  m[2][2] = 1;  m[2][3] = 0;
-  m[3][0] = 0;  m[3][1] = 0;  m[3][2] = 0;  m[3][3] = 1;
-}
-
-
-inline void 
-_Multiply(double a[4][4], double b[4][4], double res[4][4]) {
-  for(int r=0;  r<4;  r++)
-    for(int c=0;  c<4;  c++) {
-      res[r][c] = a[r][0] * b[0][c] + a[r][1] * b[1][c] + a[r][2] * b[2][c] + a[r][3] * b[3][c];
-    }
-}
-
-
-inline void 
-_Multiply(double a[4][4], double b[4][4], double c[4][4], double res[4][4]) {
-  double i[4][4];
-  _Multiply(a, b, i);
-  _Multiply(i, c, res);
+_RotateVector(float w, const float *u, float *v) {
+  float t[3];
+  _Cross(u, v, t);
+  t[0] += t[0];       t[1] += t[1];       t[2] += t[2];
+  float c[3];
+  _Cross(u, t, c);
+  v[0] += w * t[0] + c[0];
+  v[1] += w * t[1] + c[1];
+  v[2] += w * t[2] + c[2];
 }
 
 
+//
+// Name :         _FrameToQuaternion()
+// Description :  Unit quaternion of the rotation whose matrix columns
+//                are the orthonormal axes x, y and z.
+//
 inline void 
-_MultiplyPoint(double m[4][4], double p[3]) {
-  double x=p[0];      double y=p[1];      double z=p[2];
-  p[0] = m[0][0] * x + m[0][1] * y + m[0][2] * z + m[0][3];
-  p[1] = m[1][0] * x + m[1][1] * y + m[1][2] * z + m[1][3];
-  p[2] = m[2][0] * x + m[2][1] * y + m[2][2] * z + m[2][3];
+_FrameToQuaternion(const float *x, const float *y, const float *z, float *q) {
+  float trace = x[0] + y[1] + z[2];
+  if(trace > 0) {
+    float s = 0.5f / std::sqrt(trace + 1.f);
+    q[0] = 0.25f / s;
+    q[1] = (y[2] - z[1]) * s;
+    q[2] = (z[0] - x[2]) * s;
+    q[3] = (x[1] - y[0]) * s;
+  }
+  else if(x[0] > y[1] && x[0] > z[2]) {
+    float s = 2.f * std::sqrt(1.f + x[0] - y[1] - z[2]);
+    q[0] = (y[2] - z[1]) / s;
+    q[1] = 0.25f * s;
+    q[2] = (y[0] + x[1]) / s;
+    q[3] = (z[0] + x[2]) / s;
+  }
+  else if(y[1] > z[2]) {
+    float s = 2.f * std::sqrt(1.f + y[1] - x[0] - z[2]);
+    q[0] = (z[0] - x[2]) / s;
+    q[1] = (y[0] + x[1]) / s;
+    q[2] = 0.25f * s;
+    q[3] = (z[1] + y[2]) / s;
+  }
+  else {
+    float s = 2.f * std::sqrt(1.f + z[2] - x[0] - y[1]);
+    q[0] = (x[1] - y[0]) / s;
+    q[1] = (z[0] + x[2]) / s;
+    q[2] = (z[1] + y[2]) / s;
+    q[3] = 0.25f * s;
+  }
 }
 
 
@@ -133,9 +117,10 @@ _MultiplyPoint(double m[4][4], double p[3]) {
 
 CGrCamera::CGrCamera() {
   m_mousemode = PITCHYAW;
+  m_mousex = m_mousey = 0;
   m_gravity = true;
   Set(0, 0, 30, 0, 0, 0, 0, 1, 0);
-  FieldOfView(70.);
+  FieldOfView(70.f);
 }
 
 
@@ -144,7 +129,7 @@ CGrCamera::~CGrCamera() {
 
 
 void 
-CGrCamera::Set(double p_eyex, double p_eyey, double p_eyez, double p_centerx, double p_centery, double p_centerz, double p_upx, double p_upy, double p_upz) {
+CGrCamera::Set(float p_eyex, float p_eyey, float p_eyez, float p_centerx, float p_centery, float p_centerz, float p_upx, float p_upy, float p_upz) {
   m_eye[0] = p_eyex;              m_eye[1] = p_eyey;              m_eye[2] = p_eyez;
   m_center[0] = p_centerx;        m_center[1] = p_centery;        m_center[2] = p_centerz;
   m_up[0] = p_upx;                m_up[1] = p_upy;                m_up[2] = p_upz;
@@ -154,7 +139,7 @@ CGrCamera::Set(double p_eyex, double p_eyey, double p_eyez, double p_centerx, do
 
 
 void 
-CGrCamera::Set3dv(const double *p_eye, const double *p_center, const double *p_up) {
+CGrCamera::Set3dv(const float *p_eye, const float *p_center, const float *p_up) {
   m_eye[0] = p_eye[0];       m_eye[1] = p_eye[1];       m_eye[2] = p_eye[2];
   m_center[0] = p_center[0]; m_center[1] = p_center[1]; m_center[2] = p_center[2];
   m_up[0] = p_up[0];         m_up[1] = p_up[1];         m_up[2] = p_up[2];
@@ -165,8 +150,11 @@ CGrCamera::Set3dv(const double *p_eye, const double *p_center, const double *p_u
 
 //
 // Name :         CGrCamera::ComputeFrame()
-// Description :  We maintain variables that describe the X,Y,Z axis of 
-//                the camera frame.  This function computes those values.
+// Description :  We maintain a quaternion that describes the X,Y,Z axis
+//                of the camera frame.  This function computes it from
+//                the eye, center and up vectors.  The incremental
+//                rotations update it directly and only come back here
+//                when gravity has to pull the up direction back.
 //
 void 
 CGrCamera::ComputeFrame() {
@@ -174,81 +162,113 @@ CGrCamera::ComputeFrame() {
     m_up[0] = 0;        m_up[1] = 1;        m_up[2] = 0;
   }
 
-  _Subtract(m_eye, m_center, m_cameraz);
-  _Normalize(m_cameraz);
-  _Cross(m_cameraz, m_up, m_camerax);
-  _Normalize(m_camerax);
-  _Cross(m_cameraz, m_camerax, m_cameray);
+  float x[3], y[3], z[3];
+  _Subtract(m_eye, m_center, z);
+  _Normalize(z);
+  _Cross(z, m_up, x);
+  _Normalize(x);
+  _Cross(z, x, y);
+  _FrameToQuaternion(x, y, z, m_orientation);
+  m_viewdirty = true;
 }
 
 
 //
-// Camera rotation operations.  These function rotate the camera
-// around the eye position.
+// Name :         CGrCamera::Frame()
+// Description :  The camera X, Y and Z axes, that is the columns of the
+//                rotation matrix of the frame quaternion.  Any of the
+//                outputs can be null.
 //
 void 
-CGrCamera::Pan(double d) {
-  double ucen[4][4];
-  _Translate(ucen, m_eye[0], m_eye[1], m_eye[2]);
-
-  double rot[4][4];
-  RotCameraY(rot, d);
-
-  double cen[4][4];
-  _Translate(cen, -m_eye[0], -m_eye[1], -m_eye[2]);
-
-  double t[4][4];
-
-  _Multiply(ucen, rot, cen, t);
-
-  _MultiplyPoint(t, m_center);
-  _MultiplyPoint(t, m_up);
-
-  ComputeFrame();
+CGrCamera::Frame(float *x, float *y, float *z) const {
+  const float w = m_orientation[0];
+  const float qx = m_orientation[1];
+  const float qy = m_orientation[2];
+  const float qz = m_orientation[3];
+
+  if(x) {
+    x[0] = 1.f - 2.f * (qy*qy + qz*qz);
+    x[1] = 2.f * (qx*qy + w*qz);
+    x[2] = 2.f * (qx*qz - w*qy);
+  }
+  if(y) {
+    y[0] = 2.f * (qx*qy - w*qz);
+    y[1] = 1.f - 2.f * (qx*qx + qz*qz);
+    y[2] = 2.f * (qy*qz + w*qx);
+  }
+  if(z) {
+    z[0] = 2.f * (qx*qz + w*qy);
+    z[1] = 2.f * (qy*qz - w*qx);
+    z[2] = 1.f - 2.f * (qx*qx + qy*qy);
+  }
 }
 
 
+//
+// Name :         CGrCamera::Rotate()
+// Description :  Rotates point and the up direction by d degrees around
+//                the camera axis (0 = X, 1 = Y, 2 = Z) through pivot.
+//                The frame follows by composing the same rotation,
+//                expressed in camera coordinates, on the right.
+//
 void 
-CGrCamera::Tilt(double d) {
-  double ucen[4][4];
-  _Translate(ucen, m_eye[0], m_eye[1], m_eye[2]);
-
-  double rot[4][4];
-  RotCameraX(rot, d);
-
-  double cen[4][4];
-  _Translate(cen, -m_eye[0], -m_eye[1], -m_eye[2]);
+CGrCamera::Rotate(int axis, float d, const float *pivot, float *point) {
+  const float half = 0.5f * d * GR_DTOR;
+  const float c = std::cos(half);
+  const float s = std::sin(half);
+
+  float u[3];
+  Frame(axis == 0 ? u : 0, axis == 1 ? u : 0, axis == 2 ? u : 0);
+  u[0] *= s;          u[1] *= s;          u[2] *= s;
+
+  float v[3];
+  _Subtract(point, pivot, v);
+  _RotateVector(c, u, v);
+  point[0] = pivot[0] + v[0];
+  point[1] = pivot[1] + v[1];
+  point[2] = pivot[2] + v[2];
 
-  double t[4][4];
+  if(m_gravity) {
+    ComputeFrame();
+    return;
+  }
 
-  _Multiply(ucen, rot, cen, t);
+  _RotateVector(c, u, m_up);
 
-  _MultiplyPoint(t, m_center);
-  _MultiplyPoint(t, m_up);
+  float *q = m_orientation;
+  float l[4] = {c, 0, 0, 0};
+  l[1 + axis] = s;
+  float r[4];
+  r[0] = q[0]*l[0] - q[1]*l[1] - q[2]*l[2] - q[3]*l[3];
+  r[1] = q[0]*l[1] + q[1]*l[0] + q[2]*l[3] - q[3]*l[2];
+  r[2] = q[0]*l[2] - q[1]*l[3] + q[2]*l[0] + q[3]*l[1];
+  r[3] = q[0]*l[3] + q[1]*l[2] - q[2]*l[1] + q[3]*l[0];
+  float n = 1.f / std::sqrt(r[0]*r[0] + r[1]*r[1] + r[2]*r[2] + r[3]*r[3]);
+  q[0] = r[0] * n;    q[1] = r[1] * n;    q[2] = r[2] * n;    q[3] = r[3] * n;
 
-  ComputeFrame();
+  m_viewdirty = true;
 }
 
 
+//
+// Camera rotation operations.  These function rotate the camera
+// around the eye position.
+//
 void 
-CGrCamera::Roll(double d) {
-  double ucen[4][4];
-  _Translate(ucen, m_eye[0], m_eye[1], m_eye[2]);
-
-  double rot[4][4];
-  RotCameraZ(rot, d);
-
-  double cen[4][4];
-  _Translate(cen, -m_eye[0], -m_eye[1], -m_eye[2]);
+CGrCamera::Pan(float d) {
+  Rotate(1, d, m_eye, m_center);
+}
 
-  double t[4][4];
 
-  _Multiply(ucen, rot, cen, t);
+void 
+CGrCamera::Tilt(float d) {
+  Rotate(0, d, m_eye, m_center);
+}
 
-  _MultiplyPoint(t, m_center);
-  _MultiplyPoint(t, m_up);
 
-  ComputeFrame();
+void 
+CGrCamera::Roll(float d) {
+  Rotate(2, d, m_eye, m_center);
 }
 
 
@@ -258,46 +278,14 @@ CGrCamera::Roll(double d) {
 // be the same thing.  So, we only need Yaw and Pitch.
 //
 void 
-CGrCamera::Yaw(double d) {
-  double ucen[4][4];
-  _Translate(ucen, m_center[0], m_center[1], m_center[2]);
-
-  double rot[4][4];
-  RotCameraY(rot, d);
-
-  double cen[4][4];
-  _Translate(cen, -m_center[0], -m_center[1], -m_center[2]);
-
-  double b[4][4];
-
-  _Multiply(ucen, rot, cen, b);
-
-  _MultiplyPoint(b, m_eye);
-  _MultiplyPoint(b, m_up);
-
-  ComputeFrame();
+CGrCamera::Yaw(float d) {
+  Rotate(1, d, m_center, m_eye);
 }
 
 
 void 
-CGrCamera::Pitch(double d) {
-  double ucen[4][4];
-  _Translate(ucen, m_center[0], m_center[1], m_center[2]);
-
-  double rot[4][4];
-  RotCameraX(rot, d);
-
-  double cen[4][4];
-  _Translate(cen, -m_center[0], -m_center[1], -m_center[2]);
-
-  double a[4][4];
-
-  _Multiply(ucen, rot, cen, a);
-
-  _MultiplyPoint(a, m_eye);
-  _MultiplyPoint(a, m_up);
-
-  ComputeFrame();
+CGrCamera::Pitch(float d) {
+  Rotate(0, d, m_center, m_eye);
 }
 
 
@@ -307,70 +295,61 @@ CGrCamera::Pitch(double d) {
 //                This function moves the camera and center together.
 //
 void 
-CGrCamera::Dolly(double x, double y, double z) {
-  double t[4][4];
-  DollyHelper(t, x, y, z);
-
-  _MultiplyPoint(t, m_center);
-  _MultiplyPoint(t, m_eye);
+CGrCamera::Dolly(float x, float y, float z) {
+  float fx[3], fy[3], fz[3];
+  Frame(fx, fy, fz);
+  for(int i=0;  i<3;  i++) {
+    float t = x * fx[i] + y * fy[i] + z * fz[i];
+    m_center[i] += t;
+    m_eye[i] += t;
+  }
 
   // Frame does not change...
+  m_viewdirty = true;
 }
 
 
 void 
-CGrCamera::DollyCamera(double x, double y, double z) {
-  double t[4][4];
-  DollyHelper(t, x, y, z);
-
-  _MultiplyPoint(t, m_eye);
+CGrCamera::DollyCamera(float x, float y, float z) {
+  float fx[3], fy[3], fz[3];
+  Frame(fx, fy, fz);
+  for(int i=0;  i<3;  i++)
+    m_eye[i] += x * fx[i] + y * fy[i] + z * fz[i];
   ComputeFrame();
 }
 
 
 void 
-CGrCamera::DollyCenter(double x, double y, double z) {
-  double t[4][4];
-  DollyHelper(t, x, y, z);
-
-  _MultiplyPoint(t, m_center);
+CGrCamera::DollyCenter(float x, float y, float z) {
+  float fx[3], fy[3], fz[3];
+  Frame(fx, fy, fz);
+  for(int i=0;  i<3;  i++)
+    m_center[i] += x * fx[i] + y * fy[i] + z * fz[i];
   ComputeFrame();
 }
 
 
-void 
-CGrCamera::DollyHelper(double m[4][4], double x, double y, double z) {
-  double uncam[4][4];
-  UnRotCamera(uncam);
-  double tran[4][4];
-  _Translate(tran, x, y, z);
-  double tocam[4][4];
-  RotCamera(tocam);
-
-  _Multiply(uncam, tran, tocam, m);
-}
-
-
 void 
 CGrCamera::MouseMove(int x, int y) {
   switch(m_mousemode) {
     case PANTILT:
-      Pan((x - m_mousex) * -0.1);
-      Tilt((y - m_mousey) * -0.1);
+      Pan((x - m_mousex) * -0.1f);
+      Tilt((y - m_mousey) * -0.1f);
       break;
 
     case ROLLMOVE:
-      Roll((x - m_mousex) * 0.1);
-      DollyCamera(0, 0, 0.01*(y-m_mousey));
+      if(x != m_mousex)
+        Roll((x - m_mousex) * 0.1f);
+      DollyCamera(0, 0, 0.01f*(y-m_mousey));
       break;
 
     case DOLLYXY:
-      DollyCamera(0.01*(x - m_mousex), 0.01*(y - m_mousey), 0);
+      DollyCamera(0.01f*(x - m_mousex), 0.01f*(y - m_mousey), 0);
       break;
 
     case PITCHYAW:
-      Yaw((x - m_mousex) * 0.8);  // GS Changed Movement Sign
-      Pitch((y - m_mousey) * 0.8);// GS Changed Movement Sign
+      Yaw((x - m_mousex) * 0.8f);  // GS Changed Movement Sign
+      Pitch((y - m_mousey) * 0.8f);// GS Changed Movement Sign
       break;
 
     default:
@@ -404,66 +383,34 @@ CGrCamera::Gravity(bool p_gravity) {
 // Name :         CGrCamera::CameraDistance()
 // Description :  Returns the distance from the camera to the center
 //
-double 
-CGrCamera::CameraDistance() {
-  double view[3];
+float 
+CGrCamera::CameraDistance() const {
+  float view[3];
   _Subtract(m_eye, m_center, view);
   return _Length(view);
 }
 
 
-inline void 
-CGrCamera::RotCamera(double m[4][4]) {
-  _Identity(m);
-  m[0][0] = m_camerax[0];     m[0][1] = m_camerax[1];     m[0][2] = m_camerax[2];
-  m[1][0] = m_cameray[0];     m[1][1] = m_cameray[1];     m[1][2] = m_cameray[2];
-  m[2][0] = m_cameraz[0];     m[2][1] = m_cameraz[1];     m[2][2] = m_cameraz[2];
-}
-
-
-inline void 
-CGrCamera::UnRotCamera(double m[4][4]) {
-  _Identity(m);
-  m[0][0] = m_camerax[0];     m[1][0] = m_camerax[1];     m[2][0] = m_camerax[2];
-  m[0][1] = m_cameray[0];     m[1][1] = m_cameray[1];     m[2][1] = m_cameray[2];
-  m[0][2] = m_cameraz[0];     m[1][2] = m_cameraz[1];     m[2][2] = m_cameraz[2];
-}
-
-
-void 
-CGrCamera::RotCameraX(double m[4][4], double a) {
-  double uncam[4][4];
-  UnRotCamera(uncam);
-  double rot[4][4];
-  _RotateX(rot, a);
-  double tocam[4][4];
-  RotCamera(tocam);
-
-  _Multiply(uncam, rot, tocam, m);
-}
-
-
-void 
-CGrCamera::RotCameraY(double m[4][4], double a) {
-  double uncam[4][4];
-  UnRotCamera(uncam);
-  double rot[4][4];
-  _RotateY(rot, a);
-  double tocam[4][4];
-  RotCamera(tocam);
-
-  _Multiply(uncam, rot, tocam, m);
-}
-
-
-void 
-CGrCamera::RotCameraZ(double m[4][4], double a) {
-  double uncam[4][4];
-  UnRotCamera(uncam);
-  double rot[4][4];
-  _RotateZ(rot, a);
-  double tocam[4][4];
-  RotCamera(tocam);
-
-  _Multiply(uncam, rot, tocam, m);
+//
+// Name :         CGrCamera::ViewMatrix()
+// Description :  The gluLookAt() matrix.  Its rows are the side, up and
+//                backward directions, which are -X, -Y and Z of the
+//                camera frame, followed by the translation to the eye.
+//
+const float *
+CGrCamera::ViewMatrix() const {
+  if(!m_viewdirty)
+    return m_view;
+
+  float x[3], y[3], z[3];
+  Frame(x, y, z);
+
+  float *m = m_view;
+  m[0] = -x[0];  m[4] = -x[1];  m[8]  = -x[2];  m[12] =  _Dot(x, m_eye);
+  m[1] = -y[0];  m[5] = -y[1];  m[9]  = -y[2];  m[13] =  _Dot(y, m_eye);
+  m[2] =  z[0];  m[6] =  z[1];  m[10] =  z[2];  m[14] = -_Dot(z, m_eye);
+  m[3] = 0;      m[7] = 0;      m[11] = 0;      m[15] = 1;
+
+  m_viewdirty = false;
+  return m_view;
 }
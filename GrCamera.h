@@ -9,51 +9,50 @@
 #pragma once
 #endif // _MSC_VER > 1000
 
-#include <GL/glu.h>
-
 class CGrCamera  
 {
 public:
 	CGrCamera();
 	virtual ~CGrCamera();
 
-	double CameraDistance();
+	float CameraDistance() const;
 	void Gravity(bool p_gravity);
-	void DollyCenter(double x, double y, double z);
-	void DollyCamera(double x, double y, double z);
-	void Dolly(double x, double y, double z);
-	void Pitch(double d);
-	void Yaw(double d);
-	void Roll(double d);
-	void Tilt(double d);
-	void Pan(double d);
-	void Set3dv(const double *p_eye, const double *p_center, const double *p_up);
-	void Set(double p_eyex, double p_eyey, double p_eyez, double p_cenx, double p_ceny, double p_cenz, double p_upx, double p_upy, double p_upz);
-
-  void FieldOfView(double f) {m_fieldofview = f;}
-  double FieldOfView() const {return m_fieldofview;}
-
-  const double *Eye() const {return m_eye;}
-  const double *Center() const {return m_center;}
-  const double *Up() const {return m_up;}
-
-  double EyeX() const {return m_eye[0];}
-  double EyeY() const {return m_eye[1];}
-  double EyeZ() const {return m_eye[2];}
-  double CenterX() const {return m_center[0];}
-  double CenterY() const {return m_center[1];}
-  double CenterZ() const {return m_center[2];}
-  double UpX() const {return m_up[0];}
-  double UpY() const {return m_up[1];}
-  double UpZ() const {return m_up[2];}
-
-#if 0
-  const CGrPoint ViewNormal() const {return Normalize3(m_center - m_eye);}
-  const CGrPoint &CameraNormal() const {return m_camerax;}
-  const CGrPoint &FrameX() const {return m_camerax;}
-  const CGrPoint &FrameY() const {return m_cameray;}
-  const CGrPoint &FrameZ() const {return m_cameraz;}
-#endif
+	void DollyCenter(float x, float y, float z);
+	void DollyCamera(float x, float y, float z);
+	void Dolly(float x, float y, float z);
+	void Pitch(float d);
+	void Yaw(float d);
+	void Roll(float d);
+	void Tilt(float d);
+	void Pan(float d);
+	void Set3dv(const float *p_eye, const float *p_center, const float *p_up);
+	void Set(float p_eyex, float p_eyey, float p_eyez, float p_cenx, float p_ceny, float p_cenz, float p_upx, float p_upy, float p_upz);
+
+  void FieldOfView(float f) {m_fieldofview = f;}
+  float FieldOfView() const {return m_fieldofview;}
+
+  const float *Eye() const {return m_eye;}
+  const float *Center() const {return m_center;}
+  const float *Up() const {return m_up;}
+
+  float EyeX() const {return m_eye[0];}
+  float EyeY() const {return m_eye[1];}
+  float EyeZ() const {return m_eye[2];}
+  float CenterX() const {return m_center[0];}
+  float CenterY() const {return m_center[1];}
+  float CenterZ() const {return m_center[2];}
+  float UpX() const {return m_up[0];}
+  float UpY() const {return m_up[1];}
+  float UpZ() const {return m_up[2];}
+
+  // Camera frame orientation (w, x, y, z): its columns are the
+  // camera X, Y and Z axes, Z pointing from the center to the eye.
+  const float *Orientation() const {return m_orientation;}
+
+  // World to eye transform, 16 floats in column-major (OpenGL) order,
+  // equivalent to gluLookAt(eye, center, up). Rebuilt on first use
+  // after the camera changed, otherwise returned from the cache.
+  const float *ViewMatrix() const;
 
   bool Gravity() const {return m_gravity;}
 
@@ -64,34 +63,26 @@ public:
   void MouseDown(int x, int y) {m_mousex = x;  m_mousey = y;}
 	void MouseMove(int x, int y);
 
-  void gluLookAt() {::gluLookAt(m_eye[0], m_eye[1], m_eye[2], 
-                                m_center[0], m_center[1], m_center[2],
-                                m_up[0], m_up[1], m_up[2]);}
-
-
 private:
-	double m_up[3];
-	double m_center[3];
-	double m_eye[3];
+	float m_up[3];
+	float m_center[3];
+	float m_eye[3];
 
-	double m_fieldofview;
+	float m_fieldofview;
 	int m_mousey;
 	int m_mousex;
   eMouseMode m_mousemode;
-	void DollyHelper(double m[4][4], double x, double y, double z);
 	void ComputeFrame();
   bool m_gravity;
 
-  // The camera frame.
-  double m_camerax[3];
-  double m_cameray[3];
-  double m_cameraz[3];
+  // The camera frame as a unit quaternion (w, x, y, z).
+  float m_orientation[4];
+
+  mutable float m_view[16];
+  mutable bool m_viewdirty;
 
-  void RotCamera(double m[4][4]);
-  void UnRotCamera(double m[4][4]);
-  void RotCameraX(double m[4][4], double a);
-  void RotCameraY(double m[4][4], double a);
-  void RotCameraZ(double m[4][4], double a);
+  void Frame(float *x, float *y, float *z) const;
+  void Rotate(int axis, float d, const float *pivot, float *point);
 };
 
 #endif // !defined(AFX_GRCAMERA_H__4AA26B3C_6FD9_4573_9A4A_B677E9F852D0__INCLUDED_)
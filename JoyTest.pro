@@ -10,8 +10,9 @@ CONFIG 	   += c++11
 
 QT       += core
 QT       += gui
+QT       += concurrent
 QT       += multimedia
-QT       += opengl
+QT       += network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -23,7 +24,33 @@ SOURCES += main.cpp\
     geometryengine.cpp \
     glwidget.cpp \
     GrCamera.cpp \
-    shimmer3box.cpp
+    cameraanimator.cpp \
+    posestore.cpp \
+    posekernel.cpp \
+    posepredictor.cpp \
+    imufusion.cpp \
+    depthestimator.cpp \
+    renderscheduler.cpp \
+    scenerenderer.cpp \
+    scenegraph.cpp \
+    threadedrenderer.cpp \
+    shadercache.cpp \
+    textureasset.cpp \
+    assetloader.cpp \
+    startuptrace.cpp \
+    mjpegparser.cpp \
+    mjpegclient.cpp \
+    jitterbuffer.cpp \
+    videotexture.cpp \
+    latencypattern.cpp \
+    latencyprobe.cpp \
+    streamrecorder.cpp \
+    snapshotwriter.cpp \
+    sessionclock.cpp \
+    sessionreader.cpp \
+    logring.cpp \
+    logger.cpp \
+    panelmodel.cpp
 
 HEADERS  += mainwindow.h \
     joystick.h \
@@ -31,7 +58,36 @@ HEADERS  += mainwindow.h \
     geometryengine.h \
     glwidget.h \
     GrCamera.h \
-    shimmer3box.h
+    cameraanimator.h \
+    posestore.h \
+    posekernel.h \
+    posepredictor.h \
+    imufusion.h \
+    depthestimator.h \
+    simdops.h \
+    renderscheduler.h \
+    scenerenderer.h \
+    scenegraph.h \
+    threadedrenderer.h \
+    shadercache.h \
+    textureasset.h \
+    rovtexture.h \
+    assetloader.h \
+    startuptrace.h \
+    mjpegparser.h \
+    mjpegclient.h \
+    jitterbuffer.h \
+    videoframe.h \
+    videotexture.h \
+    latencypattern.h \
+    latencyprobe.h \
+    streamrecorder.h \
+    snapshotwriter.h \
+    sessionclock.h \
+    sessionreader.h \
+    logring.h \
+    logger.h \
+    panelmodel.h
 
 RESOURCES += \
     shaders.qrc \
@@ -39,10 +95,7 @@ RESOURCES += \
     otherresources.qrc
 
 
-# Edit below for custom library location
-unix {
-LIBS       += -L/usr/local/lib -lVLCQtCore -lVLCQtWidgets
-INCLUDEPATH += /usr/local/lib include
-}
+# libjpeg-turbo, for the camera stream
+LIBS       += -lturbojpeg
 
 DISTFILES +=
@@ -0,0 +1,84 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "assetloader.h"
+#include "startuptrace.h"
+
+#include <QtConcurrent/QtConcurrentRun>
+#include <QCoreApplication>
+#include <QFile>
+
+
+AssetLoader::AssetLoader()
+  : bStarted(false)
+  , sMeshPath(":/ROV_2.obj")
+  , sSkinPath(":/uvUnwrapROV_2.png")
+  , sBakedSkinPath(defaultBakedSkinPath())
+{
+}
+
+
+// The texture baked by tools/texbake is used when
+// found next to the executable
+QString
+AssetLoader::defaultBakedSkinPath() {
+  return QCoreApplication::applicationDirPath() + QString("/uvUnwrapROV_2.rtex");
+}
+
+
+void
+AssetLoader::start() {
+  if(bStarted) return;
+  bStarted = true;
+  meshFuture = QtConcurrent::run(&AssetLoader::decodeMesh, sMeshPath);
+  skinFuture = QtConcurrent::run(&AssetLoader::decodeSkin, sSkinPath, sBakedSkinPath);
+}
+
+
+MeshData
+AssetLoader::decodeMesh(QString path) {
+  StartupTrace::Scope trace("mesh decode");
+  return GeometryEngine::loadROVMesh(path);
+}
+
+
+QImage
+AssetLoader::decodeSkin(QString imagePath, QString bakedPath) {
+  if(QFile::exists(bakedPath))
+    return QImage();
+  StartupTrace::Scope trace("skin decode");
+  return QImage(imagePath).mirrored();
+}
+
+
+// Without start() everything is decoded by the calling thread
+MeshData
+AssetLoader::mesh() const {
+  if(!bStarted)
+    return decodeMesh(sMeshPath);
+  return meshFuture.result();
+}
+
+
+QImage
+AssetLoader::skinImage() const {
+  if(!bStarted)
+    return decodeSkin(sSkinPath, sBakedSkinPath);
+  return skinFuture.result();
+}
+
+
+QString
+AssetLoader::bakedSkinPath() const {
+  return sBakedSkinPath;
+}
@@ -0,0 +1,40 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <QFuture>
+#include <QImage>
+#include <QString>
+
+#include "geometryengine.h"
+
+
+// Decodes the ROV mesh and its skin on worker threads so that the
+// rest of the application can initialize meanwhile. The renderer
+// collects the results (waiting only if they are not ready yet)
+// and uploads them from the OpenGL thread.
+class AssetLoader
+{
+public:
+  AssetLoader();
+
+  void start();
+
+  MeshData mesh() const;
+  QImage   skinImage() const;  // Null if the baked texture is to be used
+  QString  bakedSkinPath() const;
+
+  static QString defaultBakedSkinPath();
+
+private:
+  static MeshData decodeMesh(QString path);
+  static QImage   decodeSkin(QString imagePath, QString bakedPath);
+
+  bool              bStarted;
+  QString           sMeshPath;
+  QString           sSkinPath;
+  QString           sBakedSkinPath;
+  QFuture<MeshData> meshFuture;
+  QFuture<QImage>   skinFuture;
+};
+
+#endif // ASSETLOADER_H
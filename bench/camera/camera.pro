@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Cost of a camera update from a mouse move, and of
+# the view matrix of the frame, for the legacy double
+# precision camera and for CGrCamera. Plain C++.
+#
+#-------------------------------------------------
+
+TARGET = CameraBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    legacycamera.cpp \
+    $$ROOT/GrCamera.cpp
+
+HEADERS  += \
+    legacycamera.h \
+    $$ROOT/GrCamera.h
@@ -0,0 +1,161 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Replays the same mouse drags on the legacy double precision camera
+// and on CGrCamera, for each mouse mode, and prints:
+//   update:      the cost of one MouseMove()
+//   update+view: the same plus the view matrix of the frame, rebuilt
+//                with a lookAt() for the legacy camera and taken from
+//                the cache of CGrCamera
+// and the largest difference of the two view matrices along the drag.
+
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "GrCamera.h"
+#include "legacycamera.h"
+
+
+// Column-major lookAt, as done by QMatrix4x4::lookAt() every frame
+// before the view matrix was cached
+static void
+lookAt(const double* eye, const double* center, const double* up, float* m) {
+  float f[3] = { float(center[0]-eye[0]), float(center[1]-eye[1]), float(center[2]-eye[2]) };
+  float length = sqrtf(f[0]*f[0] + f[1]*f[1] + f[2]*f[2]);
+  f[0] /= length; f[1] /= length; f[2] /= length;
+  float s[3] = { f[1]*float(up[2]) - f[2]*float(up[1]),
+                 f[2]*float(up[0]) - f[0]*float(up[2]),
+                 f[0]*float(up[1]) - f[1]*float(up[0]) };
+  length = sqrtf(s[0]*s[0] + s[1]*s[1] + s[2]*s[2]);
+  s[0] /= length; s[1] /= length; s[2] /= length;
+  float u[3] = { s[1]*f[2] - s[2]*f[1], s[2]*f[0] - s[0]*f[2], s[0]*f[1] - s[1]*f[0] };
+  float e[3] = { float(eye[0]), float(eye[1]), float(eye[2]) };
+  m[0] = s[0];  m[4] = s[1];  m[8]  = s[2];  m[12] = -(s[0]*e[0] + s[1]*e[1] + s[2]*e[2]);
+  m[1] = u[0];  m[5] = u[1];  m[9]  = u[2];  m[13] = -(u[0]*e[0] + u[1]*e[1] + u[2]*e[2]);
+  m[2] = -f[0]; m[6] = -f[1]; m[10] = -f[2]; m[14] =  (f[0]*e[0] + f[1]*e[1] + f[2]*e[2]);
+  m[3] = 0;     m[7] = 0;     m[11] = 0;     m[15] = 1;
+}
+
+
+struct Mode {
+  const char* name;
+  CGrCamera::eMouseMode mode;
+  bool gravity;
+};
+
+
+// A random walk of the mouse, a few pixels per event
+static std::vector<int>
+makeDrag(int nEvents) {
+  std::vector<int> drag(2*nEvents);
+  int x = 0, y = 0;
+  for(int i=0; i<nEvents; i++) {
+    x += rand()%9 - 4;
+    y += rand()%9 - 4;
+    drag[2*i]   = x;
+    drag[2*i+1] = y;
+  }
+  return drag;
+}
+
+
+template<class Camera>
+static void
+setup(Camera& camera, const Mode& mode) {
+  camera.Set(0,0,2, 0,0,0, 0,1,0);
+  camera.Gravity(mode.gravity);
+  camera.MouseMode(typename Camera::eMouseMode(mode.mode));
+  camera.MouseDown(0, 0);
+}
+
+
+template<class F>
+static double
+nsPerEvent(int nEvents, F f) {
+  f();// Warm up
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / nEvents;
+}
+
+
+int
+main() {
+  const Mode modes[] = {
+    { "pitch/yaw", CGrCamera::PITCHYAW, false },
+    { "roll/move", CGrCamera::ROLLMOVE, false },
+    { "pan/tilt",  CGrCamera::PANTILT,  true  },
+    { "dolly xy",  CGrCamera::DOLLYXY,  true  }
+  };
+  const int nEvents = 1000000;
+  const int nChecked = 2000;
+  std::vector<int> drag = makeDrag(nEvents);
+  volatile float sink = 0.0f;
+
+  printf("%10s %13s %13s %18s %18s %12s\n", "mode",
+         "legacy [ns]", "float [ns]", "legacy+view [ns]", "float+view [ns]", "max error");
+  for(unsigned m=0; m<sizeof(modes)/sizeof(modes[0]); m++) {
+    CLegacyCamera legacy;
+    CGrCamera camera;
+    float view[16];
+
+    double tLegacy = nsPerEvent(nEvents, [&]() {
+      setup(legacy, modes[m]);
+      for(int i=0; i<nEvents; i++)
+        legacy.MouseMove(drag[2*i], drag[2*i+1]);
+      sink = sink + float(legacy.EyeX());
+    });
+    double tCamera = nsPerEvent(nEvents, [&]() {
+      setup(camera, modes[m]);
+      for(int i=0; i<nEvents; i++)
+        camera.MouseMove(drag[2*i], drag[2*i+1]);
+      sink = sink + camera.EyeX();
+    });
+    double tLegacyView = nsPerEvent(nEvents, [&]() {
+      setup(legacy, modes[m]);
+      for(int i=0; i<nEvents; i++) {
+        legacy.MouseMove(drag[2*i], drag[2*i+1]);
+        lookAt(legacy.Eye(), legacy.Center(), legacy.Up(), view);
+        sink = sink + view[12];
+      }
+    });
+    double tCameraView = nsPerEvent(nEvents, [&]() {
+      setup(camera, modes[m]);
+      for(int i=0; i<nEvents; i++) {
+        camera.MouseMove(drag[2*i], drag[2*i+1]);
+        sink = sink + camera.ViewMatrix()[12];
+      }
+    });
+
+    // Same drag from the start, comparing the two view matrices
+    double error = 0.0;
+    setup(legacy, modes[m]);
+    setup(camera, modes[m]);
+    for(int i=0; i<nChecked; i++) {
+      legacy.MouseMove(drag[2*i], drag[2*i+1]);
+      camera.MouseMove(drag[2*i], drag[2*i+1]);
+      lookAt(legacy.Eye(), legacy.Center(), legacy.Up(), view);
+      const float* pView = camera.ViewMatrix();
+      for(int k=0; k<16; k++)
+        error = fmax(error, fabs(double(view[k]) - double(pView[k])));
+    }
+
+    printf("%10s %13.2f %13.2f %18.2f %18.2f %12.2e\n", modes[m].name,
+           tLegacy, tCamera, tLegacyView, tCameraView, error);
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Cost per sample of the batched Madgwick filter
+# against the classic one sample at a time. Plain C++:
+# add QMAKE_CXXFLAGS += -mavx to time the AVX path.
+#
+#-------------------------------------------------
+
+TARGET = ImuFusionBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/imufusion.cpp
+
+HEADERS  += \
+    $$ROOT/imufusion.h \
+    $$ROOT/simdops.h
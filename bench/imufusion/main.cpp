@@ -0,0 +1,297 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Fuses 100 steps of raw samples for 16, 1000 and 10000 sensors with:
+//   reference: Madgwick's filter one sample at a time, as published
+//   kernel:    the batched filter step alone, on arrays ready for it
+//   fusion:    ImuFusion (queue, gather, batched step, scatter)
+// and prints the cost per sample and the largest difference between
+// the resulting quaternions. Half of the sensors have no magnetometer.
+
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "imufusion.h"
+#include "simdops.h"
+
+
+// Madgwick's reference implementation (MadgwickAHRS.c), with an
+// exact inverse square root
+
+static float
+invSqrt(float x) {
+  return 1.0f/sqrtf(x);
+}
+
+
+static void
+madgwickImu(float* q, float beta, float gx, float gy, float gz,
+            float ax, float ay, float az, float dt)
+{
+  float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+  float recipNorm;
+  float s0, s1, s2, s3;
+  float qDot1, qDot2, qDot3, qDot4;
+  float _2q0, _2q1, _2q2, _2q3, _4q0, _4q1, _4q2 ,_8q1, _8q2, q0q0, q1q1, q2q2, q3q3;
+
+  qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
+    recipNorm = invSqrt(ax * ax + ay * ay + az * az);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+    _2q0 = 2.0f * q0;
+    _2q1 = 2.0f * q1;
+    _2q2 = 2.0f * q2;
+    _2q3 = 2.0f * q3;
+    _4q0 = 4.0f * q0;
+    _4q1 = 4.0f * q1;
+    _4q2 = 4.0f * q2;
+    _8q1 = 8.0f * q1;
+    _8q2 = 8.0f * q2;
+    q0q0 = q0 * q0;
+    q1q1 = q1 * q1;
+    q2q2 = q2 * q2;
+    q3q3 = q3 * q3;
+    s0 = _4q0 * q2q2 + _2q2 * ax + _4q0 * q1q1 - _2q1 * ay;
+    s1 = _4q1 * q3q3 - _2q3 * ax + 4.0f * q0q0 * q1 - _2q0 * ay - _4q1 + _8q1 * q1q1 + _8q1 * q2q2 + _4q1 * az;
+    s2 = 4.0f * q0q0 * q2 + _2q0 * ax + _4q2 * q3q3 - _2q3 * ay - _4q2 + _8q2 * q1q1 + _8q2 * q2q2 + _4q2 * az;
+    s3 = 4.0f * q1q1 * q3 - _2q1 * ax + 4.0f * q2q2 * q3 - _2q2 * ay;
+    recipNorm = invSqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+    s0 *= recipNorm;
+    s1 *= recipNorm;
+    s2 *= recipNorm;
+    s3 *= recipNorm;
+    qDot1 -= beta * s0;
+    qDot2 -= beta * s1;
+    qDot3 -= beta * s2;
+    qDot4 -= beta * s3;
+  }
+
+  q0 += qDot1 * dt;
+  q1 += qDot2 * dt;
+  q2 += qDot3 * dt;
+  q3 += qDot4 * dt;
+  recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q[0] = q0 * recipNorm;
+  q[1] = q1 * recipNorm;
+  q[2] = q2 * recipNorm;
+  q[3] = q3 * recipNorm;
+}
+
+
+static void
+madgwickMarg(float* q, float beta, float gx, float gy, float gz,
+             float ax, float ay, float az, float mx, float my, float mz, float dt)
+{
+  if((mx == 0.0f) && (my == 0.0f) && (mz == 0.0f)) {
+    madgwickImu(q, beta, gx, gy, gz, ax, ay, az, dt);
+    return;
+  }
+  float q0 = q[0], q1 = q[1], q2 = q[2], q3 = q[3];
+  float recipNorm;
+  float s0, s1, s2, s3;
+  float qDot1, qDot2, qDot3, qDot4;
+  float hx, hy;
+  float _2q0mx, _2q0my, _2q0mz, _2q1mx, _2bx, _2bz, _4bx, _4bz, _2q0, _2q1, _2q2, _2q3, _2q0q2, _2q2q3, q0q0, q0q1, q0q2, q0q3, q1q1, q1q2, q1q3, q2q2, q2q3, q3q3;
+
+  qDot1 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+  qDot2 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+  qDot3 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+  qDot4 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+  if(!((ax == 0.0f) && (ay == 0.0f) && (az == 0.0f))) {
+    recipNorm = invSqrt(ax * ax + ay * ay + az * az);
+    ax *= recipNorm;
+    ay *= recipNorm;
+    az *= recipNorm;
+    recipNorm = invSqrt(mx * mx + my * my + mz * mz);
+    mx *= recipNorm;
+    my *= recipNorm;
+    mz *= recipNorm;
+    _2q0mx = 2.0f * q0 * mx;
+    _2q0my = 2.0f * q0 * my;
+    _2q0mz = 2.0f * q0 * mz;
+    _2q1mx = 2.0f * q1 * mx;
+    _2q0 = 2.0f * q0;
+    _2q1 = 2.0f * q1;
+    _2q2 = 2.0f * q2;
+    _2q3 = 2.0f * q3;
+    _2q0q2 = 2.0f * q0 * q2;
+    _2q2q3 = 2.0f * q2 * q3;
+    q0q0 = q0 * q0;
+    q0q1 = q0 * q1;
+    q0q2 = q0 * q2;
+    q0q3 = q0 * q3;
+    q1q1 = q1 * q1;
+    q1q2 = q1 * q2;
+    q1q3 = q1 * q3;
+    q2q2 = q2 * q2;
+    q2q3 = q2 * q3;
+    q3q3 = q3 * q3;
+    hx = mx * q0q0 - _2q0my * q3 + _2q0mz * q2 + mx * q1q1 + _2q1 * my * q2 + _2q1 * mz * q3 - mx * q2q2 - mx * q3q3;
+    hy = _2q0mx * q3 + my * q0q0 - _2q0mz * q1 + _2q1mx * q2 - my * q1q1 + my * q2q2 + _2q2 * mz * q3 - my * q3q3;
+    _2bx = sqrtf(hx * hx + hy * hy);
+    _2bz = -_2q0mx * q2 + _2q0my * q1 + mz * q0q0 + _2q1mx * q3 - mz * q1q1 + _2q2 * my * q3 - mz * q2q2 + mz * q3q3;
+    _4bx = 2.0f * _2bx;
+    _4bz = 2.0f * _2bz;
+    s0 = -_2q2 * (2.0f * q1q3 - _2q0q2 - ax) + _2q1 * (2.0f * q0q1 + _2q2q3 - ay) - _2bz * q2 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx) + (-_2bx * q3 + _2bz * q1) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my) + _2bx * q2 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+    s1 = _2q3 * (2.0f * q1q3 - _2q0q2 - ax) + _2q0 * (2.0f * q0q1 + _2q2q3 - ay) - 4.0f * q1 * (1 - 2.0f * q1q1 - 2.0f * q2q2 - az) + _2bz * q3 * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx) + (_2bx * q2 + _2bz * q0) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my) + (_2bx * q3 - _4bz * q1) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+    s2 = -_2q0 * (2.0f * q1q3 - _2q0q2 - ax) + _2q3 * (2.0f * q0q1 + _2q2q3 - ay) - 4.0f * q2 * (1 - 2.0f * q1q1 - 2.0f * q2q2 - az) + (-_4bx * q2 - _2bz * q0) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx) + (_2bx * q1 + _2bz * q3) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my) + (_2bx * q0 - _4bz * q2) * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+    s3 = _2q1 * (2.0f * q1q3 - _2q0q2 - ax) + _2q2 * (2.0f * q0q1 + _2q2q3 - ay) + (-_4bx * q3 + _2bz * q1) * (_2bx * (0.5f - q2q2 - q3q3) + _2bz * (q1q3 - q0q2) - mx) + (-_2bx * q0 + _2bz * q2) * (_2bx * (q1q2 - q0q3) + _2bz * (q0q1 + q2q3) - my) + _2bx * q1 * (_2bx * (q0q2 + q1q3) + _2bz * (0.5f - q1q1 - q2q2) - mz);
+    recipNorm = invSqrt(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+    s0 *= recipNorm;
+    s1 *= recipNorm;
+    s2 *= recipNorm;
+    s3 *= recipNorm;
+    qDot1 -= beta * s0;
+    qDot2 -= beta * s1;
+    qDot3 -= beta * s2;
+    qDot4 -= beta * s3;
+  }
+
+  q0 += qDot1 * dt;
+  q1 += qDot2 * dt;
+  q2 += qDot3 * dt;
+  q3 += qDot4 * dt;
+  recipNorm = invSqrt(q0 * q0 + q1 * q1 + q2 * q2 + q3 * q3);
+  q[0] = q0 * recipNorm;
+  q[1] = q1 * recipNorm;
+  q[2] = q2 * recipNorm;
+  q[3] = q3 * recipNorm;
+}
+
+
+static float
+noise() {
+  return (rand()%2001 - 1000) * 0.001f;
+}
+
+
+// A sensor slowly spinning, seen through noisy readings
+static ImuSample
+makeSample(int id, int step) {
+  ImuSample sample;
+  float t = step * 0.01f;
+  sample.gyro[0]  = 0.3f*sinf(t + id) + 0.01f*noise();
+  sample.gyro[1]  = 0.2f*cosf(t + id) + 0.01f*noise();
+  sample.gyro[2]  = 0.1f + 0.01f*noise();
+  sample.accel[0] = 0.1f*noise();
+  sample.accel[1] = 0.1f*noise();
+  sample.accel[2] = 9.81f + 0.1f*noise();
+  bool bMag = (id % 2) == 0;
+  sample.mag[0] = bMag ? 0.3f + 0.01f*noise() : 0.0f;
+  sample.mag[1] = bMag ? 0.01f*noise() : 0.0f;
+  sample.mag[2] = bMag ? -0.4f + 0.01f*noise() : 0.0f;
+  sample.dt = 0.01f;
+  return sample;
+}
+
+
+int
+main() {
+  const int   sizes[] = { 16, 1000, 10000 };
+  const int   nSteps  = 100;
+  const float beta    = 0.1f;
+
+  printf("imu fusion: %s\n", simdInstructionSet());
+  printf("%8s %14s %14s %14s %10s %12s\n",
+         "sensors", "reference [ns]", "kernel [ns]", "fusion [ns]", "speedup", "max error");
+  for(unsigned s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++) {
+    int nSensors = sizes[s];
+    std::vector<ImuSample> samples(nSensors*nSteps);
+    srand(12345);
+    for(int step=0; step<nSteps; step++)
+      for(int id=0; id<nSensors; id++)
+        samples[step*nSensors+id] = makeSample(id, step);
+
+    std::vector<float> q(4*nSensors);
+    for(int id=0; id<nSensors; id++) {
+      q[4*id] = 1.0f; q[4*id+1] = q[4*id+2] = q[4*id+3] = 0.0f;
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int step=0; step<nSteps; step++)
+      for(int id=0; id<nSensors; id++) {
+        const ImuSample& m = samples[step*nSensors+id];
+        madgwickMarg(&q[4*id], beta, m.gyro[0], m.gyro[1], m.gyro[2],
+                     m.accel[0], m.accel[1], m.accel[2], m.mag[0], m.mag[1], m.mag[2], m.dt);
+      }
+    std::chrono::duration<double, std::nano> tReference = std::chrono::steady_clock::now() - start;
+
+    // One sample of every sensor is queued at each step, as read
+    // from the link, and fused by a batched update
+    ImuFusion fusion(nSensors);
+    fusion.setBeta(beta);
+    start = std::chrono::steady_clock::now();
+    for(int step=0; step<nSteps; step++) {
+      for(int id=0; id<nSensors; id++)
+        fusion.addSample(id, samples[step*nSensors+id]);
+      fusion.update();
+    }
+    std::chrono::duration<double, std::nano> tBatch = std::chrono::steady_clock::now() - start;
+
+    // The same steps with the samples already laid out per field
+    std::vector<float> arrays(14*nSensors*nSteps);
+    for(int step=0; step<nSteps; step++) {
+      float* p = &arrays[14*nSensors*step];
+      for(int id=0; id<nSensors; id++) {
+        const ImuSample& m = samples[step*nSensors+id];
+        for(int c=0; c<3; c++) {
+          p[(4+c)*nSensors + id] = m.gyro[c];
+          p[(7+c)*nSensors + id] = m.accel[c];
+          p[(10+c)*nSensors + id] = m.mag[c];
+        }
+        p[13*nSensors + id] = m.dt;
+      }
+    }
+    std::vector<float> state(4*nSensors, 0.0f);
+    for(int id=0; id<nSensors; id++)
+      state[id] = 1.0f;
+    start = std::chrono::steady_clock::now();
+    for(int step=0; step<nSteps; step++) {
+      const float* p = &arrays[14*nSensors*step];
+      float* q = state.data();
+      ImuBatch batch = { q, q + nSensors, q + 2*nSensors, q + 3*nSensors,
+                         p + 4*nSensors,  p + 5*nSensors,  p + 6*nSensors,
+                         p + 7*nSensors,  p + 8*nSensors,  p + 9*nSensors,
+                         p + 10*nSensors, p + 11*nSensors, p + 12*nSensors,
+                         p + 13*nSensors };
+      madgwickUpdate(batch, nSensors, beta);
+    }
+    std::chrono::duration<double, std::nano> tKernel = std::chrono::steady_clock::now() - start;
+
+    double error = 0.0;
+    for(int id=0; id<nSensors; id++) {
+      float w, x, y, z;
+      fusion.orientation(id, w, x, y, z);
+      error = fmax(error, fabs(w - q[4*id]));
+      error = fmax(error, fabs(x - q[4*id+1]));
+      error = fmax(error, fabs(y - q[4*id+2]));
+      error = fmax(error, fabs(z - q[4*id+3]));
+      error = fmax(error, fabs(state[id] - q[4*id]));
+      error = fmax(error, fabs(state[3*nSensors+id] - q[4*id+3]));
+    }
+    double nSamples = double(nSensors) * nSteps;
+    printf("%8d %14.2f %14.2f %14.2f %9.1fx %12.2e\n", nSensors,
+           tReference.count()/nSamples, tKernel.count()/nSamples, tBatch.count()/nSamples,
+           tReference.count()/tBatch.count(), error);
+  }
+  return 0;
+}
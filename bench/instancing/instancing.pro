@@ -0,0 +1,65 @@
+#-------------------------------------------------
+#
+# Frame time of the per-sensor and of the instanced
+# drawing paths of GLWidget
+#
+#-------------------------------------------------
+
+TARGET = InstancingBench
+TEMPLATE = app
+CONFIG 	   += c++11
+
+QT       += core
+QT       += gui
+QT       += concurrent
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/geometryengine.cpp \
+    $$ROOT/glwidget.cpp \
+    $$ROOT/GrCamera.cpp \
+    $$ROOT/cameraanimator.cpp \
+    $$ROOT/posestore.cpp \
+    $$ROOT/posekernel.cpp \
+    $$ROOT/posepredictor.cpp \
+    $$ROOT/sessionclock.cpp \
+    $$ROOT/renderscheduler.cpp \
+    $$ROOT/scenerenderer.cpp \
+    $$ROOT/videotexture.cpp \
+    $$ROOT/scenegraph.cpp \
+    $$ROOT/threadedrenderer.cpp \
+    $$ROOT/shadercache.cpp \
+    $$ROOT/textureasset.cpp \
+    $$ROOT/assetloader.cpp \
+    $$ROOT/startuptrace.cpp
+
+HEADERS  += \
+    $$ROOT/geometryengine.h \
+    $$ROOT/glwidget.h \
+    $$ROOT/GrCamera.h \
+    $$ROOT/cameraanimator.h \
+    $$ROOT/posestore.h \
+    $$ROOT/posekernel.h \
+    $$ROOT/simdops.h \
+    $$ROOT/posepredictor.h \
+    $$ROOT/sessionclock.h \
+    $$ROOT/renderscheduler.h \
+    $$ROOT/scenerenderer.h \
+    $$ROOT/videotexture.h \
+    $$ROOT/videoframe.h \
+    $$ROOT/scenegraph.h \
+    $$ROOT/threadedrenderer.h \
+    $$ROOT/shadercache.h \
+    $$ROOT/textureasset.h \
+    $$ROOT/rovtexture.h \
+    $$ROOT/assetloader.h \
+    $$ROOT/startuptrace.h
+
+RESOURCES += \
+    $$ROOT/shaders.qrc \
+    $$ROOT/textures.qrc \
+    $$ROOT/otherresources.qrc
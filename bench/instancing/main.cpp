@@ -0,0 +1,110 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Renders 1, 100 and 10000 sensors with and without
+// instancing and prints the average and the best frame time.
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QVector>
+#include <QSurfaceFormat>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glwidget.h"
+#include "posestore.h"
+
+
+class BenchWidget : public GLWidget
+{
+public:
+  BenchWidget(CGrCamera* myCamera)
+    : GLWidget(myCamera)
+  {
+  }
+
+  // Render a frame and wait for the GPU to complete it.
+  // The buffer swap is left out so vsync does not hide the cost.
+  void renderFrame() {
+    makeCurrent();
+    paintGL();
+    glFinish();
+  }
+};
+
+
+static void
+setRandomPoses(PoseStore& poses, int nBoxes) {
+  poses.clear();
+  poses.ensure(nBoxes-1);
+  srand(12345);
+  for(int i=0; i<nBoxes; i++) {
+    float angle = rand()%360;
+    float x = rand()%100-50;
+    float y = rand()%100-50;
+    float z = rand()%100+1;
+    poses.setPose(i, angle, x, y, z, rand()%200-100, rand()%200-100, rand()%200-100, 0);
+  }
+}
+
+
+int
+main(int argc, char *argv[]) {
+  QSurfaceFormat format = GLWidget::surfaceFormat();
+  format.setSwapInterval(0);
+  QSurfaceFormat::setDefaultFormat(format);
+  QApplication app(argc, argv);
+
+  CGrCamera camera;
+  camera.FieldOfView(45.0);
+  camera.Gravity(false);
+  camera.Set(-2.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 1.0);
+
+  PoseStore poses(10000);
+  BenchWidget widget(&camera);
+  widget.lightPos = QVector4D(-2800, -2800, 2800, 1.0);
+  widget.setPoseStore(&poses);
+  widget.setFixedSize(QSize(440, 330));
+  widget.show();
+  app.processEvents();
+
+  const int instances[] = { 1, 100, 10000 };
+  const int warmUpFrames = 10;
+  const int timedFrames  = 100;
+  QElapsedTimer timer;
+
+  printf("%10s %10s %12s %12s\n", "instances", "path", "mean [ms]", "best [ms]");
+  for(unsigned n=0; n<sizeof(instances)/sizeof(instances[0]); n++) {
+    setRandomPoses(poses, instances[n]);
+    for(int instanced=0; instanced<2; instanced++) {
+      widget.useInstancing = (instanced != 0);
+      for(int i=0; i<warmUpFrames; i++)
+        widget.renderFrame();
+      double total = 0.0;
+      double best  = 1.0e30;
+      for(int i=0; i<timedFrames; i++) {
+        timer.start();
+        widget.renderFrame();
+        double elapsed = timer.nsecsElapsed()*1.0e-6;
+        total += elapsed;
+        if(elapsed < best) best = elapsed;
+      }
+      printf("%10d %10s %12.3f %12.3f\n",
+             instances[n],
+             instanced ? "instanced" : "per-box",
+             total/timedFrames,
+             best);
+    }
+  }
+  return 0;
+}
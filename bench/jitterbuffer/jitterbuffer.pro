@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Adaptive playout delay against the fixed ones
+# (no buffering, 200 ms) on simulated links: late
+# frames, frames never shown and the mean delay.
+# Plain C++.
+#
+#-------------------------------------------------
+
+TARGET = JitterBufferBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/jitterbuffer.cpp
+
+HEADERS  += \
+    $$ROOT/jitterbuffer.h
@@ -0,0 +1,130 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Plays 30 fps video over simulated links on a 60 Hz display with
+//   none:     each frame shown as soon as it arrives
+//   fixed:    a fixed 200 ms playout delay, like a media player cache
+//   adaptive: JitterBuffer with a 1% late target
+// and prints, for each link, the mean capture to display latency, the
+// standard deviation of the time between the frames shown (what the
+// pilot sees as stutter: 0 for a frame every other vsync), the frames
+// arriving after their playout time and the frames never shown.
+// Arrivals are in order, as on TCP: a late frame holds the next ones.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+
+#include "jitterbuffer.h"
+
+
+static const long long framePeriod   = 33333333;
+static const long long vsyncPeriod   = 16666667;
+static const long long fixedLatency  = 20000000;
+static const int       nFrames       = 18000;// 10 min
+
+
+enum Link { steady, jittery, bursty, changing };
+enum Policy { none, fixed, adaptive };
+
+
+static std::vector<long long>
+arrivals(Link link, std::mt19937& random) {
+  std::exponential_distribution<double> small(1.0/2.0e6);
+  std::normal_distribution<double>      wide(0.0, 15.0e6);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<long long> times(nFrames);
+  long long last = 0;
+  for(int i=0; i<nFrames; i++) {
+    Link current = link;
+    if(link == changing)
+      current = (i > nFrames/3 && i < 2*nFrames/3) ? jittery : steady;
+    double jitter = small(random);
+    if(current == jittery)
+      jitter = fabs(wide(random));
+    else if(current == bursty && uniform(random) < 0.03)
+      jitter += 60.0e6 + 60.0e6*uniform(random);
+    long long arrival = i*framePeriod + fixedLatency + (long long)jitter;
+    last = std::max(last, arrival);
+    times[i] = last;
+  }
+  return times;
+}
+
+
+static void
+play(const std::vector<long long>& arrival, Policy policy, const char* pLink) {
+  JitterBuffer buffer;
+  std::vector<long long> playout(nFrames);
+  long long nLate = 0;
+  for(int i=0; i<nFrames; i++) {
+    long long source = i*framePeriod;
+    if(policy == none)
+      playout[i] = arrival[i];
+    else if(policy == fixed) {
+      playout[i] = std::max(source + fixedLatency + 200000000, arrival[i]);
+      if(arrival[i] > source + fixedLatency + 200000000) nLate++;
+    }
+    else
+      playout[i] = buffer.playoutTime(source, arrival[i]);
+  }
+  if(policy == adaptive)
+    nLate = buffer.framesLate();
+
+  // At each vsync the newest frame due is shown, the older ones due
+  // are never seen
+  int next = 0;
+  int shown = -1;
+  long long nSkipped = 0;
+  double sum = 0.0;
+  double sumIntervals = 0.0, sumSquares = 0.0;
+  long long lastShown = 0;
+  long long nShown = 0;
+  for(long long vsync=0; next < nFrames; vsync += vsyncPeriod) {
+    int newest = -1;
+    while(next < nFrames && playout[next] <= vsync)
+      newest = next++;
+    if(newest < 0) continue;
+    nSkipped += newest - shown - 1;
+    shown = newest;
+    sum += double(vsync - newest*framePeriod)/1.0e6;
+    if(nShown > 0) {
+      double interval = double(vsync - lastShown)/1.0e6;
+      sumIntervals += interval;
+      sumSquares   += interval*interval;
+    }
+    lastShown = vsync;
+    nShown++;
+  }
+  double mean = sumIntervals/(nShown-1);
+  const char* pPolicy[] = { "none", "fixed 200 ms", "adaptive" };
+  printf("%-9s %-13s latency %6.1f ms  interval std dev %5.1f ms  late %5.2f%%  never shown %5.2f%%\n",
+         pLink, pPolicy[policy], sum/nShown, sqrt(std::max(0.0, sumSquares/(nShown-1) - mean*mean)),
+         100.0*nLate/nFrames, 100.0*nSkipped/nFrames);
+}
+
+
+int
+main() {
+  const char* pLinks[] = { "steady", "jittery", "bursty", "changing" };
+  for(int link=steady; link<=changing; link++) {
+    std::mt19937 random(1234);
+    std::vector<long long> arrival = arrivals(Link(link), random);
+    for(int policy=none; policy<=adaptive; policy++)
+      play(arrival, Policy(policy), pLinks[link]);
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Cost of a log call from 1 to 4 threads while a
+# reader drains the ring, against a mutex guarded
+# queue of strings. Plain C++.
+#
+#-------------------------------------------------
+
+TARGET = LogRingBench
+TEMPLATE = app
+CONFIG 	   += c++11 console thread
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/logring.cpp
+
+HEADERS  += \
+    $$ROOT/logring.h
@@ -0,0 +1,186 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// 1, 2 and 4 threads log 200000 messages each while a reader drains
+// them, through
+//   ring:  LogRing (4096 records, as in Logger), with a UTF-8 text,
+//          the same text in UTF-16 (a QString) or printf formatted
+//   mutex: a std::deque<std::string> behind a std::mutex
+// and prints the cost of a log call seen by the writers. Like the
+// application, the writers log in bursts (64 messages, then 200 us
+// of other work): only the bursts are timed, and the reader keeps up
+// so that both sides deliver the same messages. The ring run prints
+// how many were dropped anyway, and checks that every message is
+// either read, in order for each writer, or counted as dropped.
+
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logring.h"
+
+
+static const int nMessages = 200000;
+static const int burst     = 64;
+static const std::chrono::microseconds pause(200);
+static const char* pText = "Frame 123456 decoded in 4.2 ms, 3 late, 0 dropped";
+
+enum TextKind {
+  utf8,
+  utf16,
+  format
+};
+static const char* kindNames[] = { "utf8  ", "utf16 ", "printf" };
+
+
+static void
+pushFormat(LogRing& ring, long long time, int level, const char* pFormat, ...) {
+  va_list arguments;
+  va_start(arguments, pFormat);
+  ring.pushFormat(time, level, "bench", pFormat, arguments);
+  va_end(arguments);
+}
+
+
+static double
+seconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static void
+benchRing(int nWriters, TextKind kind) {
+  LogRing ring(4096);
+  std::atomic<int> nDone(0);
+  std::vector<double> elapsed(size_t(nWriters), 0.0);
+  long long nRead = 0;
+  bool bOrdered = true;
+
+  std::thread reader([&]() {
+    std::vector<long long> last(size_t(nWriters), -1);
+    LogRecord record;
+    for(;;) {
+      bool bFinished = nDone.load() == nWriters;
+      while(ring.pop(record)) {
+        int writer = record.level;// The writer, for the check
+        if(record.time <= last[size_t(writer)]) bOrdered = false;
+        last[size_t(writer)] = record.time;
+        nRead++;
+      }
+      if(bFinished) break;
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+  std::vector<std::thread> writers;
+  size_t length = strlen(pText);
+  std::vector<unsigned short> text16(pText, pText+length);
+  for(int w=0; w<nWriters; w++) {
+    writers.push_back(std::thread([&, w]() {
+      for(int i=0; i<nMessages; ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int end=i+burst; i<end; i++) {
+          if(kind == utf8)
+            ring.push(i, w, "bench", pText, length);
+          else if(kind == utf16)
+            ring.pushUtf16(i, w, "bench", text16.data(), length);
+          else
+            pushFormat(ring, i, w, "Frame %d decoded in %.1f ms, %d late, %d dropped", i, 4.2, 3, 0);
+        }
+        elapsed[size_t(w)] += seconds(start);
+        std::this_thread::sleep_for(pause);
+      }
+      nDone++;
+    }));
+  }
+  for(size_t w=0; w<writers.size(); w++)
+    writers[w].join();
+  reader.join();
+
+  double total = 0.0;
+  for(int w=0; w<nWriters; w++)
+    total += elapsed[size_t(w)];
+  long long nSent = (long long)nWriters*nMessages;
+  bool bComplete = nRead + (long long)ring.dropped() == nSent;
+  printf("ring  %s %d writer(s): %6.1f ns per call, %6.3f%% dropped, %s\n",
+         kindNames[kind], nWriters, 1.0e9*total/nSent, 100.0*double(ring.dropped())/double(nSent),
+         bComplete && bOrdered ? "all accounted for, in order" : "ERROR");
+  if(!bComplete || !bOrdered) exit(1);
+}
+
+
+static void
+benchMutex(int nWriters) {
+  std::mutex mutex;
+  std::deque<std::string> queue;
+  std::atomic<int> nDone(0);
+  std::vector<double> elapsed(size_t(nWriters), 0.0);
+
+  std::thread reader([&]() {
+    std::deque<std::string> taken;
+    for(;;) {
+      bool bFinished = nDone.load() == nWriters;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken.swap(queue);
+      }
+      taken.clear();
+      if(bFinished) break;
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  });
+  std::vector<std::thread> writers;
+  for(int w=0; w<nWriters; w++) {
+    writers.push_back(std::thread([&, w]() {
+      for(int i=0; i<nMessages; ) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(int end=i+burst; i<end; i++) {
+          std::string message(pText);
+          std::lock_guard<std::mutex> lock(mutex);
+          queue.push_back(message);
+        }
+        elapsed[size_t(w)] += seconds(start);
+        std::this_thread::sleep_for(pause);
+      }
+      nDone++;
+    }));
+  }
+  for(size_t w=0; w<writers.size(); w++)
+    writers[w].join();
+  reader.join();
+
+  double total = 0.0;
+  for(int w=0; w<nWriters; w++)
+    total += elapsed[size_t(w)];
+  printf("mutex utf8   %d writer(s): %6.1f ns per call,  0.000%% dropped\n",
+         nWriters, 1.0e9*total/((long long)nWriters*nMessages));
+}
+
+
+int
+main() {
+  for(int nWriters=1; nWriters<=4; nWriters*=2) {
+    benchRing(nWriters, utf8);
+    benchRing(nWriters, utf16);
+    benchRing(nWriters, format);
+    benchMutex(nWriters);
+  }
+  return 0;
+}
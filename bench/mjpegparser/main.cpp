@@ -0,0 +1,106 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Builds an mjpg-streamer like stream of random "JPEG" frames, with
+// and without Content-Length in the part headers, and parses it in
+// pieces of the given sizes (a TCP segment, a typical socket read, a
+// large read), taking every frame as soon as it is complete. Prints
+// the parsing cost per frame and per MB, and checks every frame.
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "mjpegparser.h"
+
+
+static const char* boundary = "boundarydonotcross";
+
+
+static std::string
+makeStream(int nFrames, int frameSize, bool bContentLength, std::vector<std::string>& frames) {
+  std::string stream = "HTTP/1.0 200 OK\r\n"
+                       "Connection: close\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Content-Type: multipart/x-mixed-replace;boundary=";
+  stream += boundary;
+  stream += "\r\n\r\n--";
+  stream += boundary;
+  stream += "\r\n";
+  frames.clear();
+  for(int i=0; i<nFrames; i++) {
+    std::string jpeg = "\xff\xd8";
+    int size = frameSize/2 + rand()%frameSize;
+    for(int k=0; k<size; k++)
+      jpeg += char(rand());
+    jpeg += "\xff\xd9";
+    frames.push_back(jpeg);
+    char header[128];
+    stream += "Content-Type: image/jpeg\r\n";
+    if(bContentLength) {
+      snprintf(header, sizeof(header), "Content-Length: %d\r\n", int(jpeg.size()));
+      stream += header;
+    }
+    snprintf(header, sizeof(header), "X-Timestamp: %d.000000\r\n\r\n", i);
+    stream += header;
+    stream += jpeg;
+    stream += "\r\n--";
+    stream += boundary;
+    stream += "\r\n";
+  }
+  return stream;
+}
+
+
+int
+main() {
+  const int    nFrames   = 300;
+  const int    frameSize = 40000;// 640x480 at the usual quality
+  const size_t pieces[]  = { 1448, 16384, 262144 };
+
+  printf("%16s %8s %14s %10s %8s\n", "part length", "piece", "ns/frame", "MB/s", "errors");
+  for(int bLength=1; bLength>=0; bLength--) {
+    std::vector<std::string> frames;
+    std::string stream = makeStream(nFrames, frameSize, bLength != 0, frames);
+    for(unsigned p=0; p<sizeof(pieces)/sizeof(pieces[0]); p++) {
+      // Timed, then once more checking every frame
+      double ns = 0.0;
+      int nErrors = 0;
+      for(int bCheck=0; bCheck<2; bCheck++) {
+        MjpegParser parser;
+        std::vector<unsigned char> jpeg;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for(size_t pos=0; pos<stream.size(); pos+=pieces[p]) {
+          size_t n = std::min(pieces[p], stream.size()-pos);
+          if(!parser.feed(stream.data()+pos, n)) {
+            printf("%s\n", parser.errorString().c_str());
+            return 1;
+          }
+          while(parser.takeFrame(jpeg) && bCheck) {
+            int i = int(parser.frameTimestamp());
+            if(i < 0 || i >= nFrames || std::string(jpeg.begin(), jpeg.end()) != frames[i])
+              nErrors++;
+          }
+        }
+        std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        if(!bCheck) ns = elapsed.count();
+        else nErrors += int(nFrames - parser.framesParsed());
+      }
+      printf("%16s %8d %14.0f %10.0f %8d\n", bLength ? "Content-Length" : "boundary scan",
+             int(pieces[p]), ns/nFrames, stream.size()/(ns*1.0e-3), nErrors);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Throughput of the incremental MJPEG stream parser,
+# fed in socket-sized pieces. Plain C++.
+#
+#-------------------------------------------------
+
+TARGET = MjpegParserBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/mjpegparser.cpp
+
+HEADERS  += \
+    $$ROOT/mjpegparser.h
@@ -0,0 +1,199 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Converts 1000, 4000 and 10000 sensor poses per frame into model and
+// normal matrices with:
+//   reference: the former per sensor path (two axis-angle rotations,
+//              a translation and a general 4x4 inversion)
+//   scalar:    the pose kernel one pose at a time
+//   batch:     the pose kernel with the vector instructions available
+// and prints the cost per pose and the largest difference from the
+// reference.
+
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "posekernel.h"
+
+
+static const int stride = 32;
+
+
+// Column-major 4x4 helpers, as done by QMatrix4x4
+
+static void
+multiply(const float* a, const float* b, float* result) {
+  float m[16];
+  for(int col=0; col<4; col++)
+    for(int row=0; row<4; row++) {
+      float sum = 0.0f;
+      for(int k=0; k<4; k++)
+        sum += a[k*4+row] * b[col*4+k];
+      m[col*4+row] = sum;
+    }
+  memcpy(result, m, sizeof(m));
+}
+
+
+static void
+rotate(float* m, float angle, float x, float y, float z) {
+  float length = sqrtf(x*x + y*y + z*z);
+  x /= length; y /= length; z /= length;
+  float a = angle * float(M_PI/180.0);
+  float c = cosf(a), s = sinf(a), ic = 1.0f - c;
+  float r[16] = {
+    x*x*ic + c,   y*x*ic + z*s, x*z*ic - y*s, 0.0f,
+    x*y*ic - z*s, y*y*ic + c,   y*z*ic + x*s, 0.0f,
+    x*z*ic + y*s, y*z*ic - x*s, z*z*ic + c,   0.0f,
+    0.0f,         0.0f,         0.0f,         1.0f
+  };
+  multiply(m, r, m);
+}
+
+
+static void
+translate(float* m, float x, float y, float z) {
+  for(int row=0; row<4; row++)
+    m[12+row] += m[row]*x + m[4+row]*y + m[8+row]*z;
+}
+
+
+// General inverse by cofactors, then transposed
+static void
+inverseTransposed(const float* m, float* result) {
+  float inv[16];
+  inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+  inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+  inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+  inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+  inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+  inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+  inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+  inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+  inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+  inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+  inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+  inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+  inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+  inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+  inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+  inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+  float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+  for(int col=0; col<4; col++)
+    for(int row=0; row<4; row++)
+      result[col*4+row] = inv[row*4+col] / det;
+}
+
+
+struct Poses
+{
+  int n;
+  std::vector<float> angle, ax, ay, az;
+  std::vector<float> qw, qx, qy, qz;
+  std::vector<float> px, py, pz;
+};
+
+
+static void
+makePoses(Poses& poses, int n) {
+  poses.n = n;
+  poses.angle.resize(n); poses.ax.resize(n); poses.ay.resize(n); poses.az.resize(n);
+  poses.qw.resize(n); poses.qx.resize(n); poses.qy.resize(n); poses.qz.resize(n);
+  poses.px.resize(n); poses.py.resize(n); poses.pz.resize(n);
+  srand(12345);
+  for(int i=0; i<n; i++) {
+    poses.angle[i] = rand()%360;
+    poses.ax[i] = rand()%100-50;
+    poses.ay[i] = rand()%100-50;
+    poses.az[i] = rand()%100+1;
+    poses.px[i] = (rand()%2000-1000)*0.01f;
+    poses.py[i] = (rand()%2000-1000)*0.01f;
+    poses.pz[i] = (rand()%2000-1000)*0.01f;
+  }
+  axisAngleToQuaternions(n, poses.angle.data(), poses.ax.data(), poses.ay.data(), poses.az.data(),
+                         poses.qw.data(), poses.qx.data(), poses.qy.data(), poses.qz.data());
+}
+
+
+// Sensors 1..n-1 relative to sensor 0, as drawn by the scene graph
+static void
+reference(const Poses& poses, float scale, float* pOut) {
+  for(int i=1; i<poses.n; i++) {
+    float m[16] = { scale,0,0,0, 0,scale,0,0, 0,0,scale,0, 0,0,0,1 };
+    rotate(m, -poses.angle[0], poses.ax[0], poses.ay[0], poses.az[0]);
+    rotate(m, poses.angle[i], poses.ax[i], poses.ay[i], poses.az[i]);
+    translate(m, poses.px[i], poses.py[i], poses.pz[i]);
+    memcpy(pOut + i*stride, m, sizeof(m));
+    inverseTransposed(m, pOut + i*stride + 16);
+  }
+}
+
+
+typedef void (*Kernel)(const PoseArrays&, int, int, const float*, float, float*, int);
+
+static void
+kernel(Kernel pKernel, const Poses& poses, float scale, float* pOut) {
+  PoseArrays arrays = { poses.qw.data(), poses.qx.data(), poses.qy.data(), poses.qz.data(),
+                        poses.px.data(), poses.py.data(), poses.pz.data() };
+  float r[4] = { poses.qw[0], -poses.qx[0], -poses.qy[0], -poses.qz[0] };
+  pKernel(arrays, 1, poses.n-1, r, scale, pOut, stride);
+}
+
+
+static double
+maxDifference(const std::vector<float>& a, const std::vector<float>& b) {
+  double worst = 0.0;
+  for(size_t i=stride; i<a.size(); i++)
+    worst = fmax(worst, fabs(double(a[i]) - double(b[i])));
+  return worst;
+}
+
+
+template<class F>
+static double
+nsPerPose(int nPoses, int nFrames, F f) {
+  f();// Warm up
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i=0; i<nFrames; i++)
+    f();
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (double(nFrames) * nPoses);
+}
+
+
+int
+main() {
+  const int   sizes[] = { 1000, 4000, 10000 };
+  const int   nFrames = 200;
+  const float scale   = 0.25f;
+
+  printf("pose kernel: %s\n", poseKernelInstructionSet());
+  printf("%8s %14s %14s %14s %10s %12s\n",
+         "poses", "reference [ns]", "scalar [ns]", "batch [ns]", "speedup", "max error");
+  for(unsigned s=0; s<sizeof(sizes)/sizeof(sizes[0]); s++) {
+    Poses poses;
+    makePoses(poses, sizes[s]);
+    std::vector<float> expected(poses.n*stride), scalar(poses.n*stride), batch(poses.n*stride);
+    double tReference = nsPerPose(poses.n, nFrames, [&]() { reference(poses, scale, expected.data()); });
+    double tScalar    = nsPerPose(poses.n, nFrames, [&]() { kernel(poseMatricesScalar, poses, scale, scalar.data()); });
+    double tBatch     = nsPerPose(poses.n, nFrames, [&]() { kernel(poseMatrices, poses, scale, batch.data()); });
+    double error = fmax(maxDifference(expected, scalar), maxDifference(expected, batch));
+    printf("%8d %14.2f %14.2f %14.2f %9.1fx %12.2e\n",
+           poses.n, tReference, tScalar, tBatch, tReference/tBatch, error);
+  }
+  return 0;
+}
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Cost per pose of the batch conversion of sensor
+# poses into model and normal matrices. Plain C++:
+# add QMAKE_CXXFLAGS += -mavx to time the AVX path.
+#
+#-------------------------------------------------
+
+TARGET = PoseKernelBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/posekernel.cpp
+
+HEADERS  += \
+    $$ROOT/posekernel.h \
+    $$ROOT/simdops.h
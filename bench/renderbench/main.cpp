@@ -0,0 +1,242 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Renders scripted pose sequences of the ROV scene into an offscreen
+// framebuffer and reports, for each sequence, the CPU time spent
+// submitting a frame, the GPU time measured with timer queries and
+// the number of draw calls per frame.
+//
+// No window system is needed: by default the "offscreen" Qt platform
+// is used. On a GPU-less box run it on Mesa llvmpipe, e.g.
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./RenderBench
+// or, without X at all,
+//   EGL_PLATFORM=surfaceless QT_QPA_PLATFORM=eglfs ./RenderBench
+//
+// Options:
+//   --frames <n>   timed frames per sequence (default 200)
+//   --size <w>x<h> framebuffer size (default 440x330)
+//   --per-box      one draw call per sensor instead of instancing
+//   --no-shader-cache  always compile the shaders from source
+//   --csv          machine readable output
+//
+// The time needed to initialize the renderer (shaders, texture and
+// model) is reported too: run it twice to see the shader cache at work.
+
+#include <QGuiApplication>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLTimerQuery>
+#include <QOffscreenSurface>
+#include <QSurfaceFormat>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVector>
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+
+#include "scenerenderer.h"
+#include "shadercache.h"
+
+
+struct Sequence
+{
+  const char* name;
+  int nSensors;
+  bool bMoving;
+};
+
+
+static const Sequence sequences[] = {
+  { "idle",            1, false },
+  { "single-roll",     1, true  },
+  { "tracked-100",   100, true  },
+  { "tracked-10000", 10000, true }
+};
+
+
+struct Stats
+{
+  double mean;
+  double median;
+  double p95;
+};
+
+
+static Stats
+computeStats(QVector<double> samples) {
+  Stats stats = { 0.0, 0.0, 0.0 };
+  if(samples.isEmpty()) return stats;
+  std::sort(samples.begin(), samples.end());
+  double total = 0.0;
+  for(int i=0; i<samples.count(); i++)
+    total += samples.at(i);
+  stats.mean   = total/samples.count();
+  stats.median = samples.at(samples.count()/2);
+  stats.p95    = samples.at(qMin(samples.count()-1, int(samples.count()*0.95)));
+  return stats;
+}
+
+
+// Poses of the given sequence at the given frame. The sensors
+// wobble around different axes so that every transform changes.
+static void
+scriptPoses(const Sequence& sequence, int iFrame, SceneFrame& frame) {
+  if(frame.poses.capacity() < sequence.nSensors)
+    frame.poses = PoseStore(sequence.nSensors);
+  frame.poses.clear();
+  frame.poses.ensure(sequence.nSensors-1);
+  for(int i=0; i<sequence.nSensors; i++) {
+    double t = sequence.bMoving ? iFrame : 0.0;
+    frame.poses.setPose(i,
+                        fmod(3.0*t + 7.0*i, 360.0),
+                        sin(0.1*i), cos(0.1*i), 1.0,
+                        (i % 100) - 50.0,
+                        ((i / 100) % 100) - 50.0,
+                        10.0*sin(0.05*t + i),
+                        iFrame);
+  }
+}
+
+
+int
+main(int argc, char *argv[]) {
+  if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QGuiApplication app(argc, argv);
+
+  int  nFrames = 200;
+  QSize size(440, 330);
+  bool bInstancing = true;
+  bool bCsv = false;
+  QStringList args = app.arguments();
+  for(int i=1; i<args.count(); i++) {
+    if(args.at(i) == "--frames" && i+1 < args.count())
+      nFrames = qMax(1, args.at(++i).toInt());
+    else if(args.at(i) == "--size" && i+1 < args.count()) {
+      QStringList wh = args.at(++i).split('x');
+      if(wh.count() == 2)
+        size = QSize(wh.at(0).toInt(), wh.at(1).toInt());
+    }
+    else if(args.at(i) == "--per-box")
+      bInstancing = false;
+    else if(args.at(i) == "--no-shader-cache")
+      ShaderCache::setEnabled(false);
+    else if(args.at(i) == "--csv")
+      bCsv = true;
+  }
+
+  QSurfaceFormat format;
+  format.setVersion(3, 3);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  format.setDepthBufferSize(24);
+
+  QOpenGLContext context;
+  context.setFormat(format);
+  if(!context.create()) {
+    fprintf(stderr, "Unable to create an OpenGL 3.3 core context\n");
+    return 1;
+  }
+  QOffscreenSurface surface;
+  surface.setFormat(context.format());
+  surface.create();
+  if(!context.makeCurrent(&surface)) {
+    fprintf(stderr, "Unable to make the context current\n");
+    return 1;
+  }
+  QOpenGLFunctions* f = context.functions();
+
+  QOpenGLFramebufferObject fbo(size, QOpenGLFramebufferObject::CombinedDepthStencil);
+  fbo.bind();
+
+  QElapsedTimer initTimer;
+  initTimer.start();
+  SceneRenderer renderer;
+  if(!renderer.initialize()) {
+    fprintf(stderr, "Unable to initialize the scene renderer\n");
+    return 1;
+  }
+  double initTime = initTimer.nsecsElapsed()*1.0e-6;
+  renderer.resize(size.width(), size.height());
+
+  QOpenGLTimerQuery gpuTimer;
+  bool bGpuTimer = gpuTimer.create();
+
+  SceneFrame frame;
+  frame.viewMatrix.setToIdentity();
+  frame.viewMatrix.lookAt(QVector3D(-2.0, 0.0, 0.0), QVector3D(0.0, 0.0, 0.0), QVector3D(0.0, 0.0, 1.0));
+  frame.fieldOfView   = 45.0;
+  frame.lightPos      = QVector4D(-2800, -2800, 2800, 1.0);
+  frame.useInstancing = bInstancing;
+
+  if(bCsv)
+    printf("sequence,sensors,draw_calls,cpu_mean_ms,cpu_median_ms,cpu_p95_ms,gpu_mean_ms,gpu_median_ms,gpu_p95_ms\n");
+  else {
+    printf("Renderer: %s (%s)\n",
+           (const char*)f->glGetString(GL_RENDERER),
+           (const char*)f->glGetString(GL_VERSION));
+    printf("Initialization: %.1f ms (shader cache %s)\n",
+           initTime, ShaderCache::isEnabled() ? "enabled" : "disabled");
+    printf("%s\n", qPrintable(ShaderCache::report()));
+    printf("%dx%d, %d frames per sequence, %s\n",
+           size.width(), size.height(), nFrames,
+           bInstancing ? "instanced" : "one draw call per box");
+    printf("%-14s %7s %6s %27s %27s\n", "", "", "",
+           "CPU [ms]", "GPU [ms]");
+    printf("%-14s %7s %6s %9s %8s %8s %9s %8s %8s\n",
+           "sequence", "sensors", "draws",
+           "mean", "median", "p95", "mean", "median", "p95");
+  }
+
+  const int warmUpFrames = 10;
+  QElapsedTimer cpuTimer;
+  for(unsigned s=0; s<sizeof(sequences)/sizeof(sequences[0]); s++) {
+    const Sequence& sequence = sequences[s];
+    QVector<double> cpuTimes, gpuTimes;
+    cpuTimes.reserve(nFrames);
+    gpuTimes.reserve(nFrames);
+    int nDrawCalls = 0;
+    for(int i=-warmUpFrames; i<nFrames; i++) {
+      scriptPoses(sequence, i, frame);
+      if(bGpuTimer) gpuTimer.begin();
+      cpuTimer.start();
+      renderer.render(frame);
+      double cpuTime = cpuTimer.nsecsElapsed()*1.0e-6;
+      if(bGpuTimer) gpuTimer.end();
+      f->glFinish();
+      if(i < 0) continue;
+      cpuTimes.append(cpuTime);
+      if(bGpuTimer)
+        gpuTimes.append(gpuTimer.waitForResult()*1.0e-6);
+      nDrawCalls = renderer.drawCalls();
+    }
+    Stats cpu = computeStats(cpuTimes);
+    Stats gpu = computeStats(gpuTimes);
+    if(bCsv)
+      printf("%s,%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+             sequence.name, sequence.nSensors, nDrawCalls,
+             cpu.mean, cpu.median, cpu.p95,
+             gpu.mean, gpu.median, gpu.p95);
+    else
+      printf("%-14s %7d %6d %9.3f %8.3f %8.3f %9.3f %8.3f %8.3f\n",
+             sequence.name, sequence.nSensors, nDrawCalls,
+             cpu.mean, cpu.median, cpu.p95,
+             gpu.mean, gpu.median, gpu.p95);
+  }
+  if(!bGpuTimer)
+    fprintf(stderr, "Timer queries not supported: GPU times not measured\n");
+
+  // The context stays current: the GL objects are released on exit
+  return 0;
+}
@@ -0,0 +1,52 @@
+#-------------------------------------------------
+#
+# Headless rendering benchmark of the ROV scene.
+# Runs without a display (and without a GPU, e.g. on
+# Mesa llvmpipe) so the frame cost can be tracked
+# commit by commit.
+#
+#-------------------------------------------------
+
+TARGET = RenderBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= app_bundle
+
+QT       += core
+QT       += gui
+QT       += concurrent
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/geometryengine.cpp \
+    $$ROOT/scenerenderer.cpp \
+    $$ROOT/videotexture.cpp \
+    $$ROOT/scenegraph.cpp \
+    $$ROOT/posestore.cpp \
+    $$ROOT/posekernel.cpp \
+    $$ROOT/shadercache.cpp \
+    $$ROOT/textureasset.cpp \
+    $$ROOT/assetloader.cpp \
+    $$ROOT/startuptrace.cpp
+
+HEADERS  += \
+    $$ROOT/geometryengine.h \
+    $$ROOT/scenerenderer.h \
+    $$ROOT/videotexture.h \
+    $$ROOT/videoframe.h \
+    $$ROOT/scenegraph.h \
+    $$ROOT/posestore.h \
+    $$ROOT/posekernel.h \
+    $$ROOT/simdops.h \
+    $$ROOT/shadercache.h \
+    $$ROOT/textureasset.h \
+    $$ROOT/rovtexture.h \
+    $$ROOT/assetloader.h \
+    $$ROOT/startuptrace.h
+
+RESOURCES += \
+    $$ROOT/shaders.qrc \
+    $$ROOT/textures.qrc \
+    $$ROOT/otherresources.qrc
@@ -0,0 +1,237 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Records a synthetic session the way MainWindow does (frames from
+// the video thread, "pose" and "depth" records from the telemetry)
+// then reads it back with SessionReader, as a playback view would:
+//  - one step every 5 ms: a frame (sizes from 2 kB to 62 kB, one of
+//    1.5 MiB every 50 steps, to span several recorder chunks), the
+//    pose of sensor 0, every 3 steps the pose of sensor 1, every
+//    2 steps the depth;
+//  - 250 ms segments, so that seeks cross segment files;
+//  - then, at times between steps, forwards and backwards, checks
+//    that the frame bytes, the poses and the depth are those of the
+//    last step not after that time.
+// Exits with an error at the first mismatch.
+//
+// Options:
+//   --steps <n>   steps recorded (default 200)
+//   --keep <dir>  write the session there and leave it
+
+#include <QCoreApplication>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QThread>
+#include <QDir>
+#include <stdio.h>
+#include <math.h>
+
+#include "streamrecorder.h"
+#include "sessionreader.h"
+#include "sessionclock.h"
+#include "posestore.h"
+
+
+static const qint64 stepTime = 5000000;// ns
+
+
+struct Step {
+  qint64 time;// ns since the session start, as measured here
+  int    frameSize;
+  bool   bSensor1;
+  bool   bDepth;
+};
+
+
+static QByteArray
+frameBytes(int step, int size) {
+  QByteArray frame(size, 0);
+  for(int j=0; j<size; j++)
+    frame[j] = char((step*31 + j) & 0xFF);
+  return frame;
+}
+
+
+// Exactly representable in the records: 'g', 7 for poses, 'f', 3 for depths
+static float poseValue(int step, int sensor, int k) { return float((step*7 + sensor*3 + k) % 1000)/1000.0f; }
+static float depthValue(int step)                   { return float(step)*0.125f; }
+static float speedValue(int step)                   { return float(step % 16)*0.25f - 2.0f; }
+
+
+static QByteArray
+poseRecord(int step, int sensor) {
+  QByteArray record = "pose," + QByteArray::number(sensor);
+  for(int k=0; k<7; k++)
+    record += ',' + QByteArray::number(poseValue(step, sensor, k), 'g', 7);
+  return record;
+}
+
+
+static bool
+check(bool bCondition, const char* pWhat, qint64 time) {
+  if(!bCondition)
+    fprintf(stderr, "ERROR at %.3f ms: %s\n", time*1.0e-6, pWhat);
+  return bCondition;
+}
+
+
+// The state of the dive expected at "time": last step not after it
+static bool
+checkAt(SessionReader& reader, const QVector<Step>& steps, qint64 time) {
+  int last = -1;
+  for(int i=0; i<steps.size() && steps.at(i).time <= time; i++)
+    last = i;
+  QByteArray jpeg;
+  bool bFrame = reader.videoFrameAt(time, jpeg);
+  if(last < 0)
+    return check(!bFrame, "a frame before the first one", time);
+  if(!check(bFrame, "no frame", time) ||
+     !check(jpeg == frameBytes(last, steps.at(last).frameSize), "wrong frame bytes", time))
+    return false;
+
+  PoseStore poses;
+  if(!check(reader.posesAt(time, poses), "no pose", time))
+    return false;
+  int last1 = last;
+  while(last1 >= 0 && !steps.at(last1).bSensor1)
+    last1--;
+  for(int sensor=0; sensor<2; sensor++) {
+    int step = sensor == 0 ? last : last1;
+    if(step < 0) {
+      if(!check(poses.count() < 2, "a pose of sensor 1 before the first one", time)) return false;
+      continue;
+    }
+    if(!check(poses.count() > sensor, "a sensor missing", time)) return false;
+    const float* values[7] = { poses.qw(), poses.qx(), poses.qy(), poses.qz(),
+                               poses.px(), poses.py(), poses.pz() };
+    for(int k=0; k<7; k++)
+      if(!check(fabsf(values[k][sensor] - poseValue(step, sensor, k)) < 1.0e-6f, "wrong pose", time))
+        return false;
+  }
+
+  int lastDepth = last;
+  while(lastDepth >= 0 && !steps.at(lastDepth).bDepth)
+    lastDepth--;
+  float depth, speed;
+  bool bDepth = reader.depthAt(time, depth, speed);
+  if(lastDepth < 0)
+    return check(!bDepth, "a depth before the first one", time);
+  return check(bDepth, "no depth", time) &&
+         check(depth == depthValue(lastDepth) && speed == speedValue(lastDepth), "wrong depth", time);
+}
+
+
+int
+main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  SessionClock::start();
+
+  int nSteps = 200;
+  QString sDirectory;
+  QStringList args = app.arguments();
+  for(int i=1; i<args.count(); i++) {
+    if(args.at(i) == "--steps" && i+1 < args.count())
+      nSteps = qMax(1, args.at(++i).toInt());
+    else if(args.at(i) == "--keep" && i+1 < args.count())
+      sDirectory = args.at(++i);
+  }
+  QTemporaryDir temporaryDir;
+  if(sDirectory.isEmpty())
+    sDirectory = temporaryDir.path();
+  QDir().mkpath(sDirectory);
+  QString sPrefix = sDirectory + "/ROV_bench";
+
+  // Recording
+  QVector<Step> steps;
+  qint64 framesDropped = 0;
+  {
+    StreamRecorder recorder;
+    recorder.setSegmentDuration(250000000);
+    qint64 start = SessionClock::now();
+    if(!recorder.start(sPrefix)) {
+      fprintf(stderr, "Unable to record to %s\n", qPrintable(sPrefix));
+      return 1;
+    }
+    for(int i=0; i<nSteps; i++) {
+      qint64 due = start + (i+1)*stepTime;
+      qint64 now = SessionClock::now();
+      if(due > now)
+        QThread::usleep(ulong((due-now)/1000));
+      Step step;
+      step.time      = SessionClock::now() - start;
+      step.frameSize = i % 50 == 49 ? 1536*1024 : 2000 + (i*7919) % 60000;
+      step.bSensor1  = i % 3 == 0;
+      step.bDepth    = i % 2 == 0;
+      QByteArray frame = frameBytes(i, step.frameSize);
+      recorder.frameParsed(reinterpret_cast<const unsigned char*>(frame.constData()),
+                           size_t(frame.size()), double(i));
+      recorder.addRecord(poseRecord(i, 0));
+      if(step.bSensor1)
+        recorder.addRecord(poseRecord(i, 1));
+      if(step.bDepth)
+        recorder.addRecord("depth," + QByteArray::number(depthValue(i), 'f', 2) + ',' +
+                           QByteArray::number(depthValue(i), 'f', 3) + ',' +
+                           QByteArray::number(speedValue(i), 'f', 3));
+      recorder.addRecord("control,2,5");// Not read back
+      steps.append(step);
+    }
+    recorder.stop();
+    framesDropped = recorder.framesDropped();
+  }// Waits for the writer
+  if(framesDropped > 0) {
+    fprintf(stderr, "ERROR: %lld frames dropped by the recorder\n", (long long)framesDropped);
+    return 1;
+  }
+
+  // Playback
+  SessionReader reader;
+  QElapsedTimer timer;
+  timer.start();
+  if(!reader.open(sPrefix + ".session")) {
+    fprintf(stderr, "ERROR: %s\n", qPrintable(reader.errorString()));
+    return 1;
+  }
+  double openTime = timer.nsecsElapsed()*1.0e-6;
+  int nSegments = 0;
+  while(QFile::exists(QString("%1_%2.idx").arg(sPrefix).arg(nSegments, 3, 10, QChar('0'))))
+    nSegments++;
+  if(!check(reader.videoFrames() == nSteps, "frames missing from the index", 0))
+    return 1;
+
+  // Half way between steps, so that the few us between the clock read
+  // here and in the recorder do not matter; then backwards, across
+  // the segments; then before the first step and after the last one
+  QVector<qint64> times;
+  int probes[] = { 0, 1, 2, 37, 49, 50, 99, 150, nSteps-1 };
+  for(size_t i=0; i<sizeof(probes)/sizeof(probes[0]); i++)
+    if(probes[i] < nSteps)
+      times.append(steps.at(probes[i]).time + stepTime/2);
+  for(int i=nSteps-1; i>=0; i-=7)
+    times.append(steps.at(i).time + stepTime/2);
+  times.append(steps.first().time - stepTime/2);
+  times.append(steps.last().time + 10*stepTime);
+
+  timer.restart();
+  for(int i=0; i<times.size(); i++)
+    if(!checkAt(reader, steps, times.at(i)))
+      return 1;
+  double checkTime = timer.nsecsElapsed()*1.0e-6;
+
+  printf("%d steps, %d segments, %d frames, session of %.1f ms\n",
+         nSteps, nSegments, reader.videoFrames(), reader.duration()*1.0e-6);
+  printf("open: %.2f ms, %d seeks checked: %.3f ms each\n",
+         openTime, times.size(), checkTime/times.size());
+  printf("OK\n");
+  return 0;
+}
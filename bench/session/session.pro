@@ -0,0 +1,39 @@
+#-------------------------------------------------
+#
+# Records a synthetic dive through StreamRecorder
+# and reads it back through SessionReader: checks
+# the frames, poses and depths found at a few
+# times and reports the cost of open and seeks.
+#
+#-------------------------------------------------
+
+TARGET = SessionBench
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= app_bundle
+
+QT       += core
+QT       -= gui
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/streamrecorder.cpp \
+    $$ROOT/sessionreader.cpp \
+    $$ROOT/sessionclock.cpp \
+    $$ROOT/posestore.cpp \
+    $$ROOT/posekernel.cpp \
+    $$ROOT/logger.cpp \
+    $$ROOT/logring.cpp
+
+HEADERS  += \
+    $$ROOT/streamrecorder.h \
+    $$ROOT/sessionreader.h \
+    $$ROOT/sessionclock.h \
+    $$ROOT/mjpegparser.h \
+    $$ROOT/posestore.h \
+    $$ROOT/posekernel.h \
+    $$ROOT/simdops.h \
+    $$ROOT/logger.h \
+    $$ROOT/logring.h
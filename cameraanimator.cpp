@@ -0,0 +1,152 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "cameraanimator.h"
+
+#include <math.h>
+
+
+static const double nsPerSecond = 1.0e9;
+static const qint64 maxStep     = 100000000;// A stalled frame does not make it jump
+static const float  tolerance   = 1.0e-4f;  // Relative to the distance, and in rad
+
+
+static QQuaternion
+orientation(const CGrCamera& camera) {
+  const float* q = camera.Orientation();
+  return QQuaternion(q[0], q[1], q[2], q[3]);
+}
+
+
+// Angle in rad of the shortest rotation from a to b
+static float
+arcBetween(const QQuaternion& a, const QQuaternion& b) {
+  float d = qBound(0.0f, qAbs(QQuaternion::dotProduct(a, b)), 1.0f);
+  return float(2.0*acos(d));
+}
+
+
+// Critically damped spring with angular frequency omega, integrated
+// exactly over dt: x(t) = (x0 + (v0 + omega x0) t) exp(-omega t)
+// around the target.
+static float
+spring(float& value, float& velocity, float target, float omega, float dt, float decay) {
+  float change = value - target;
+  float temp   = (velocity + omega*change) * dt;
+  velocity = (velocity - omega*temp) * decay;
+  value    = target + (change + temp) * decay;
+  return qAbs(value - target);
+}
+
+
+CameraAnimator::CameraAnimator(CGrCamera* pCamera)
+  : pCamera(pCamera)
+  , bAnimating(false)
+  , lastTime(0)
+  , smoothTime(150000000)// 150 ms
+  , distanceVelocity(0.0f)
+  , arc(0.0f)
+  , progress(1.0f)
+  , progressVelocity(0.0f)
+{
+}
+
+
+void
+CameraAnimator::setSmoothTime(qint64 ns) {
+  smoothTime = qMax(ns, qint64(1));
+}
+
+
+const CGrCamera&
+CameraAnimator::target() const {
+  return bAnimating ? goal : *pCamera;
+}
+
+
+void
+CameraAnimator::animateTo(const CGrCamera& to, qint64 time) {
+  float angularSpeed = 0.0f;
+  if(bAnimating)
+    angularSpeed = progressVelocity * arc;
+  else {
+    lastTime         = time;
+    centerVelocity   = QVector3D();
+    distanceVelocity = 0.0f;
+  }
+  goal = to;
+  fromOrientation  = orientation(*pCamera);
+  arc              = arcBetween(fromOrientation, orientation(goal));
+  progress         = 0.0f;
+  progressVelocity = arc > tolerance ? angularSpeed/arc : 0.0f;
+  bAnimating = true;
+}
+
+
+void
+CameraAnimator::stop() {
+  bAnimating = false;
+}
+
+
+bool
+CameraAnimator::isAnimating() const {
+  return bAnimating;
+}
+
+
+bool
+CameraAnimator::advance(qint64 time) {
+  if(!bAnimating) return false;
+
+  float dt    = float(qBound(qint64(0), time - lastTime, maxStep) / nsPerSecond);
+  float omega = float(2.0*nsPerSecond/smoothTime);
+  float decay = float(exp(-omega*dt));
+  lastTime = time;
+
+  const float* c = pCamera->Center();
+  const float* g = goal.Center();
+  float center[3] = { c[0], c[1], c[2] };
+  float velocity[3] = { centerVelocity.x(), centerVelocity.y(), centerVelocity.z() };
+  float goalDistance = goal.CameraDistance();
+  float distance     = pCamera->CameraDistance();
+  float scale = qMax(goalDistance, 1.0f);
+
+  float error = 0.0f;
+  for(int i=0; i<3; i++)
+    error = qMax(error, spring(center[i], velocity[i], g[i], omega, dt, decay) / scale);
+  error = qMax(error, spring(distance, distanceVelocity, goalDistance, omega, dt, decay) / scale);
+  error = qMax(error, spring(progress, progressVelocity, 1.0f, omega, dt, decay) * arc);
+  centerVelocity = QVector3D(velocity[0], velocity[1], velocity[2]);
+
+  // Still moving fast enough to leave the tolerance?
+  float seconds = float(smoothTime/nsPerSecond);
+  error = qMax(error, centerVelocity.length() * seconds / scale);
+  error = qMax(error, qAbs(distanceVelocity) * seconds / scale);
+  error = qMax(error, qAbs(progressVelocity) * seconds * arc);
+
+  if(error < tolerance) {
+    pCamera->Set3dv(goal.Eye(), goal.Center(), goal.Up());
+    bAnimating = false;
+    return false;
+  }
+
+  // The camera Z axis goes from the center to the eye, its Y axis is down
+  QQuaternion q = QQuaternion::slerp(fromOrientation, orientation(goal), progress);
+  QVector3D eye = QVector3D(center[0], center[1], center[2]) + q.rotatedVector(QVector3D(0.0f, 0.0f, distance));
+  QVector3D up  = -q.rotatedVector(QVector3D(0.0f, 1.0f, 0.0f));
+  pCamera->Set(eye.x(),   eye.y(),   eye.z(),
+               center[0], center[1], center[2],
+               up.x(),    up.y(),    up.z());
+  return true;
+}
@@ -0,0 +1,47 @@
+#ifndef CAMERAANIMATOR_H
+#define CAMERAANIMATOR_H
+
+#include <QtGlobal>
+#include <QVector3D>
+#include <QQuaternion>
+
+#include "GrCamera.h"
+
+
+// Moves a camera smoothly toward a target view instead of cutting.
+//
+// The center and the distance from it follow critically damped
+// springs, the orientation slerps along the shortest arc with the
+// same spring on the fraction covered. The springs are integrated
+// in closed form, so the motion does not depend on the frame rate.
+// A new target taken while moving keeps the current velocities.
+//
+// Times are in ns on the clock of the caller (the render scheduler).
+class CameraAnimator
+{
+public:
+  explicit CameraAnimator(CGrCamera* pCamera);
+
+  void setSmoothTime(qint64 ns);// About the time to cover 60% of the way
+
+  const CGrCamera& target() const;// Where the camera is going (or is)
+  void animateTo(const CGrCamera& to, qint64 time);
+  void stop();// Leaves the camera where it is
+  bool advance(qint64 time);// Moves the camera: true until it has arrived
+  bool isAnimating() const;
+
+private:
+  CGrCamera*  pCamera;
+  CGrCamera   goal;
+  bool        bAnimating;
+  qint64      lastTime;
+  qint64      smoothTime;
+  QVector3D   centerVelocity;
+  float       distanceVelocity;
+  QQuaternion fromOrientation;
+  float       arc;// rad, from fromOrientation to the goal
+  float       progress;// Along the arc, from 0 to 1
+  float       progressVelocity;
+};
+
+#endif // CAMERAANIMATOR_H
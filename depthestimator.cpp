@@ -0,0 +1,104 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "depthestimator.h"
+
+
+static const double nsPerSecond = 1.0e9;
+
+
+// The default gains suit the 2 Hz polling of the depth sensor
+// and its 1 cm resolution
+DepthEstimator::DepthEstimator()
+  : alpha(0.5f)
+  , beta(0.2f)
+  , horizon(1000000000)
+  , maxGap(5000000000LL)
+{
+  reset();
+}
+
+
+void
+DepthEstimator::setGains(float newAlpha, float newBeta) {
+  alpha = newAlpha;
+  beta  = newBeta;
+}
+
+
+void
+DepthEstimator::setHorizon(qint64 ns) {
+  horizon = ns;
+}
+
+
+void
+DepthEstimator::reset() {
+  bValid        = false;
+  filteredDepth = 0.0f;
+  speed         = 0.0f;
+  lastTime      = 0;
+}
+
+
+void
+DepthEstimator::addSample(float depth, qint64 timestamp) {
+  qint64 gap = timestamp - lastTime;
+  if(!bValid || gap > maxGap) {
+    filteredDepth = depth;
+    speed         = 0.0f;
+    lastTime      = timestamp;
+    bValid        = true;
+    return;
+  }
+  if(gap <= 0) {// Same instant: only the depth can be refined
+    filteredDepth += alpha * (depth - filteredDepth);
+    return;
+  }
+  float dt = float(gap / nsPerSecond);
+  float predicted = filteredDepth + speed*dt;
+  float residual  = depth - predicted;
+  filteredDepth = predicted + alpha*residual;
+  speed        += (beta/dt)*residual;
+  lastTime      = timestamp;
+}
+
+
+bool
+DepthEstimator::isValid() const {
+  return bValid;
+}
+
+
+float
+DepthEstimator::depth() const {
+  return filteredDepth;
+}
+
+
+float
+DepthEstimator::verticalSpeed() const {
+  return speed;
+}
+
+
+float
+DepthEstimator::prediction() const {
+  return predict(lastTime + horizon);
+}
+
+
+float
+DepthEstimator::predict(qint64 time) const {
+  return filteredDepth + speed*float((time - lastTime)/nsPerSecond);
+}
@@ -0,0 +1,41 @@
+#ifndef DEPTHESTIMATOR_H
+#define DEPTHESTIMATOR_H
+
+#include <QtGlobal>
+
+
+// Fixed gain alpha-beta tracker of the vehicle depth.
+//
+// Every sample updates the filtered depth and the vertical speed in
+// O(1), without allocations. Depths are in m (positive downwards),
+// speeds in m/s and times in ns on the caller's monotonic clock.
+class DepthEstimator
+{
+public:
+  DepthEstimator();
+
+  void setGains(float alpha, float beta);
+  void setHorizon(qint64 ns);// Of prediction()
+  void reset();
+
+  void addSample(float depth, qint64 timestamp);
+
+  bool  isValid() const;
+  float depth() const;        // Filtered, at the last sample
+  float verticalSpeed() const;// Positive going down
+  float prediction() const;   // Depth "horizon" after the last sample
+  float predict(qint64 time) const;
+
+private:
+  float  alpha;
+  float  beta;
+  qint64 horizon;
+  qint64 maxGap;// Longer gaps restart the filter
+
+  bool   bValid;
+  float  filteredDepth;
+  float  speed;
+  qint64 lastTime;
+};
+
+#endif // DEPTHESTIMATOR_H
@@ -1,3 +1,5 @@
+#version 330 core
+
 // Interpolated values from the vertex shaders
 in vec4 Position_worldspace;
 in vec4 Normal_cameraspace;
@@ -8,7 +10,10 @@ in vec4 LightDirection_cameraspace;
 uniform vec4 LightPosition_worldspace;
 uniform sampler2D qt_Texture0;
 
-varying vec2 qt_TexCoord0;
+in vec2 qt_TexCoord0;
+
+// Output data
+out vec4 fragColor;
 
 void
 main() {
@@ -18,7 +23,7 @@ main() {
   float LightPower = 5000.0*5000.0;
 
   // Material properties
-  vec4 MaterialDiffuseColor  = texture2D(qt_Texture0, qt_TexCoord0.st);
+  vec4 MaterialDiffuseColor  = texture(qt_Texture0, qt_TexCoord0.st);
   vec4 MaterialAmbientColor  = vec4(0.2, 0.2, 0.2, 1.0) * MaterialDiffuseColor;
   vec4 MaterialSpecularColor = vec4(0.1, 0.1, 0.1, 1.0);
 
@@ -36,7 +41,7 @@ main() {
   //  - light is at the vertical of the triangle -> 1
   //  - light is perpendicular to the triangle -> 0
   //  - light is behind the triangle -> 0
-  float cosTheta = clamp(dot(n, l), 0, 1);
+  float cosTheta = clamp(dot(n, l), 0.0, 1.0);
 
   // Eye vector (towards the camera)
   vec4 E = normalize(EyeDirection_cameraspace);
@@ -48,9 +53,9 @@ main() {
   // clamped to 0
   //  - Looking into the reflection -> 1
   //  - Looking elsewhere -> < 1
-  float cosAlpha = clamp(dot(E, R), 0, 1);
+  float cosAlpha = clamp(dot(E, R), 0.0, 1.0);
 
-  gl_FragColor =
+  fragColor =
     // Ambient : simulates indirect lighting
     MaterialAmbientColor +
     // Diffuse : "color" of the object
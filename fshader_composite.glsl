@@ -0,0 +1,13 @@
+#version 330 core
+
+// Frame rendered by the rendering thread
+uniform sampler2D frameTexture;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void
+main() {
+    fragColor = texture(frameTexture, texCoord);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+// Planes of the decoded JPEG: full range BT.601 YCbCr (JFIF)
+uniform sampler2D yTexture;
+uniform sampler2D cbTexture;
+uniform sampler2D crTexture;
+
+in vec2 texCoord;
+
+out vec4 fragColor;
+
+void
+main() {
+    vec2 uv = vec2(texCoord.x, 1.0 - texCoord.y);// Rows come top first
+    float y  = texture(yTexture,  uv).r;
+    float cb = texture(cbTexture, uv).r - 0.5;
+    float cr = texture(crTexture, uv).r - 0.5;
+    fragColor = vec4(y + 1.402*cr,
+                     y - 0.344136*cb - 0.714136*cr,
+                     y + 1.772*cb,
+                     1.0);
+}
@@ -43,11 +43,26 @@
 #include <QVector2D>
 #include <QVector3D>
 #include <QFile>
+#include <QDebug>
 #include <float.h>
 
 
+// Floats per instance: model matrix followed by normal matrix
+// (SceneGraph::instanceStride)
+static const int instanceStride = 32;
+
+
+MeshData::MeshData()
+  : min(0.0)
+  , max(0.0)
+  , bValid(false)
+{
+}
+
+
 GeometryEngine::GeometryEngine()
   : objPath(":/ROV_2.obj")
+  , instancebuffer(QOpenGLBuffer::VertexBuffer)
 {
 }
 
@@ -56,14 +71,13 @@ GeometryEngine::~GeometryEngine() {
   vertexbuffer.destroy();
   uvbuffer.destroy();
   normalbuffer.destroy();
+  instancebuffer.destroy();
+  vao.destroy();
 }
 
 
 bool
-GeometryEngine::loadROVobj(QString path,
-                        QVector<QVector3D> &out_vertices,
-                        QVector<QVector2D> &out_uvs,
-                        QVector<QVector3D> &out_normals)
+GeometryEngine::loadROVobj(QString path, MeshData& mesh)
 {
   QFile file(path);
   if(!file.open(QIODevice::ReadOnly)) {
@@ -75,8 +89,8 @@ GeometryEngine::loadROVobj(QString path,
   QVector<QVector2D> temp_uvs;
   QVector<QVector3D> temp_normals;
   float x, y, z;
-  min =  FLT_MAX;
-  max = -FLT_MAX;
+  mesh.min =  FLT_MAX;
+  mesh.max = -FLT_MAX;
 
   QByteArray line;
   QString string;
@@ -123,12 +137,12 @@ GeometryEngine::loadROVobj(QString path,
       y = stringVals.at(1).toFloat();
       z = stringVals.at(2).toFloat();
       temp_vertices.append(QVector3D(x, y, z));
-      if(x < min) min = x;
-      if(x > max) max = x;
-      if(y < min) min = y;
-      if(y > max) max = y;
-      if(z < min) min = z;
-      if(z > max) max = z;
+      if(x < mesh.min) mesh.min = x;
+      if(x > mesh.max) mesh.max = x;
+      if(y < mesh.min) mesh.min = y;
+      if(y > mesh.max) mesh.max = y;
+      if(z < mesh.min) mesh.min = z;
+      if(z > mesh.max) mesh.max = z;
     }
 
     else if(line.startsWith("f")) {// is a face
@@ -156,7 +170,7 @@ GeometryEngine::loadROVobj(QString path,
       // Probably a comment skip the rest of the line
   }
   file.close();
-//  qDebug() << min << max;
+//  qDebug() << mesh.min << mesh.max;
 
   // For each vertex of each triangle
   for(int i=0; i<vertexIndices.size(); i++) {
@@ -167,8 +181,8 @@ GeometryEngine::loadROVobj(QString path,
     QVector3D vertex = temp_vertices[ vertexIndex-1 ];
     QVector3D normal = temp_normals[ normalIndex-1 ];
     // Put the attributes in buffers
-    out_vertices.append(vertex);
-    out_normals .append(normal);
+    mesh.vertices.append(vertex);
+    mesh.normals.append(normal);
   }
 
   if(!temp_uvs.isEmpty()) {
@@ -179,37 +193,69 @@ GeometryEngine::loadROVobj(QString path,
         // Get the attributes thanks to the index
       QVector2D uv = temp_uvs[ uvIndex-1 ];
         // Put the attributes in buffers
-      out_uvs.append(uv);
+      mesh.uvs.append(uv);
     }
   }
   return true;
 }
 
 
-void
-GeometryEngine::init() {
-  if(!loadROVobj(objPath, vertices, uvs, normals)) {
+// Decode the obj file. It does not touch OpenGL so
+// it can run in a worker thread while the GUI starts.
+MeshData
+GeometryEngine::loadROVMesh(const QString& path) {
+  MeshData mesh;
+  mesh.bValid = loadROVobj(path, mesh);
+  if(!mesh.bValid)
     qDebug() << "Impossible to decode obj file";
-    exit(-1);
-  }
-  initializeGLFunctions();
+  return mesh;
+}
+
+
+bool
+GeometryEngine::init() {
+  return init(loadROVMesh(objPath));
+}
+
+
+// Upload an already decoded mesh. The OpenGL context must be current.
+bool
+GeometryEngine::init(const MeshData& mesh) {
+  if(!mesh.bValid)
+    return false;
+  vertices = mesh.vertices;
+  uvs      = mesh.uvs;
+  normals  = mesh.normals;
+  min      = mesh.min;
+  max      = mesh.max;
+  initializeOpenGLFunctions();
   // Initializes cube geometry and transfers it to VBOs
   initROVGeometry();
+  return true;
 }
 
 
+// The whole attribute layout is recorded once in the vertex array
+// object: the shaders use fixed locations (see attributeLocation)
 void
 GeometryEngine::initROVGeometry() {
+  vao.create();
+  QOpenGLVertexArrayObject::Binder vaoBinder(&vao);
+
   // Transfer vertex data to VBO 0
   vertexbuffer.create();
   vertexbuffer.bind();
   vertexbuffer.allocate((void *)vertices.data(), vertices.size() * sizeof(QVector3D));
+  glEnableVertexAttribArray(vertexLocation);
+  glVertexAttribPointer(vertexLocation, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), 0);
 
   if(normals.size() > 0) {
     normalbuffer.create();
     // Transfer normal data to VBO 1
     normalbuffer.bind();
     normalbuffer.allocate((void *)normals.data(), normals.size() * sizeof(QVector3D));
+    glEnableVertexAttribArray(normalLocation);
+    glVertexAttribPointer(normalLocation, 3, GL_FLOAT, GL_FALSE, sizeof(QVector3D), 0);
   }
 
   if(uvs.size() > 0) {
@@ -217,35 +263,60 @@ GeometryEngine::initROVGeometry() {
     // Transfer uv data to VBO 2
     uvbuffer.bind();
     uvbuffer.allocate((void *)uvs.data(), uvs.size() * sizeof(QVector2D));
+    glEnableVertexAttribArray(texcoordLocation);
+    glVertexAttribPointer(texcoordLocation, 2, GL_FLOAT, GL_FALSE, sizeof(QVector2D), 0);
   }
-}
-
-
-void
-GeometryEngine::drawROVGeometry(QGLShaderProgram *program) {
-  // Tell OpenGL programmable pipeline how to locate vertex position data
-  vertexbuffer.bind();
-  int vertexLocation = program->attributeLocation("qt_Vertex");
-  program->enableAttributeArray(vertexLocation);
-  program->setAttributeBuffer(vertexLocation, GL_FLOAT, 0, 3, sizeof(QVector3D));
 
-  if(uvs.size() > 0) {
-    // Tell OpenGL programmable pipeline how to locate vertex texture coordinate data
-    uvbuffer.bind();
-    int texcoordLocation = program->attributeLocation("qt_MultiTexCoord0");
-    program->enableAttributeArray(texcoordLocation);
-    program->setAttributeBuffer(texcoordLocation, GL_FLOAT, 0, 2, sizeof(QVector2D));
+  // A mat4 attribute takes four consecutive locations, one per column.
+  // They advance once per instance and are ignored by the non
+  // instanced shader.
+  instancebuffer.create();
+  instancebuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+  instancebuffer.bind();
+  for(int col=0; col<4; col++) {
+    glEnableVertexAttribArray(instanceModelLocation+col);
+    glVertexAttribPointer(instanceModelLocation+col, 4, GL_FLOAT, GL_FALSE,
+                          instanceStride*sizeof(GLfloat),
+                          (void *)((col*4)*sizeof(GLfloat)));
+    glVertexAttribDivisor(instanceModelLocation+col, 1);
+    glEnableVertexAttribArray(instanceNormalLocation+col);
+    glVertexAttribPointer(instanceNormalLocation+col, 4, GL_FLOAT, GL_FALSE,
+                          instanceStride*sizeof(GLfloat),
+                          (void *)((16+col*4)*sizeof(GLfloat)));
+    glVertexAttribDivisor(instanceNormalLocation+col, 1);
   }
+  instancebuffer.release();
+}
 
-  if(normals.size() > 0) {
-      // Tell OpenGL programmable pipeline how to locate normals data
-      normalbuffer.bind();
-      int normcoordLocation = program->attributeLocation("vertexNormal_modelspace");
-      program->enableAttributeArray(normcoordLocation);
-      program->setAttributeBuffer(normcoordLocation, GL_FLOAT, 0, 3, sizeof(QVector3D));
-  }
 
+void
+GeometryEngine::drawROVGeometry() {
+  QOpenGLVertexArrayObject::Binder vaoBinder(&vao);
   // Draw ROV geometry
   glDrawArrays(GL_TRIANGLES, 0, vertices.size());
 }
 
+
+// Draw nInstances ROVs with a single draw call. pInstances holds, for
+// each of them, the column-major model matrix followed by the normal
+// matrix (instanceStride floats, as laid out by SceneGraph). They are
+// streamed into the instance buffer and fed to the
+// "instance_modelMatrix" and "instance_normalMatrix" mat4 attributes.
+void
+GeometryEngine::drawROVGeometryInstanced(const GLfloat* pInstances, int nInstances)
+{
+  if(nInstances == 0) return;
+
+  instancebuffer.bind();
+  int bytes = nInstances * instanceStride * sizeof(GLfloat);
+  if(instancebuffer.size() < bytes)
+    instancebuffer.allocate(bytes);
+  else // Orphan the old storage so we don't wait for the previous frame
+    instancebuffer.allocate(instancebuffer.size());
+  instancebuffer.write(0, pInstances, bytes);
+  instancebuffer.release();
+
+  // Draw all the ROVs at once
+  QOpenGLVertexArrayObject::Binder vaoBinder(&vao);
+  glDrawArraysInstanced(GL_TRIANGLES, 0, vertices.size(), nInstances);
+}
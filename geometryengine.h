@@ -41,29 +41,59 @@
 #ifndef GEOMETRYENGINE_H
 #define GEOMETRYENGINE_H
 
-#include <QGLFunctions>
-#include <QGLShaderProgram>
+#include <QOpenGLFunctions_3_3_Core>
 #include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
 
-class GeometryEngine : protected QGLFunctions
+// The ROV model as decoded from its obj file
+struct MeshData
+{
+  MeshData();
+
+  QVector<QVector3D> vertices;
+  QVector<QVector2D> uvs;
+  QVector<QVector3D> normals;
+  float min;// Smallest and largest coordinate
+  float max;
+  bool  bValid;
+};
+
+
+class GeometryEngine : protected QOpenGLFunctions_3_3_Core
 {
 public:
   GeometryEngine();
   virtual ~GeometryEngine();
 
-  void init();
-  void drawROVGeometry(QGLShaderProgram *program);
+  // Vertex attribute locations shared by all the ROV shaders
+  enum attributeLocation {
+    vertexLocation         = 0,
+    normalLocation         = 1,
+    texcoordLocation       = 2,
+    instanceModelLocation  = 3,// mat4: 3, 4, 5, 6
+    instanceNormalLocation = 7 // mat4: 7, 8, 9, 10
+  };
+
+  static MeshData loadROVMesh(const QString& path);// Thread safe, no OpenGL
+
+  bool init();
+  bool init(const MeshData& mesh);
+  void drawROVGeometry();
+  void drawROVGeometryInstanced(const GLfloat* pInstances, int nInstances);
   float min;
   float max;
   QString objPath;
 
 private:
-  bool loadROVobj(QString path, QVector<QVector3D>& out_vertices, QVector<QVector2D>& out_uvs, QVector<QVector3D>& out_normals);
+  static bool loadROVobj(QString path, MeshData& mesh);
   void initROVGeometry();
 
+  QOpenGLVertexArrayObject vao;
   QOpenGLBuffer vertexbuffer;
   QOpenGLBuffer uvbuffer;
   QOpenGLBuffer normalbuffer;
+  QOpenGLBuffer instancebuffer;// Per instance model and normal matrices
 
   QVector<QVector3D> vertices;
   QVector<QVector2D> uvs;
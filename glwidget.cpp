@@ -39,29 +39,57 @@
 ****************************************************************************/
 
 #include <QtWidgets>
-#include <QtOpenGL>
+#include <QOpenGLContext>
 
-#include <fstream>
 #include <math.h>
 
 #include "glwidget.h"
-//#include "text.h"
-#include "shimmer3box.h"
+#include "threadedrenderer.h"
+#include "shadercache.h"
+#include "startuptrace.h"
+#include "posestore.h"
+#include "posepredictor.h"
 
 #define NO_MOUSE
 
-GLWidget::GLWidget(CGrCamera* myCamera, QWidget *parent)
-  : QGLWidget(QGLFormat(QGL::SampleBuffers), parent)
+
+GLWidget::GLWidget(CGrCamera* myCamera, QWidget *parent, bool threadedRendering)
+  : QOpenGLWidget(parent)
   , fromSide(GLWidget::front)
-  , shimmerSensors(NULL)
+  , pPoses(NULL)
+  , pPredictor(NULL)
+  , useInstancing(true)
   , sLabel(tr("Front"))
   , camera(myCamera)
+  , pVideo(NULL)
+  , bThreadedRendering(threadedRendering)
+  , pAssets(NULL)
+  , pRenderer(NULL)
+  , pThreadedRenderer(NULL)
+  , scheduler(this)
+  , animator(myCamera)
 {
   lightPos = QVector4D(0, 4000, 4000, 1.0);
+  setFormat(surfaceFormat());
+  connect(&scheduler, SIGNAL(frameDue()), this, SLOT(onFrameDue()));
 }
 
 
 GLWidget::~GLWidget() {
+  cleanup();
+}
+
+
+// OpenGL 3.3 core, multisampled and synchronized with the display refresh
+QSurfaceFormat
+GLWidget::surfaceFormat() {
+  QSurfaceFormat format;
+  format.setVersion(3, 3);
+  format.setProfile(QSurfaceFormat::CoreProfile);
+  format.setDepthBufferSize(24);
+  format.setSamples(4);
+  format.setSwapInterval(1);
+  return format;
 }
 
 
@@ -78,169 +106,188 @@ GLWidget::sizeHint() const {
 
 
 void
-GLWidget::setShimmerBoxes(QVector<Shimmer3Box*>* shimmer3Boxes) {
-  shimmerSensors = shimmer3Boxes;
+GLWidget::setPoseStore(const PoseStore* pPoseStore) {
+  pPoses = pPoseStore;
 }
 
 
+// The poses are extrapolated by pPosePredictor, if given,
+// to hide the telemetry rate and latency
 void
-GLWidget::initializeGL() {
-  initializeGLFunctions();
-  initShaders();
-  initTextures();
+GLWidget::setPosePredictor(const PosePredictor* pPosePredictor) {
+  pPredictor = pPosePredictor;
+}
+
+
+// The mesh and the skin are taken from pAssetLoader, if given,
+// instead of being decoded by initializeGL()
+void
+GLWidget::setAssetLoader(const AssetLoader* pAssetLoader) {
+  pAssets = pAssetLoader;
+}
 
-  glClearColor(0.1, 0.1, 0.5, 0.0);
 
-  glEnable(GL_DEPTH_TEST);// Enable depth test
-  glDepthFunc(GL_LESS);// Accept fragment if it closer to the camera than the former one
-  glCullFace(GL_BACK);
-  glEnable(GL_CULL_FACE);// Cull triangles whose normal is not towards the camera
-  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-  glShadeModel(GL_SMOOTH);
-  glEnable(GL_MULTISAMPLE);
+// The video, if given, is drawn behind the model in the same pass.
+// New video frames must be signaled with scheduleUpdate().
+void
+GLWidget::setVideoSource(VideoSource* pVideoSource) {
+  pVideo = pVideoSource;
+  scheduleUpdate();
+}
 
-  geometries.init();
 
+// Ask for a repaint. Requests are merged and served
+// at most once per display refresh.
+void
+GLWidget::scheduleUpdate() {
+  scheduler.requestFrame();
 }
 
 
 void
-GLWidget::initShaders() {
-  // Compile vertex shader
-  if(!program.addShaderFromSourceFile(QGLShader::Vertex, ":/vshader.glsl"))
-    close();
-  // Compile fragment shader
-  if(!program.addShaderFromSourceFile(QGLShader::Fragment, ":/fshader.glsl"))
-    close();
-  // Link shader pipeline
-  if(!program.link())
-    close();
-  // Bind shader pipeline for use
-  if(!program.bind())
-    close();
+GLWidget::onFrameDue() {
+  if(pThreadedRenderer)
+    pThreadedRenderer->submitFrame(currentFrame(), size()*devicePixelRatio());
+  else
+    update();
+}
+
+
+// Snapshot of the camera and of the sensor poses, extrapolated
+// to the present time when a predictor is given
+SceneFrame
+GLWidget::currentFrame() {
+  // Keep drawing until the camera has arrived
+  if(animator.advance(scheduler.now()))
+    scheduler.requestFrame();
+
+  SceneFrame frame;
+  // Cached by the camera, column-major as QMatrix4x4 takes it row-major
+  frame.viewMatrix    = QMatrix4x4(camera->ViewMatrix()).transposed();
+  frame.fieldOfView   = camera->FieldOfView();
+  frame.lightPos      = lightPos;
+  frame.useInstancing = useInstancing;
+  frame.pVideo        = pVideo;
+  if(pPoses && pPredictor) {
+    qint64 now = pPredictor->now();
+    pPredictor->predict(*pPoses, now, predictedPoses);
+    frame.poses = predictedPoses;
+    // Keep drawing until the prediction comes to rest
+    if(pPredictor->isExtrapolating(now))
+      scheduler.requestFrame();
+  }
+  else if(pPoses)
+    frame.poses = *pPoses;// Shares the arrays, no copy
+  return frame;
 }
 
 
 void
-GLWidget::initTextures() {
-  // Load the image
-  glEnable(GL_TEXTURE_2D);
-  texture = new QOpenGLTexture(QImage(":/uvUnwrapROV_2.png").mirrored());
-  // Set nearest filtering mode for texture minification
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  texture->setMinificationFilter(QOpenGLTexture::Nearest);
-  // Set bilinear filtering mode for texture magnification
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  texture->setMagnificationFilter(QOpenGLTexture::Linear);
-  // Wrap texture coordinates by repeating
-  // f.ex. texture coordinate (1.1, 1.2) is same as (0.1, 0.2)
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  texture->setWrapMode(QOpenGLTexture::Repeat);
+GLWidget::initializeGL() {
+  initializeOpenGLFunctions();
+  connect(context(), SIGNAL(aboutToBeDestroyed()), this, SLOT(cleanup()));
+
+  if(bThreadedRendering) {
+    initCompositor();
+    pThreadedRenderer = new ThreadedRenderer(context(), pAssets);
+    connect(pThreadedRenderer, SIGNAL(frameReady()), this, SLOT(update()));
+    scheduleUpdate();
+  } else {
+    pRenderer = new SceneRenderer();
+    if(!pRenderer->initialize(pAssets)) {
+      qDebug() << "Unable to initialize the 3D view";
+      delete pRenderer;
+      pRenderer = NULL;
+    }
+  }
+}
+
+
+void
+GLWidget::initCompositor() {
+  ShaderCache shaderCache;
+  shaderCache.buildProgram(&compositeProgram, ":/vshader_composite.glsl", ":/fshader_composite.glsl");
+  // Core profile needs a bound vertex array object even without attributes
+  compositeVao.create();
+}
+
+
+void
+GLWidget::cleanup() {
+  if(!pRenderer && !pThreadedRenderer) return;
+  makeCurrent();
+  delete pThreadedRenderer;
+  pThreadedRenderer = NULL;
+  delete pRenderer;
+  pRenderer = NULL;
+  compositeVao.destroy();
+  doneCurrent();
 }
 
 
 void
 GLWidget::resizeGL(int width, int height) {
-  glViewport(0, 0, width, height);
-  // Projection matrix :
-  projectionMatrix.setToIdentity();
-  projectionMatrix.perspective(camera->FieldOfView(), float(width)/float(height), 0.1f, 100.0f);
+  if(pRenderer)
+    pRenderer->resize(width*devicePixelRatio(), height*devicePixelRatio());
+  else // The rendering thread must produce a frame of the new size
+    scheduleUpdate();
 }
 
 
 void
 GLWidget::paintGL() {
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-  if(shimmerSensors->isEmpty()) return;
-
-  texture->bind();
-
-  // Use our shader
-  glUseProgram(program.programId());
-
-  // Camera matrix
-  viewMatrix.setToIdentity();
-  viewMatrix.lookAt(
-    QVector3D(camera->EyeX(),    camera->EyeY(),    camera->EyeZ()),    // Camera position in World Space
-    QVector3D(camera->CenterX(), camera->CenterY(), camera->CenterZ()), // Looking at the origin
-    QVector3D(camera->UpX(),     camera->UpY(),     camera->UpZ())      // Head is up (set to 0,-1,0 to look upside-down)
-  );
-
-  program.setUniformValue("LightPosition_worldspace", lightPos);
-
-  modelMatrix.setToIdentity();
-
-  Shimmer3Box *pSensor, *pSensor0;
-
-  if(shimmerSensors->count() > 1) {
-    pSensor0 = (*shimmerSensors)[0];
-    // Sensori dipendenti dal primo
-    for(int i=0; i<shimmerSensors->count(); i++) {
-      pSensor = (*shimmerSensors)[i];
-      // save the unrotated coordinate system.
-      matrixStack.prepend(modelMatrix);
-      // Draw the sensor with the right dimensions
-      float scale = 1.0/(geometries.max-geometries.min);
-      modelMatrix.scale(scale, scale, scale);
-      if(i>0) {
-        //Rotate around sensor center
-        modelMatrix.rotate(-pSensor0->angle, pSensor0->x, pSensor0->y, pSensor0->z);
-        modelMatrix.rotate( pSensor->angle, pSensor->x, pSensor->y, pSensor->z);
-      }
-      // Translate sensor in his position
-      modelMatrix.translate(pSensor->pos[0], pSensor->pos[1], pSensor->pos[2]);
-
-      normalMatrix = modelMatrix.inverted().transposed();
-
-      // Set modelview-projection matrix
-      mvpMatrix = projectionMatrix * viewMatrix * modelMatrix;
-
-      program.setUniformValue("mvp_Matrix",   mvpMatrix);
-      program.setUniformValue("view_Matrix",  viewMatrix);
-      program.setUniformValue("model_Matrix", modelMatrix);
-      program.setUniformValue("normal_Matrix", normalMatrix);
-
-      // Draw the ROV
-      geometries.drawROVGeometry(&program);
-      // restore the unrotated coordinate system.
-      modelMatrix = matrixStack.takeFirst();
-    }
+  scheduler.frameRendered();
+  if(pRenderer) {
+    pRenderer->render(currentFrame());
+    StartupTrace::firstFrame();
   }
-  else if(shimmerSensors->count() == 1) {
-    pSensor = (*shimmerSensors)[0];
-    // save the unrotated coordinate system.
-    matrixStack.prepend(modelMatrix);
-    // Draw the sensor with the right dimensions
-    float scale = 1.0/(geometries.max-geometries.min);
-    modelMatrix.scale(scale, scale, scale);
-    // Rotate the sensor according to IMU's information
-    modelMatrix.rotate(pSensor->angle, pSensor->x, pSensor->y, pSensor->z);
-    // Translate sensor in his position
-    modelMatrix.translate(pSensor->pos[0], pSensor->pos[1], pSensor->pos[2]);
-
-    normalMatrix = modelMatrix.inverted().transposed();
-
-    // Set modelview-projection matrix
-    mvpMatrix = projectionMatrix * viewMatrix * modelMatrix;
-
-    program.setUniformValue("mvp_Matrix",   mvpMatrix);
-    program.setUniformValue("view_Matrix",  viewMatrix);
-    program.setUniformValue("model_Matrix", modelMatrix);
-    program.setUniformValue("normal_Matrix", normalMatrix);
-
-    // Draw the ROV
-    geometries.drawROVGeometry(&program);
-    // restore the unrotated coordinate system.
-    modelMatrix = matrixStack.takeFirst();
-
-  }// if(shimmerSensors->count() == 1)
+  else if(pThreadedRenderer) {
+    GLuint frameTexture = pThreadedRenderer->acquireDisplayTexture();
+    composite(frameTexture);
+    if(frameTexture)
+      StartupTrace::firstFrame();
+  }
+}
+
+
+// Draw the frame produced by the rendering thread
+void
+GLWidget::composite(GLuint frameTexture) {
+  glViewport(0, 0, width()*devicePixelRatio(), height()*devicePixelRatio());
+  glClearColor(0.1, 0.1, 0.5, 0.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  if(!frameTexture) return;
+  glDisable(GL_DEPTH_TEST);
+  compositeProgram.bind();
+  compositeProgram.setUniformValue("frameTexture", 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, frameTexture);
+  QOpenGLVertexArrayObject::Binder vaoBinder(&compositeVao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  compositeProgram.release();
 }
 
 
+// Moves the camera around the ROV to look at it from one side,
+// keeping the current center and distance
 void
 GLWidget::setSide(side from) {
+  // Direction of the eye from the center, then up, in GLWidget::side order
+  static const float views[6][6] = {
+    { -1.0f,  0.0f,  0.0f,   0.0f, 0.0f, 1.0f },// front
+    {  1.0f,  0.0f,  0.0f,   0.0f, 0.0f, 1.0f },// rear
+    {  0.0f,  0.0f,  1.0f,  -1.0f, 0.0f, 0.0f },// top
+    {  0.0f, -1.0f,  0.0f,   0.0f, 0.0f, 1.0f },// right
+    {  0.0f,  1.0f,  0.0f,   0.0f, 0.0f, 1.0f },// left
+    {  0.0f,  0.0f, -1.0f,  -1.0f, 0.0f, 0.0f } // bottom
+  };
+  const float* v = views[from];
+  CGrCamera to = animator.target();
+  float d = to.CameraDistance();
+  const float* c = to.Center();
+  to.Set(c[0]+d*v[0], c[1]+d*v[1], c[2]+d*v[2], c[0], c[1], c[2], v[3], v[4], v[5]);
+  animator.animateTo(to, scheduler.now());
+
   fromSide = from;
   if(fromSide == top) {
     sLabel = "Top";
@@ -255,7 +302,7 @@ GLWidget::setSide(side from) {
   } else {
     sLabel = "Front";
   }
-  updateGL();
+  scheduleUpdate();
 }
 
 
@@ -263,6 +310,8 @@ void
 GLWidget::mousePressEvent(QMouseEvent *event) {
   Q_UNUSED(event)
 #ifndef NO_MOUSE
+  // Dragging takes the camera over from any animation
+  animator.stop();
   if (event->buttons() & Qt::RightButton) {
     lastPos = event->pos();
     camera->MouseDown(event->x(), event->y());
@@ -313,10 +362,12 @@ void
 GLWidget::wheelEvent(QWheelEvent* event) {
   QPoint numDegrees = event->angleDelta() / 120;
   if (!numDegrees.isNull()) {
-    camera->MouseDown(0, 0);
-    camera->MouseMode(CGrCamera::ROLLMOVE);
-    camera->MouseMove(0, -numDegrees.y());
-    camera->MouseMode(CGrCamera::PITCHYAW);
+    // The step is applied to the target and the camera glides there
+    CGrCamera to = animator.target();
+    to.MouseDown(0, 0);
+    to.MouseMode(CGrCamera::ROLLMOVE);
+    to.MouseMove(0, -numDegrees.y());
+    animator.animateTo(to, scheduler.now());
     event->accept();
     emit windowUpdated();
   }
@@ -41,36 +41,42 @@
 #ifndef GLWIDGET_H
 #define GLWIDGET_H
 
-#include <QGLWidget>
-#include <QGLFunctions>
-#include <QMatrix4x4>
-#include <QQuaternion>
-#include <QVector3D>
-#include <QVector2D>
-#include <QGLShaderProgram>
-#include <QOpenGLTexture>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <QSurfaceFormat>
+#include <QVector4D>
 
 #include "GrCamera.h"
-#include "geometryengine.h"
+#include "scenerenderer.h"
+#include "renderscheduler.h"
+#include "cameraanimator.h"
 
 
-class Text;
-class Shimmer3Box;
-class BodyModel;
+class PoseStore;
+class PosePredictor;
+class ThreadedRenderer;
+class AssetLoader;
 
 
-class GLWidget : public QGLWidget, protected QGLFunctions
+class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
   Q_OBJECT
 
 public:
-  GLWidget(CGrCamera* myCamera, QWidget *parent = 0);
+  GLWidget(CGrCamera* myCamera, QWidget *parent = 0, bool threadedRendering = false);
   ~GLWidget();
 
+  static QSurfaceFormat surfaceFormat();
+
   QSize minimumSizeHint() const;
   QSize sizeHint() const;
 
-  void setShimmerBoxes(QVector<Shimmer3Box*>* shimmer3Boxes);
+  void setPoseStore(const PoseStore* pPoseStore);
+  void setPosePredictor(const PosePredictor* pPosePredictor);
+  void setAssetLoader(const AssetLoader* pAssetLoader);
+  void setVideoSource(VideoSource* pVideoSource);
   enum side {
     front,
     rear,
@@ -80,8 +86,13 @@ public:
     bottom
   } fromSide;
   void setSide(side from);
-  QVector<Shimmer3Box*>* shimmerSensors;
+  const PoseStore* pPoses;
+  const PosePredictor* pPredictor;
   QVector4D lightPos;
+  bool useInstancing;// Draw all the sensors with a single draw call
+
+public slots:
+  void scheduleUpdate();
 
 signals:
   void xRotationChanged(int angle);
@@ -98,38 +109,30 @@ protected:
   void mouseMoveEvent(QMouseEvent *event);
   void wheelEvent(QWheelEvent* event);
 
-  void initShaders();
-  void initTextures();
+  void initCompositor();
+  void composite(GLuint frameTexture);
 
-//  void drawFrame();
+private slots:
+  void onFrameDue();
+  void cleanup();
 
 private:
-  QString sourceDir;
-  QString shaderMessage;
+  SceneFrame currentFrame();
+
+  PoseStore predictedPoses;
+
   QPoint lastPos;
   QString sLabel;
   CGrCamera* camera;
-
-  QMatrix4x4 projectionMatrix;
-  QMatrix4x4 modelMatrix;
-  QMatrix4x4 normalMatrix;
-  QMatrix4x4 viewMatrix;
-  QMatrix4x4 mvpMatrix;
-  QList<QMatrix4x4> matrixStack;
-
-  QOpenGLTexture* texture;
-  QGLShaderProgram program;
-  GeometryEngine geometries;
-
-  GLuint shimmerVertexBuffer;
-  GLuint shimmerColorBuffer;
-  GLuint programID;
-  GLuint textProgramID;
-  GLuint MatrixID;
-  GLuint Text2DTextureID;
-  GLuint Text2DVertexBufferID;
-  GLuint Text2DUVBufferID;
-  GLuint Text2DShaderID;
-  GLuint Text2DUniformID;
+  VideoSource* pVideo;
+
+  bool bThreadedRendering;
+  const AssetLoader* pAssets;
+  SceneRenderer*    pRenderer;        // Used when rendering in the GUI thread
+  ThreadedRenderer* pThreadedRenderer;// Used when rendering in its own thread
+  QOpenGLShaderProgram     compositeProgram;
+  QOpenGLVertexArrayObject compositeVao;
+  RenderScheduler scheduler;
+  CameraAnimator  animator;// Wheel steps and preset views
 };
 #endif
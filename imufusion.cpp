@@ -0,0 +1,345 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "imufusion.h"
+#include "simdops.h"
+
+#include <algorithm>
+
+
+// S. Madgwick, "An efficient orientation filter for inertial and
+// inertial/magnetic sensor arrays", 2010. The objective function
+// gradient is split in its accelerometer and magnetometer parts:
+// with a null (normalized) magnetometer sample the latter vanishes
+// and what is left is the IMU only update, so every lane can run
+// the same code.
+template<class O>
+static inline void
+madgwickStep(const ImuBatch& b, int i, float betaGain) {
+  typedef typename O::V V;
+  V q0 = O::load(b.q0 + i);
+  V q1 = O::load(b.q1 + i);
+  V q2 = O::load(b.q2 + i);
+  V q3 = O::load(b.q3 + i);
+  V gx = O::load(b.gx + i);
+  V gy = O::load(b.gy + i);
+  V gz = O::load(b.gz + i);
+  V ax = O::load(b.ax + i);
+  V ay = O::load(b.ay + i);
+  V az = O::load(b.az + i);
+  V mx = O::load(b.mx + i);
+  V my = O::load(b.my + i);
+  V mz = O::load(b.mz + i);
+  V dt = O::load(b.dt + i);
+  V half = O::set1(0.5f);
+  V one  = O::set1(1.0f);
+  V two  = O::set1(2.0f);
+  V four = O::set1(4.0f);
+
+  // Rate of change of the quaternion from the gyroscope
+  V qDot0 = O::mul(O::set1(-0.5f), O::add(O::add(O::mul(q1, gx), O::mul(q2, gy)), O::mul(q3, gz)));
+  V qDot1 = O::mul(half, O::sub(O::add(O::mul(q0, gx), O::mul(q2, gz)), O::mul(q3, gy)));
+  V qDot2 = O::mul(half, O::add(O::sub(O::mul(q0, gy), O::mul(q1, gz)), O::mul(q3, gx)));
+  V qDot3 = O::mul(half, O::sub(O::add(O::mul(q0, gz), O::mul(q1, gy)), O::mul(q2, gx)));
+
+  // Normalise the measurements (null ones stay null)
+  V accelNorm2 = O::add(O::add(O::mul(ax, ax), O::mul(ay, ay)), O::mul(az, az));
+  V recipNorm  = O::invSqrtOrZero(accelNorm2);
+  ax = O::mul(ax, recipNorm);
+  ay = O::mul(ay, recipNorm);
+  az = O::mul(az, recipNorm);
+  recipNorm = O::invSqrtOrZero(O::add(O::add(O::mul(mx, mx), O::mul(my, my)), O::mul(mz, mz)));
+  mx = O::mul(mx, recipNorm);
+  my = O::mul(my, recipNorm);
+  mz = O::mul(mz, recipNorm);
+
+  // Auxiliary variables to avoid repeated arithmetic
+  V _2q0 = O::mul(two, q0);
+  V _2q1 = O::mul(two, q1);
+  V _2q2 = O::mul(two, q2);
+  V _2q3 = O::mul(two, q3);
+  V _2q0mx = O::mul(_2q0, mx);
+  V _2q0my = O::mul(_2q0, my);
+  V _2q0mz = O::mul(_2q0, mz);
+  V _2q1mx = O::mul(_2q1, mx);
+  V q0q0 = O::mul(q0, q0);
+  V q0q1 = O::mul(q0, q1);
+  V q0q2 = O::mul(q0, q2);
+  V q0q3 = O::mul(q0, q3);
+  V q1q1 = O::mul(q1, q1);
+  V q1q2 = O::mul(q1, q2);
+  V q1q3 = O::mul(q1, q3);
+  V q2q2 = O::mul(q2, q2);
+  V q2q3 = O::mul(q2, q3);
+  V q3q3 = O::mul(q3, q3);
+
+  // Reference direction of the Earth's magnetic field
+  V hx = O::add(O::sub(O::add(O::mul(mx, q0q0), O::mul(_2q0mz, q2)), O::mul(_2q0my, q3)),
+                O::sub(O::add(O::mul(mx, q1q1), O::add(O::mul(O::mul(_2q1, my), q2), O::mul(O::mul(_2q1, mz), q3))),
+                       O::add(O::mul(mx, q2q2), O::mul(mx, q3q3))));
+  V hy = O::add(O::sub(O::add(O::mul(_2q0mx, q3), O::mul(my, q0q0)), O::mul(_2q0mz, q1)),
+                O::sub(O::add(O::add(O::mul(_2q1mx, q2), O::mul(my, q2q2)), O::mul(O::mul(_2q2, mz), q3)),
+                       O::add(O::mul(my, q1q1), O::mul(my, q3q3))));
+  V _2bx = O::sqrt(O::add(O::mul(hx, hx), O::mul(hy, hy)));
+  V _2bz = O::add(O::sub(O::add(O::mul(_2q0my, q1), O::mul(mz, q0q0)), O::mul(_2q0mx, q2)),
+                  O::sub(O::add(O::add(O::mul(_2q1mx, q3), O::mul(O::mul(_2q2, my), q3)), O::mul(mz, q3q3)),
+                         O::add(O::mul(mz, q1q1), O::mul(mz, q2q2))));
+  V _4bx = O::mul(two, _2bx);
+  V _4bz = O::mul(two, _2bz);
+
+  // Objective function: accelerometer...
+  V fa1 = O::sub(O::mul(two, O::sub(q1q3, q0q2)), ax);
+  V fa2 = O::sub(O::mul(two, O::add(q0q1, q2q3)), ay);
+  V fa3 = O::sub(O::sub(one, O::mul(two, O::add(q1q1, q2q2))), az);
+  // ...and magnetometer
+  V fm1 = O::sub(O::add(O::mul(_2bx, O::sub(O::sub(half, q2q2), q3q3)), O::mul(_2bz, O::sub(q1q3, q0q2))), mx);
+  V fm2 = O::sub(O::add(O::mul(_2bx, O::sub(q1q2, q0q3)), O::mul(_2bz, O::add(q0q1, q2q3))), my);
+  V fm3 = O::sub(O::add(O::mul(_2bx, O::add(q0q2, q1q3)), O::mul(_2bz, O::sub(O::sub(half, q1q1), q2q2))), mz);
+
+  // Gradient (the transposed Jacobian times the objective function)
+  V s0 = O::add(O::sub(O::mul(_2q1, fa2), O::mul(_2q2, fa1)),
+                O::add(O::sub(O::mul(O::mul(_2bx, q2), fm3), O::mul(O::mul(_2bz, q2), fm1)),
+                       O::mul(O::sub(O::mul(_2bz, q1), O::mul(_2bx, q3)), fm2)));
+  V s1 = O::add(O::sub(O::add(O::mul(_2q3, fa1), O::mul(_2q0, fa2)), O::mul(O::mul(four, q1), fa3)),
+                O::add(O::add(O::mul(O::mul(_2bz, q3), fm1), O::mul(O::add(O::mul(_2bx, q2), O::mul(_2bz, q0)), fm2)),
+                       O::mul(O::sub(O::mul(_2bx, q3), O::mul(_4bz, q1)), fm3)));
+  V s2 = O::add(O::sub(O::sub(O::mul(_2q3, fa2), O::mul(_2q0, fa1)), O::mul(O::mul(four, q2), fa3)),
+                O::add(O::sub(O::mul(O::add(O::mul(_2bx, q1), O::mul(_2bz, q3)), fm2),
+                              O::mul(O::add(O::mul(_4bx, q2), O::mul(_2bz, q0)), fm1)),
+                       O::mul(O::sub(O::mul(_2bx, q0), O::mul(_4bz, q2)), fm3)));
+  V s3 = O::add(O::add(O::mul(_2q1, fa1), O::mul(_2q2, fa2)),
+                O::add(O::add(O::mul(O::sub(O::mul(_2bz, q1), O::mul(_4bx, q3)), fm1),
+                              O::mul(O::sub(O::mul(_2bz, q2), O::mul(_2bx, q0)), fm2)),
+                       O::mul(O::mul(_2bx, q1), fm3)));
+  recipNorm = O::invSqrtOrZero(O::add(O::add(O::mul(s0, s0), O::mul(s1, s1)),
+                                      O::add(O::mul(s2, s2), O::mul(s3, s3))));
+  // No feedback without a valid accelerometer sample
+  recipNorm = O::keepIf(accelNorm2, recipNorm);
+
+  // Apply the feedback step
+  V beta = O::mul(O::set1(betaGain), recipNorm);
+  qDot0 = O::sub(qDot0, O::mul(beta, s0));
+  qDot1 = O::sub(qDot1, O::mul(beta, s1));
+  qDot2 = O::sub(qDot2, O::mul(beta, s2));
+  qDot3 = O::sub(qDot3, O::mul(beta, s3));
+
+  // Integrate and normalise
+  q0 = O::add(q0, O::mul(qDot0, dt));
+  q1 = O::add(q1, O::mul(qDot1, dt));
+  q2 = O::add(q2, O::mul(qDot2, dt));
+  q3 = O::add(q3, O::mul(qDot3, dt));
+  recipNorm = O::invSqrtOrZero(O::add(O::add(O::mul(q0, q0), O::mul(q1, q1)),
+                                      O::add(O::mul(q2, q2), O::mul(q3, q3))));
+  O::store(b.q0 + i, O::mul(q0, recipNorm));
+  O::store(b.q1 + i, O::mul(q1, recipNorm));
+  O::store(b.q2 + i, O::mul(q2, recipNorm));
+  O::store(b.q3 + i, O::mul(q3, recipNorm));
+}
+
+
+template<class O>
+static inline void
+madgwickLanes(const ImuBatch& batch, int& i, int count, float beta) {
+  for(; i+int(O::width)<=count; i+=O::width)
+    madgwickStep<O>(batch, i, beta);
+}
+
+
+void
+madgwickUpdate(const ImuBatch& batch, int count, float beta) {
+  int i = 0;
+#ifdef SIMDOPS_AVX
+  madgwickLanes<AvxOps>(batch, i, count, beta);
+#endif
+#ifdef SIMDOPS_SSE
+  madgwickLanes<SseOps>(batch, i, count, beta);
+#endif
+  madgwickLanes<ScalarOps>(batch, i, count, beta);
+}
+
+
+void
+madgwickUpdateScalar(const ImuBatch& batch, int count, float beta) {
+  int i = 0;
+  madgwickLanes<ScalarOps>(batch, i, count, beta);
+}
+
+
+ImuFusion::ImuFusion(int capacity)
+  : nCapacity(capacity)
+  , beta(0.1f)
+{
+  reset();
+}
+
+
+int
+ImuFusion::capacity() const {
+  return nCapacity;
+}
+
+
+void
+ImuFusion::setBeta(float newBeta) {
+  beta = newBeta;
+}
+
+
+// All the sensors back to the identity
+void
+ImuFusion::reset() {
+  q0.assign(nCapacity, 1.0f);
+  q1.assign(nCapacity, 0.0f);
+  q2.assign(nCapacity, 0.0f);
+  q3.assign(nCapacity, 0.0f);
+  samplesPerSensor.assign(nCapacity, 0);
+  bUpdated.assign(nCapacity, 0);
+  queuedIds.clear();
+  for(int f=0; f<nSampleFields; f++)
+    queue[f].clear();
+  updated.clear();
+}
+
+
+bool
+ImuFusion::addSample(int id, const ImuSample& sample) {
+  if(id < 0 || id >= nCapacity) return false;
+  queuedIds.push_back(id);
+  queue[gx].push_back(sample.gyro[0]);
+  queue[gy].push_back(sample.gyro[1]);
+  queue[gz].push_back(sample.gyro[2]);
+  queue[ax].push_back(sample.accel[0]);
+  queue[ay].push_back(sample.accel[1]);
+  queue[az].push_back(sample.accel[2]);
+  queue[mx].push_back(sample.mag[0]);
+  queue[my].push_back(sample.mag[1]);
+  queue[mz].push_back(sample.mag[2]);
+  queue[dt].push_back(sample.dt);
+  return true;
+}
+
+
+// The k-th queued sample of a sensor goes in round k: the samples
+// are bucketed by round (a counting sort) and every round is one
+// batched filter step over distinct sensors. In the usual case of a
+// single round the queue is handed to the filter as it is.
+int
+ImuFusion::update() {
+  for(size_t k=0; k<updated.size(); k++)
+    bUpdated[updated[k]] = 0;
+  updated.clear();
+  int nQueued = int(queuedIds.size());
+  if(nQueued == 0) return 0;
+
+  // Round of each sample and size of each round
+  sampleRound.resize(nQueued);
+  roundStart.assign(2, 0);
+  for(int k=0; k<nQueued; k++) {
+    int id = queuedIds[k];
+    int round = 0;
+    if(bUpdated[id])
+      round = ++samplesPerSensor[id];
+    else {
+      bUpdated[id] = 1;
+      updated.push_back(id);
+      samplesPerSensor[id] = 0;
+    }
+    sampleRound[k] = round;
+    if(round+1 >= int(roundStart.size()))
+      roundStart.resize(round+2, 0);
+    roundStart[round+1]++;
+  }
+  for(size_t r=1; r<roundStart.size(); r++)
+    roundStart[r] += roundStart[r-1];
+  int nRounds = int(roundStart.size()) - 1;
+
+  order.resize(nQueued);
+  if(nRounds == 1) {
+    for(int k=0; k<nQueued; k++)
+      order[k] = k;
+  }
+  else {
+    roundFill.assign(roundStart.begin(), roundStart.end()-1);
+    for(int k=0; k<nQueued; k++)
+      order[roundFill[sampleRound[k]]++] = k;
+  }
+
+  int nMax = 0;
+  for(int r=0; r<nRounds; r++)
+    nMax = std::max(nMax, roundStart[r+1]-roundStart[r]);
+  int nArrays = (nRounds == 1) ? 4 : 14;
+  batchData.resize(nArrays*nMax);
+  float* p = batchData.data();
+  ImuBatch batch;
+  batch.q0 = p;
+  batch.q1 = p +   nMax;
+  batch.q2 = p + 2*nMax;
+  batch.q3 = p + 3*nMax;
+  if(nRounds == 1) {
+    batch.gx = &queue[gx][0]; batch.gy = &queue[gy][0]; batch.gz = &queue[gz][0];
+    batch.ax = &queue[ax][0]; batch.ay = &queue[ay][0]; batch.az = &queue[az][0];
+    batch.mx = &queue[mx][0]; batch.my = &queue[my][0]; batch.mz = &queue[mz][0];
+    batch.dt = &queue[dt][0];
+  }
+  float* pSample[nSampleFields];
+  for(int f=0; f<nSampleFields; f++)
+    pSample[f] = p + (4+f)*nMax;
+
+  for(int r=0; r<nRounds; r++) {
+    const int* pRound = &order[roundStart[r]];
+    int n = roundStart[r+1] - roundStart[r];
+    for(int j=0; j<n; j++) {
+      int id = queuedIds[pRound[j]];
+      batch.q0[j] = q0[id];
+      batch.q1[j] = q1[id];
+      batch.q2[j] = q2[id];
+      batch.q3[j] = q3[id];
+    }
+    if(nRounds > 1) {
+      for(int f=0; f<nSampleFields; f++)
+        for(int j=0; j<n; j++)
+          pSample[f][j] = queue[f][pRound[j]];
+      batch.gx = pSample[gx]; batch.gy = pSample[gy]; batch.gz = pSample[gz];
+      batch.ax = pSample[ax]; batch.ay = pSample[ay]; batch.az = pSample[az];
+      batch.mx = pSample[mx]; batch.my = pSample[my]; batch.mz = pSample[mz];
+      batch.dt = pSample[dt];
+    }
+    madgwickUpdate(batch, n, beta);
+    for(int j=0; j<n; j++) {
+      int id = queuedIds[pRound[j]];
+      q0[id] = batch.q0[j];
+      q1[id] = batch.q1[j];
+      q2[id] = batch.q2[j];
+      q3[id] = batch.q3[j];
+    }
+  }
+  queuedIds.clear();
+  for(int f=0; f<nSampleFields; f++)
+    queue[f].clear();
+  return nQueued;
+}
+
+
+const std::vector<int>&
+ImuFusion::updatedSensors() const {
+  return updated;
+}
+
+
+void
+ImuFusion::orientation(int id, float& w, float& x, float& y, float& z) const {
+  w = q0[id];
+  x = q1[id];
+  y = q2[id];
+  z = q3[id];
+}
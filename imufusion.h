@@ -0,0 +1,94 @@
+#ifndef IMUFUSION_H
+#define IMUFUSION_H
+
+#include <vector>
+
+
+// Raw sample of one inertial sensor
+struct ImuSample
+{
+  float gyro[3]; // rad/s
+  float accel[3];// Any unit: only the direction is used
+  float mag[3];  // Any unit; all zero if there is no magnetometer
+  float dt;      // Seconds since the previous sample of the sensor
+};
+
+
+// Arrays of a batch of independent filter steps, one per lane.
+// The quaternions are updated in place.
+struct ImuBatch
+{
+  float* q0;
+  float* q1;
+  float* q2;
+  float* q3;
+  const float* gx;
+  const float* gy;
+  const float* gz;
+  const float* ax;
+  const float* ay;
+  const float* az;
+  const float* mx;
+  const float* my;
+  const float* mz;
+  const float* dt;
+};
+
+
+// One step of Madgwick's gradient descent orientation filter for
+// every lane of the batch: with AVX, SSE2 or scalar code (see simdops.h).
+// Lanes without a magnetometer sample get the IMU only update, lanes
+// without an accelerometer sample only integrate the gyroscope.
+void madgwickUpdate(const ImuBatch& batch, int count, float beta);
+void madgwickUpdateScalar(const ImuBatch& batch, int count, float beta);
+
+
+// Ground-side attitude estimation of many sensors from their raw
+// samples. Samples are queued as they arrive from the link and fused
+// by update() in rounds: round k takes the k-th queued sample of every
+// sensor and runs a single batched filter step over them.
+// Plain C++, to be benchmarked without Qt.
+class ImuFusion
+{
+public:
+  explicit ImuFusion(int capacity = 64);
+
+  int  capacity() const;
+  void setBeta(float beta);// Filter gain
+  void reset();
+
+  bool addSample(int id, const ImuSample& sample);// False if over capacity
+  int  update();// Returns the number of samples fused
+
+  const std::vector<int>& updatedSensors() const;// By the last update()
+  // Orientation of sensor "id" as w, x, y, z
+  void orientation(int id, float& w, float& x, float& y, float& z) const;
+
+private:
+  enum sampleField {
+    gx, gy, gz,
+    ax, ay, az,
+    mx, my, mz,
+    dt,
+    nSampleFields
+  };
+
+  int   nCapacity;
+  float beta;
+  std::vector<float> q0, q1, q2, q3;// One per sensor
+
+  std::vector<int>   queuedIds;
+  std::vector<float> queue[nSampleFields];// Queued samples, one array per field
+  std::vector<char>  bUpdated;        // Per sensor
+  std::vector<int>   samplesPerSensor;// Queued, minus one
+  std::vector<int>   updated;
+
+  // Scratch space of update()
+  std::vector<int>   sampleRound;
+  std::vector<int>   roundStart;
+  std::vector<int>   roundFill;
+  std::vector<int>   order;
+  std::vector<float> batchData;
+};
+
+#endif // IMUFUSION_H
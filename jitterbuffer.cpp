@@ -0,0 +1,122 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "jitterbuffer.h"
+
+#include <algorithm>
+
+
+static const size_t windowSize = 128;// About 4 s of video
+static const double shrinkRate = 0.02;// Of the excess delay, per frame
+
+
+JitterBuffer::JitterBuffer()
+  : targetLateRate(0.01)
+  , maxDelay(300000000)// 300 ms
+  , margin(2000000)
+  , maxJump(1000000000)
+{
+  transits.reserve(windowSize);
+  sorted.reserve(windowSize);
+  reset();
+}
+
+
+void
+JitterBuffer::setTargetLateRate(double fraction) {
+  targetLateRate = std::min(std::max(fraction, 0.0), 1.0);
+}
+
+
+void
+JitterBuffer::setMaxDelay(long long ns) {
+  maxDelay = ns;
+}
+
+
+void
+JitterBuffer::reset() {
+  transits.clear();
+  iNext        = 0;
+  baseTransit  = 0;
+  currentDelay = 0;
+  targetDelay  = 0;
+  lastTransit  = 0;
+  lastPlayout  = 0;
+  nFrames      = 0;
+  nLate        = 0;
+}
+
+
+// Fixed part of the latency and jitter quantile over the window
+void
+JitterBuffer::estimate() {
+  sorted.assign(transits.begin(), transits.end());
+  std::sort(sorted.begin(), sorted.end());
+  baseTransit = sorted.front();
+  size_t i = size_t((1.0-targetLateRate) * double(sorted.size()-1) + 0.5);
+  targetDelay = std::min(sorted[i] - baseTransit + margin, maxDelay);
+}
+
+
+long long
+JitterBuffer::playoutTime(long long sourceTime, long long arrivalTime) {
+  long long transit = arrivalTime - sourceTime;
+  // The camera clock was set, or the link went away for long
+  if(!transits.empty() && (transit-lastTransit > maxJump || lastTransit-transit > maxJump)) {
+    transits.clear();
+    iNext = 0;
+    currentDelay = 0;
+    lastPlayout  = 0;
+  }
+  lastTransit = transit;
+  if(transits.size() < windowSize)
+    transits.push_back(transit);
+  else
+    transits[iNext] = transit;
+  iNext = (iNext+1) % windowSize;
+  estimate();
+
+  // Up at once, down a little at every frame
+  if(targetDelay > currentDelay)
+    currentDelay = targetDelay;
+  else
+    currentDelay -= (long long)(double(currentDelay-targetDelay) * shrinkRate);
+
+  long long playout = std::max(sourceTime + baseTransit + currentDelay, lastPlayout);
+  lastPlayout = playout;
+  nFrames++;
+  if(arrivalTime > playout) {
+    nLate++;
+    playout = arrivalTime;
+  }
+  return playout;
+}
+
+
+long long
+JitterBuffer::delay() const {
+  return currentDelay;
+}
+
+
+long long
+JitterBuffer::framesLate() const {
+  return nLate;
+}
+
+
+long long
+JitterBuffer::frames() const {
+  return nFrames;
+}
@@ -0,0 +1,55 @@
+#ifndef JITTERBUFFER_H
+#define JITTERBUFFER_H
+
+#include <vector>
+#include <stddef.h>
+
+
+// Playout delay of the video frames, sized to the jitter of the link.
+//
+// Each frame comes with the time the camera took it (on the camera
+// clock) and the time it arrived (on ours). The smallest transit
+// time of the last frames is taken as the fixed part of the latency;
+// what a frame takes beyond it is jitter. The playout delay follows
+// the quantile of that jitter for which only the target fraction of
+// frames would arrive after their playout time: it grows as soon as
+// the link gets worse and shrinks slowly when it gets better, so
+// that frames are dropped rather than delay accumulated. Playout
+// times never go backwards.
+// Times in ns. Plain C++, to be benchmarked without Qt.
+class JitterBuffer
+{
+public:
+  JitterBuffer();
+
+  void setTargetLateRate(double fraction);
+  void setMaxDelay(long long ns);
+  void reset();
+
+  long long playoutTime(long long sourceTime, long long arrivalTime);// Of the new frame
+
+  long long delay() const;// Current playout delay, beyond the fixed latency
+  long long framesLate() const;// Arrived after their playout time
+  long long frames() const;
+
+private:
+  void estimate();
+
+  double    targetLateRate;
+  long long maxDelay;
+  long long margin;    // For the scheduling of the display
+  long long maxJump;   // Transit changes beyond this restart the estimate
+
+  std::vector<long long> transits;// Ring of the last ones
+  std::vector<long long> sorted;  // Scratch
+  size_t    iNext;
+  long long baseTransit;
+  long long currentDelay;
+  long long targetDelay;
+  long long lastTransit;
+  long long lastPlayout;
+  long long nFrames;
+  long long nLate;
+};
+
+#endif // JITTERBUFFER_H
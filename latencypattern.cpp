@@ -0,0 +1,104 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "latencypattern.h"
+
+#include <chrono>
+
+
+static const unsigned char syncBits = 0xB2;// 10110010
+static const unsigned char checkKey = 0x5A;
+static const unsigned char black    = 32;  // Far enough from the clipping
+static const unsigned char white    = 224; // levels not to ring
+
+
+long long
+LatencyPattern::now() {
+  // steady_clock is CLOCK_MONOTONIC on Linux
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+int
+LatencyPattern::cellSize(int width) {
+  return (width/columns) & ~7;
+}
+
+
+static unsigned char
+checkByte(unsigned long long value) {
+  unsigned char check = checkKey;
+  for(int i=0; i<8; i++)
+    check ^= (unsigned char)(value >> (8*i));
+  return check;
+}
+
+
+// Bit i of the whole code: sync, value, check
+static bool
+codeBit(unsigned long long value, int i) {
+  if(i < 8)
+    return (syncBits >> (7-i)) & 1;
+  if(i < 72)
+    return (value >> (71-i)) & 1;
+  return (checkByte(value) >> (79-i)) & 1;
+}
+
+
+bool
+LatencyPattern::encode(unsigned long long value, unsigned char* pLuma, int width, int height, int stride) {
+  int cell = cellSize(width);
+  if(cell == 0 || height < rows*cell)
+    return false;
+  for(int i=0; i<rows*columns; i++) {
+    unsigned char level = codeBit(value, i) ? white : black;
+    unsigned char* pCell = pLuma + (i/columns)*cell*stride + (i%columns)*cell;
+    for(int y=0; y<cell; y++)
+      for(int x=0; x<cell; x++)
+        pCell[y*stride+x] = level;
+  }
+  return true;
+}
+
+
+bool
+LatencyPattern::decode(const unsigned char* pLuma, int width, int height, int stride, unsigned long long& value) {
+  int cell = cellSize(width);
+  if(cell == 0 || height < rows*cell)
+    return false;
+  int margin = cell/4;
+  int inner  = cell - 2*margin;
+  unsigned char sync  = 0;
+  unsigned char check = 0;
+  unsigned long long decoded = 0;
+  for(int i=0; i<rows*columns; i++) {
+    const unsigned char* pCell = pLuma + ((i/columns)*cell + margin)*stride + (i%columns)*cell + margin;
+    int sum = 0;
+    for(int y=0; y<inner; y++)
+      for(int x=0; x<inner; x++)
+        sum += pCell[y*stride+x];
+    unsigned bit = sum > 128*inner*inner ? 1 : 0;
+    if(i < 8)
+      sync = (unsigned char)(sync << 1 | bit);
+    else if(i < 72)
+      decoded = decoded << 1 | bit;
+    else
+      check = (unsigned char)(check << 1 | bit);
+  }
+  // Frames without the code (a real camera) fail here
+  if(sync != syncBits || check != checkByte(decoded))
+    return false;
+  value = decoded;
+  return true;
+}
@@ -0,0 +1,29 @@
+#ifndef LATENCYPATTERN_H
+#define LATENCYPATTERN_H
+
+
+// Binary code of a 64 bit value drawn in the luma plane of a video
+// frame, to time a frame from the moment it was generated to the one
+// it is displayed (see latencyprobe.h and tools/mjpegsource).
+//
+// The top left corner holds 2 rows of 40 square cells, black or
+// white: 8 sync bits, the value (most significant bit first) and
+// 8 check bits. Cells are a multiple of 8 pixels wide, aligned to
+// the JPEG blocks, and only their inner half is read, so the code
+// survives the compression and a chroma subsampled stream.
+// Plain C++, shared by the synthetic camera and the client.
+class LatencyPattern
+{
+public:
+  enum {
+    columns = 40,
+    rows    = 2
+  };
+
+  static long long now();// ns, CLOCK_MONOTONIC: the same in every process of the host
+  static int  cellSize(int width);// 0 if the frame is too small for the code
+  static bool encode(unsigned long long value, unsigned char* pLuma, int width, int height, int stride);
+  static bool decode(const unsigned char* pLuma, int width, int height, int stride, unsigned long long& value);
+};
+
+#endif // LATENCYPATTERN_H
@@ -0,0 +1,188 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "latencyprobe.h"
+#include "latencypattern.h"
+
+#include <QMutexLocker>
+#include <qmath.h>
+
+
+static const int nBins = 200;// ms
+
+
+LatencyProbe::LatencyProbe(VideoSource* pVideoSource)
+  : pSource(pVideoSource)
+{
+  reset();
+}
+
+
+LatencyProbe::~LatencyProbe() {
+  setLogFile(QString());
+}
+
+
+// Called by the renderer, in whatever thread it runs
+bool
+LatencyProbe::takeFrame(VideoFrame& frame) {
+  if(!pSource->takeFrame(frame))
+    return false;
+  if(frame.width > 0) {
+    qint64 shown = LatencyPattern::now();
+    unsigned long long captured;
+    const unsigned char* pLuma = reinterpret_cast<const unsigned char*>(frame.planes.constData());
+    QMutexLocker locker(&mutex);
+    if(LatencyPattern::decode(pLuma, frame.width, frame.height, frame.width, captured))
+      addSample(frame, qint64(captured), shown);
+    else
+      nUnreadable++;
+  }
+  return true;
+}
+
+
+bool
+LatencyProbe::setLogFile(const QString& sFileName) {
+  QMutexLocker locker(&mutex);
+  if(logFile.isOpen()) {
+    log.flush();
+    logFile.close();
+  }
+  if(sFileName.isEmpty())
+    return true;
+  logFile.setFileName(sFileName);
+  if(!logFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    return false;
+  log.setDevice(&logFile);
+  // Times in us; decode is measured on the client clock
+  log << "sequence,captured_us,shown_us,latency_us,decode_us\n";
+  return true;
+}
+
+
+void
+LatencyProbe::reset() {
+  QMutexLocker locker(&mutex);
+  latencyBins.fill(0, nBins+1);
+  jitterBins.fill(0, nBins+1);
+  nTimed       = 0;
+  nUnreadable  = 0;
+  nSkipped     = 0;
+  lastSequence = -1;
+  lastLatency  = -1;
+  minLatency   = 0;
+  maxLatency   = 0;
+  sumLatency   = 0.0;
+  sumSquares   = 0.0;
+}
+
+
+qint64
+LatencyProbe::framesTimed() const {
+  QMutexLocker locker(&mutex);
+  return nTimed;
+}
+
+
+// With the mutex held
+void
+LatencyProbe::addSample(const VideoFrame& frame, qint64 captured, qint64 shown) {
+  qint64 latency = shown - captured;
+  latencyBins[qBound(qint64(0), latency/1000000, qint64(nBins))]++;
+  if(lastLatency >= 0)
+    jitterBins[qMin(qAbs(latency-lastLatency)/1000000, qint64(nBins))]++;
+  if(lastSequence >= 0 && frame.sequence > lastSequence+1)
+    nSkipped += frame.sequence-lastSequence-1;
+  if(nTimed == 0 || latency < minLatency)
+    minLatency = latency;
+  if(nTimed == 0 || latency > maxLatency)
+    maxLatency = latency;
+  sumLatency  += double(latency);
+  sumSquares  += double(latency)*double(latency);
+  lastLatency  = latency;
+  lastSequence = frame.sequence;
+  nTimed++;
+  if(logFile.isOpen())
+    log << frame.sequence << ','
+        << captured/1000 << ','
+        << shown/1000 << ','
+        << latency/1000 << ','
+        << (frame.decodedTime-frame.receivedTime)/1000 << '\n';
+}
+
+
+// Upper edge of the bin where the given fraction of the samples is reached
+double
+LatencyProbe::percentile(const QVector<qint64>& bins, qint64 count, double fraction) {
+  qint64 target = qint64(ceil(fraction*double(count)));
+  qint64 sum = 0;
+  for(int i=0; i<bins.size(); i++) {
+    sum += bins[i];
+    if(sum >= target)
+      return double(i+1);
+  }
+  return double(bins.size());
+}
+
+
+// One line per non empty bin, with a bar scaled to the fullest one
+QString
+LatencyProbe::histogramText(const QVector<qint64>& bins, const QString& sTitle) {
+  qint64 peak = 0;
+  int first = -1;
+  int last  = -1;
+  for(int i=0; i<bins.size(); i++) {
+    if(bins[i] == 0)
+      continue;
+    peak = qMax(peak, bins[i]);
+    if(first < 0)
+      first = i;
+    last = i;
+  }
+  QString sText = sTitle + "\n";
+  for(int i=first; i>=0 && i<=last; i++) {
+    QString sBin = i < nBins ? QString("%1-%2 ms").arg(i, 3).arg(i+1, -3)
+                             : QString(">=%1 ms ").arg(nBins);
+    sText += QString("  %1 %2 %3\n")
+             .arg(sBin)
+             .arg(bins[i], 6)
+             .arg(QString(int(40*bins[i]/peak), QChar('#')));
+  }
+  return sText;
+}
+
+
+QString
+LatencyProbe::report() const {
+  QMutexLocker locker(&mutex);
+  if(nTimed == 0)
+    return QString("Latency probe: no timed frames (%1 without the code)").arg(nUnreadable);
+  double mean  = sumLatency/nTimed;
+  double sigma = sqrt(qMax(0.0, sumSquares/nTimed - mean*mean));
+  QString sText = QString("Latency probe: %1 frames, %2 skipped, %3 without the code\n"
+                          "  latency min %4 mean %5 max %6 ms, std dev %7 ms\n"
+                          "  p50 <%8 p95 <%9 p99 <%10 ms\n")
+                  .arg(nTimed).arg(nSkipped).arg(nUnreadable)
+                  .arg(minLatency/1e6, 0, 'f', 1)
+                  .arg(mean/1e6, 0, 'f', 1)
+                  .arg(maxLatency/1e6, 0, 'f', 1)
+                  .arg(sigma/1e6, 0, 'f', 2)
+                  .arg(percentile(latencyBins, nTimed, 0.50))
+                  .arg(percentile(latencyBins, nTimed, 0.95))
+                  .arg(percentile(latencyBins, nTimed, 0.99));
+  sText += histogramText(latencyBins, "  Latency");
+  if(nTimed > 1)
+    sText += histogramText(jitterBins, "  Jitter (frame to frame)");
+  return sText;
+}
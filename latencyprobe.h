@@ -0,0 +1,57 @@
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <QMutex>
+#include <QString>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+
+#include "videoframe.h"
+
+
+// Capture to display latency of a stream carrying a LatencyPattern
+// (tools/mjpegsource). It stands between the video client and the
+// renderer: each frame is timed when the renderer takes it to draw
+// it, i.e. after transfer, parsing, decoding, the jitter buffer and
+// waiting for the next display frame, but before the texture upload
+// and the buffer swap. Latencies and their frame to frame variation
+// (jitter) go in two histograms of 1 ms bins; each frame can also be
+// logged to a CSV file. Frames without the code are only counted.
+class LatencyProbe : public VideoSource
+{
+public:
+  explicit LatencyProbe(VideoSource* pVideoSource);
+  ~LatencyProbe();
+
+  bool takeFrame(VideoFrame& frame);
+
+  bool    setLogFile(const QString& sFileName);// Per frame CSV, empty to stop
+  void    reset();
+  qint64  framesTimed() const;
+  QString report() const;// Summary and histograms, as text
+
+private:
+  void addSample(const VideoFrame& frame, qint64 captured, qint64 shown);
+  static QString histogramText(const QVector<qint64>& bins, const QString& sTitle);
+  static double  percentile(const QVector<qint64>& bins, qint64 count, double fraction);
+
+  VideoSource* pSource;
+
+  mutable QMutex mutex;
+  QVector<qint64> latencyBins;// 1 ms each, the last one for all the longer
+  QVector<qint64> jitterBins;
+  qint64 nTimed;
+  qint64 nUnreadable;
+  qint64 nSkipped;// Sequence gaps: frames never displayed
+  qint64 lastSequence;
+  qint64 lastLatency;// ns
+  qint64 minLatency;
+  qint64 maxLatency;
+  double sumLatency;
+  double sumSquares;
+  QFile       logFile;
+  QTextStream log;
+};
+
+#endif // LATENCYPROBE_H
@@ -0,0 +1,241 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "logger.h"
+#include "logring.h"
+#include "sessionclock.h"
+
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QStringList>
+#include <QTimer>
+#include <QDir>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static const int    drainPeriod     = 100;// ms
+static const int    maxConsoleLines = 8;  // Per drain: 80 lines/s at most
+static const qint64 maxFileSize     = 4 << 20;
+static const int    nOldFiles       = 4;  // rov.log.1 ... rov.log.4
+
+static QtMessageHandler previousHandler = NULL;
+
+
+// Created on first use: messages logged before the Logger exists
+// wait in the ring
+static LogRing&
+ring() {
+  static LogRing logRing(4096);
+  return logRing;
+}
+
+
+Logger::Logger()
+  : QObject()
+  , pDrainTimer(NULL)
+  , nDropped(0)
+{
+  ring();
+  logThread.setObjectName("Log");
+  moveToThread(&logThread);
+  logThread.start();
+  QMetaObject::invokeMethod(this, "startDraining", Qt::QueuedConnection);
+  previousHandler = qInstallMessageHandler(qtMessage);
+}
+
+
+Logger::~Logger() {
+  qInstallMessageHandler(previousHandler);
+  // Writes what is still in the ring
+  QMetaObject::invokeMethod(this, "releaseResources", Qt::BlockingQueuedConnection);
+  logThread.quit();
+  logThread.wait();
+}
+
+
+void
+Logger::setFile(const QString& sPath) {
+  QMutexLocker locker(&mutex);
+  sFileName = sPath;
+}
+
+
+void
+Logger::write(Level level, const char* pSubsystem, const char* pText) {
+  ring().push(SessionClock::now(), level, pSubsystem, pText, strlen(pText));
+}
+
+
+// Encoded by the ring, into the record
+void
+Logger::write(Level level, const char* pSubsystem, const QString& sText) {
+  ring().pushUtf16(SessionClock::now(), level, pSubsystem, sText.utf16(), size_t(sText.size()));
+}
+
+
+void
+Logger::writef(Level level, const char* pSubsystem, const char* pFormat, ...) {
+  va_list arguments;
+  va_start(arguments, pFormat);
+  ring().pushFormat(SessionClock::now(), level, pSubsystem, pFormat, arguments);
+  va_end(arguments);
+}
+
+
+void
+Logger::infof(const char* pSubsystem, const char* pFormat, ...) {
+  va_list arguments;
+  va_start(arguments, pFormat);
+  ring().pushFormat(SessionClock::now(), Info, pSubsystem, pFormat, arguments);
+  va_end(arguments);
+}
+
+
+void
+Logger::warningf(const char* pSubsystem, const char* pFormat, ...) {
+  va_list arguments;
+  va_start(arguments, pFormat);
+  ring().pushFormat(SessionClock::now(), Warning, pSubsystem, pFormat, arguments);
+  va_end(arguments);
+}
+
+
+void
+Logger::errorf(const char* pSubsystem, const char* pFormat, ...) {
+  va_list arguments;
+  va_start(arguments, pFormat);
+  ring().pushFormat(SessionClock::now(), Error, pSubsystem, pFormat, arguments);
+  va_end(arguments);
+}
+
+
+void
+Logger::qtMessage(QtMsgType type, const QMessageLogContext& context, const QString& sMessage) {
+  Level level = Error;
+  switch(type) {
+    case QtDebugMsg:    level = Debug;   break;
+    case QtInfoMsg:     level = Info;    break;
+    case QtWarningMsg:  level = Warning; break;
+    default:            level = Error;   break;
+  }
+  write(level, "qt", sMessage);
+  if(type != QtFatalMsg)
+    return;
+  // Qt aborts next: the ring will never be drained
+  if(previousHandler)
+    previousHandler(type, context, sMessage);
+  else
+    fprintf(stderr, "%s\n", sMessage.toLocal8Bit().constData());
+}
+
+
+// Log thread
+void
+Logger::startDraining() {
+  pDrainTimer = new QTimer(this);
+  connect(pDrainTimer, SIGNAL(timeout()), this, SLOT(drain()));
+  pDrainTimer->start(drainPeriod);
+}
+
+
+void
+Logger::drain() {
+  static const char levels[] = "DIWE";
+  QByteArray lines;
+  QStringList consoleLines;
+  int nHidden = 0;
+  LogRecord record;
+  char head[64];
+  while(ring().pop(record)) {
+    int n = snprintf(head, sizeof(head), "[%9.3f] %c %s: ",
+                     record.time/1.0e9, levels[qBound(0, record.level, 3)], record.pSubsystem);
+    lines.append(head, n);
+    lines.append(record.text, record.length);
+    lines.append('\n');
+    if(record.level < Info)
+      continue;
+    if(consoleLines.size() < maxConsoleLines)
+      consoleLines.append(QString::fromUtf8(head, n) + QString::fromUtf8(record.text, record.length));
+    else
+      nHidden++;
+  }
+  unsigned long long nLost = ring().dropped();
+  if(nLost != nDropped) {
+    QString sLost = QString("%1 messages lost: the log could not keep up").arg(nLost-nDropped);
+    lines.append("# " + sLost.toUtf8() + '\n');
+    consoleLines.append(sLost);
+    nDropped = nLost;
+  }
+  if(lines.isEmpty())
+    return;
+
+  {
+    QMutexLocker locker(&mutex);
+    if(sFileName != sOpenFile) {
+      sOpenFile = sFileName;
+      if(!openFile())
+        consoleLines.append(QString("Unable to write the log to %1").arg(sOpenFile));
+    }
+  }
+  if(file.isOpen()) {
+    if(file.size() + lines.size() > maxFileSize)
+      rotate();
+    file.write(lines);
+    file.flush();
+  }
+  if(nHidden > 0)
+    consoleLines.append(QString("(%1 more in the log file)").arg(nHidden));
+  if(!consoleLines.isEmpty())
+    emit messages(consoleLines.join('\n'));
+}
+
+
+bool
+Logger::openFile() {
+  file.close();
+  if(sOpenFile.isEmpty())
+    return true;
+  QDir().mkpath(QFileInfo(sOpenFile).absolutePath());
+  file.setFileName(sOpenFile);
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Append))
+    return false;
+  // Relates the session timeline to the wall clock
+  file.write(QString("# ROV log opened %1, session time %2 s\n")
+             .arg(QDateTime::currentDateTime().toString(Qt::ISODate))
+             .arg(SessionClock::now()/1.0e9, 0, 'f', 3).toUtf8());
+  return true;
+}
+
+
+// rov.log becomes rov.log.1, rov.log.1 becomes rov.log.2...
+void
+Logger::rotate() {
+  file.close();
+  QFile::remove(QString("%1.%2").arg(sOpenFile).arg(nOldFiles));
+  for(int i=nOldFiles-1; i>0; i--)
+    QFile::rename(QString("%1.%2").arg(sOpenFile).arg(i), QString("%1.%2").arg(sOpenFile).arg(i+1));
+  QFile::rename(sOpenFile, sOpenFile + ".1");
+  openFile();
+}
+
+
+void
+Logger::releaseResources() {
+  delete pDrainTimer;
+  pDrainTimer = NULL;
+  drain();
+  file.close();
+}
@@ -0,0 +1,83 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <QFile>
+
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+
+// The log of the application.
+//
+// Any thread logs with Logger::info("net", "...") and friends: the
+// message is stamped on the session timeline and written straight
+// into a slot of a lock free ring, nothing else (no allocation, no
+// lock, no disk, no widget). A QString is encoded to UTF-8 on the
+// way; infof() and the like format printf style into the slot.
+// A thread of its own drains the ring a few times per second:
+//  - everything goes to a rotating file, the full history of the dive;
+//  - the Info messages and above are sent, in one batch per drain and
+//    at most a few lines of it, to the on-screen console.
+// qDebug() and qWarning() end up in the same log.
+class Logger : public QObject
+{
+  Q_OBJECT
+
+public:
+  enum Level {
+    Debug,
+    Info,
+    Warning,
+    Error
+  };
+
+  Logger();
+  ~Logger();
+
+  void setFile(const QString& sPath);// Any thread
+
+  // Any thread. The subsystem must be a static string.
+  static void write(Level level, const char* pSubsystem, const char* pText);
+  static void write(Level level, const char* pSubsystem, const QString& sText);
+  static void writef(Level level, const char* pSubsystem, const char* pFormat, ...) Q_ATTRIBUTE_FORMAT_PRINTF(3, 4);
+
+  static void debug(const char* pSubsystem, const char* pText)      { write(Debug, pSubsystem, pText); }
+  static void debug(const char* pSubsystem, const QString& sText)   { write(Debug, pSubsystem, sText); }
+  static void info(const char* pSubsystem, const char* pText)       { write(Info, pSubsystem, pText); }
+  static void info(const char* pSubsystem, const QString& sText)    { write(Info, pSubsystem, sText); }
+  static void warning(const char* pSubsystem, const char* pText)    { write(Warning, pSubsystem, pText); }
+  static void warning(const char* pSubsystem, const QString& sText) { write(Warning, pSubsystem, sText); }
+  static void error(const char* pSubsystem, const char* pText)      { write(Error, pSubsystem, pText); }
+  static void error(const char* pSubsystem, const QString& sText)   { write(Error, pSubsystem, sText); }
+
+  static void infof(const char* pSubsystem, const char* pFormat, ...) Q_ATTRIBUTE_FORMAT_PRINTF(2, 3);
+  static void warningf(const char* pSubsystem, const char* pFormat, ...) Q_ATTRIBUTE_FORMAT_PRINTF(2, 3);
+  static void errorf(const char* pSubsystem, const char* pFormat, ...) Q_ATTRIBUTE_FORMAT_PRINTF(2, 3);
+
+signals:
+  void messages(QString sBatch);// For the console
+
+private slots:
+  void startDraining();
+  void drain();
+  void releaseResources();
+
+private:
+  static void qtMessage(QtMsgType type, const QMessageLogContext& context, const QString& sMessage);
+  bool openFile();
+  void rotate();
+
+  QThread logThread;
+  QTimer* pDrainTimer;
+
+  QMutex  mutex;
+  QString sFileName;    // Set by setFile()
+  QString sOpenFile;    // Of the log thread
+  QFile   file;
+  unsigned long long nDropped;// Last reported
+};
+
+#endif // LOGGER_H
@@ -0,0 +1,170 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "logring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+LogRing::LogRing(size_t capacity)
+  : writePos(0)
+  , readPos(0)
+  , nDropped(0)
+{
+  size_t size = 2;
+  while(size < capacity)
+    size *= 2;
+  mask = size-1;
+  cells.reset(new Cell[size]);
+  // A cell can be written when its sequence is the write position
+  for(size_t i=0; i<size; i++)
+    cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+// A free cell, or NULL when the ring is full
+LogRecord*
+LogRing::claim(long long time, int level, const char* pSubsystem, size_t& pos) {
+  Cell* pCell;
+  pos = writePos.load(std::memory_order_relaxed);
+  for(;;) {
+    pCell = &cells[pos & mask];
+    size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+    long difference = long(sequence) - long(pos);
+    if(difference == 0) {
+      if(writePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+        break;
+    }
+    else if(difference < 0) {
+      // Not read yet: the ring is full
+      nDropped.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+    else
+      pos = writePos.load(std::memory_order_relaxed);
+  }
+  LogRecord* pRecord = &pCell->record;
+  pRecord->time       = time;
+  pRecord->pSubsystem = pSubsystem;
+  pRecord->level      = level;
+  return pRecord;
+}
+
+
+// The record can be read from now on
+void
+LogRing::publish(size_t pos) {
+  cells[pos & mask].sequence.store(pos+1, std::memory_order_release);
+}
+
+
+bool
+LogRing::push(long long time, int level, const char* pSubsystem, const char* pText, size_t length) {
+  size_t pos;
+  LogRecord* pRecord = claim(time, level, pSubsystem, pos);
+  if(!pRecord) return false;
+  if(length > size_t(LogRecord::maxText))
+    length = LogRecord::maxText;
+  pRecord->length = int(length);
+  memcpy(pRecord->text, pText, length);
+  pRecord->text[length] = '\0';
+  publish(pos);
+  return true;
+}
+
+
+// Encoded to UTF-8 as it is copied. Truncation never splits a
+// character; an unpaired surrogate becomes U+FFFD.
+bool
+LogRing::pushUtf16(long long time, int level, const char* pSubsystem, const unsigned short* pText, size_t length) {
+  size_t pos;
+  LogRecord* pRecord = claim(time, level, pSubsystem, pos);
+  if(!pRecord) return false;
+  unsigned char* pOut = reinterpret_cast<unsigned char*>(pRecord->text);
+  // Mostly ASCII: one byte per code unit
+  size_t nFast = length < size_t(LogRecord::maxText) ? length : size_t(LogRecord::maxText);
+  size_t i = 0;
+  while(i < nFast && pText[i] < 0x80) {
+    pOut[i] = (unsigned char)pText[i];
+    i++;
+  }
+  int n = int(i);
+  for(; i<length; i++) {
+    unsigned long c = pText[i];
+    if(c >= 0xD800 && c < 0xDC00 && i+1 < length && pText[i+1] >= 0xDC00 && pText[i+1] < 0xE000)
+      c = 0x10000 + ((c - 0xD800) << 10) + (pText[++i] - 0xDC00);
+    else if(c >= 0xD800 && c < 0xE000)
+      c = 0xFFFD;
+    if(c < 0x80) {
+      if(n+1 > LogRecord::maxText) break;
+      pOut[n++] = (unsigned char)c;
+    }
+    else if(c < 0x800) {
+      if(n+2 > LogRecord::maxText) break;
+      pOut[n++] = (unsigned char)(0xC0 | (c >> 6));
+      pOut[n++] = (unsigned char)(0x80 | (c & 0x3F));
+    }
+    else if(c < 0x10000) {
+      if(n+3 > LogRecord::maxText) break;
+      pOut[n++] = (unsigned char)(0xE0 | (c >> 12));
+      pOut[n++] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      pOut[n++] = (unsigned char)(0x80 | (c & 0x3F));
+    }
+    else {
+      if(n+4 > LogRecord::maxText) break;
+      pOut[n++] = (unsigned char)(0xF0 | (c >> 18));
+      pOut[n++] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+      pOut[n++] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+      pOut[n++] = (unsigned char)(0x80 | (c & 0x3F));
+    }
+  }
+  pRecord->length = n;
+  pRecord->text[n] = '\0';
+  publish(pos);
+  return true;
+}
+
+
+bool
+LogRing::pushFormat(long long time, int level, const char* pSubsystem, const char* pFormat, va_list arguments) {
+  size_t pos;
+  LogRecord* pRecord = claim(time, level, pSubsystem, pos);
+  if(!pRecord) return false;
+  int length = vsnprintf(pRecord->text, sizeof(pRecord->text), pFormat, arguments);
+  if(length < 0) length = 0;
+  if(length > LogRecord::maxText) length = LogRecord::maxText;
+  pRecord->length = length;
+  publish(pos);
+  return true;
+}
+
+
+bool
+LogRing::pop(LogRecord& record) {
+  Cell* pCell = &cells[readPos & mask];
+  size_t sequence = pCell->sequence.load(std::memory_order_acquire);
+  if(long(sequence) - long(readPos+1) < 0)
+    return false;// Empty, or still being written
+  record = pCell->record;
+  // Writable again one lap later
+  pCell->sequence.store(readPos + mask + 1, std::memory_order_release);
+  readPos++;
+  return true;
+}
+
+
+unsigned long long
+LogRing::dropped() const {
+  return nDropped.load(std::memory_order_relaxed);
+}
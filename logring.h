@@ -0,0 +1,60 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <atomic>
+#include <memory>
+#include <stdarg.h>
+#include <stddef.h>
+
+
+// One log message, fixed size: writing it never allocates
+struct LogRecord
+{
+  enum { maxText = 215 };
+
+  long long   time;      // ns
+  const char* pSubsystem;// Static string
+  int         level;
+  int         length;
+  char        text[maxText+1];
+};
+
+
+// Bounded ring of log records that any number of threads can write
+// without locks (a slot is claimed with one compare-and-swap, then
+// published), read by a single thread. When the reader falls behind
+// a whole ring, new records are dropped and counted: writers never
+// wait. Longer texts are truncated. The text is written straight
+// into the record: UTF-8, UTF-16 (encoded on the way) or printf
+// formatted.
+// Plain C++, to be benchmarked without Qt.
+class LogRing
+{
+public:
+  explicit LogRing(size_t capacity);// Rounded up to a power of two
+
+  bool push(long long time, int level, const char* pSubsystem, const char* pText, size_t length);
+  bool pushUtf16(long long time, int level, const char* pSubsystem, const unsigned short* pText, size_t length);
+  bool pushFormat(long long time, int level, const char* pSubsystem, const char* pFormat, va_list arguments);
+  bool pop(LogRecord& record);// Reader thread only
+
+  unsigned long long dropped() const;
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    LogRecord           record;
+  };
+
+  LogRecord* claim(long long time, int level, const char* pSubsystem, size_t& pos);
+  void publish(size_t pos);
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+  alignas(64) std::atomic<size_t> writePos;
+  alignas(64) size_t readPos;
+  std::atomic<unsigned long long> nDropped;
+};
+
+#endif // LOGRING_H
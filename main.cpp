@@ -1,10 +1,23 @@
 #include "mainwindow.h"
+#include "glwidget.h"
+#include "startuptrace.h"
+#include "sessionclock.h"
+#include "logger.h"
 #include <QApplication>
+#include <QSurfaceFormat>
 
 int main(int argc, char *argv[])
 {
+  StartupTrace::start();
+  SessionClock::start();
+  // Must be set before the first window is created
+  QSurfaceFormat::setDefaultFormat(GLWidget::surfaceFormat());
   QApplication a(argc, argv);
+  // First, to have everything from here on in the log
+  Logger logger;
+  logger.setFile("/home/rov/Logs/rov.log");
   MainWindow w;
+  QObject::connect(&logger, SIGNAL(messages(QString)), &w, SLOT(showMessages(QString)));
   w.show();
   w.start();
 
@@ -11,7 +11,6 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>
 
-#include <QDebug>
 #include <QDial>
 #include <QSlider>
 #include <QLineEdit>
@@ -19,23 +18,23 @@
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QCheckBox>
-
-#ifdef Q_OS_LINUX
-  #include <VLCQtCore/Common.h>
-  #include <VLCQtCore/Instance.h>
-  #include <VLCQtCore/Media.h>
-  #include <VLCQtCore/MediaPlayer.h>
-  #include <VLCQtWidgets/WidgetVideo.h>
-#endif
+#include <QCoreApplication>
 
 #include "mainwindow.h"
 #include "joystickevent.h"
 #include "joystick.h"
 
 #include "glwidget.h"
-#include "shimmer3box.h"
+#include "mjpegclient.h"
+#include "latencyprobe.h"
+#include "streamrecorder.h"
+#include "snapshotwriter.h"
+#include "startuptrace.h"
+#include "logger.h"
+#include "panelmodel.h"
 
 #include <unistd.h>       // for usleep()
+#include <math.h>
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -50,51 +49,55 @@ MainWindow::MainWindow(QWidget *parent)
   , pMainLayout(NULL)
   , pJoystickEvent(NULL)
   , pJoystick(NULL)
-#ifdef Q_OS_LINUX
-  , pVlcInstance(NULL)
-  , pVlcMedia(NULL)
-  , pVlcPlayer(NULL)
-  , pVlcWidgetVideo(NULL)
-#endif
-  , widgetSize(QSize(440, 330))
+  , pilotUpDown(0)
+  , depthHoldTarget(0.0f)
+  , depthHoldGain(10.0f)
+  , depthHoldDamping(5.0f)
+  , depthHoldLookahead(500000000)
+  , pVideoClient(NULL)
+  , pLatencyProbe(NULL)
+  , pRecorder(NULL)
+  , pSnapshots(NULL)
+  , pPanel(NULL)
+  , widgetSize(QSize(640, 480))
   , stillAliveTime(300)// in ms
   , watchDogTime(30000)
   , getDepthTime(500)
 {
+  StartupTrace::Scope trace("main window");
+  // Mesh and texture are decoded in background while we go on
+  assets.start();
+
   // Create an instance of Joystick
+  StartupTrace::begin("joystick open");
   pJoystick = new Joystick("/dev/input/js0");
-
-#ifdef Q_OS_LINUX
-  // The following is mandatory for using VLC-Qt and all its other classes.
-  QStringList arguments = VlcCommon::args();
-  arguments.append(QString("--network-caching=0"));
-
-  pVlcInstance = new VlcInstance(arguments, this);
-//  pVlcInstance->setLogLevel(Vlc::DebugLevel);
-//  pVlcInstance->setLogLevel(Vlc::ErrorLevel);
-  pVlcInstance->setLogLevel(Vlc::DisabledLevel);
-
-  pVlcPlayer = new VlcMediaPlayer(pVlcInstance);
-
-  pVlcWidgetVideo = new VlcWidgetVideo(this);
-  pVlcWidgetVideo->setMediaPlayer(pVlcPlayer);
-  pVlcWidgetVideo->setFixedSize(widgetSize);
-
-  pVlcPlayer->setVideoWidget(pVlcWidgetVideo);
-#endif
-
+  StartupTrace::end("joystick open");
+
+  // The camera stream is decoded by our own client, straight into
+  // the texture behind the 3D view (see initWidgets())
+  pVideoClient = new MjpegClient();
+  initLatencyProbe();
+  // Every frame received goes to the recorder too, as it is
+  pRecorder = new StreamRecorder();
+  pVideoClient->addFrameSink(pRecorder);
+  pSnapshots = new SnapshotWriter();
+  pSnapshots->setDirectory("/home/rov/Pictures");
+  pVideoClient->addFrameSink(pSnapshots);
+
+  StartupTrace::begin("widgets");
   initCamera();
   initWidgets();
   initLayout();// Init Window Layout
+  StartupTrace::end("widgets");
 
   // Widgets events
   connect(pFrontWidget, SIGNAL(windowUpdated()), this, SLOT(updateWidgets()));
   connect(pEditHostName, SIGNAL(returnPressed()), this, SLOT(onConnectToClient()));
   connect(pButtonConnect, SIGNAL(clicked()), this, SLOT(onConnectToClient()));
   connect(pButtonResetOrientation, SIGNAL(clicked(bool)), this, SLOT(onResetOrientation()));
-#ifdef Q_OS_LINUX
+  connect(pCheckDepthHold, SIGNAL(toggled(bool)), this, SLOT(onDepthHoldToggled(bool)));
   connect(pButtonRecording, SIGNAL(clicked()), this, SLOT(startSopRecording()));
-#endif
+  connect(pButtonSnapshot, SIGNAL(clicked()), this, SLOT(onSnapshot()));
 
   // Network events
   connect(&tcpClient, SIGNAL(connected()), this, SLOT(onServerConnected()));
@@ -118,14 +121,11 @@ MainWindow::~MainWindow() {
   pJoystick->bStopSampling = true;
   joystickThread.quit();
   joystickThread.wait(3000);
-#ifdef Q_OS_LINUX
-  qDebug() << "Stop Recording";
-  pVlcPlayer->stop();
-  delete pVlcWidgetVideo;
-  delete pVlcPlayer;
-  delete pVlcMedia;
-  delete pVlcInstance;
-#endif
+  pVideoClient->stop();
+  delete pLatencyProbe;
+  delete pVideoClient;
+  delete pRecorder;// Writes what is left
+  delete pSnapshots;
 }
 
 
@@ -146,24 +146,89 @@ MainWindow::onResetOrientation() {
       message.clear();
       message.append(char(SetOrientation));
       message.append(char(SetOrientation));
-      tcpClient.write(message);
+      sendControl();
     }
 }
 
 
+void
+MainWindow::onSnapshot() {
+  takeSnapshot(1);
+}
+
+
+// From the Logger, a few times per second at most
+void
+MainWindow::showMessages(QString sBatch) {
+  console.appendPlainText(sBatch);
+}
+
+
+// The next frames received are saved with what the ROV was doing:
+// depth and attitude go in the picture. Without video, nothing is
+// armed: the picture would come much later than its description.
+void
+MainWindow::takeSnapshot(int nFrames) {
+  if(!pVideoClient->isStreaming()) {
+    Logger::warning("snap", "No video: snapshot not taken");
+    return;
+  }
+  QByteArray description = "ROV snapshot\n";
+  if(depthEstimator.isValid()) {
+    description += "depth_m " + QByteArray::number(depthEstimator.depth(), 'f', 2) + "\n";
+    description += "vertical_speed_mps " + QByteArray::number(depthEstimator.verticalSpeed(), 'f', 2) + "\n";
+  }
+  for(int i=0; i<poses.count(); i++) {
+    description += "sensor " + QByteArray::number(i) + " attitude";
+    description += ' ' + QByteArray::number(poses.qw()[i], 'f', 5);
+    description += ' ' + QByteArray::number(poses.qx()[i], 'f', 5);
+    description += ' ' + QByteArray::number(poses.qy()[i], 'f', 5);
+    description += ' ' + QByteArray::number(poses.qz()[i], 'f', 5);
+    description += "\n";
+  }
+  pSnapshots->capture(nFrames, description);
+  pRecorder->addRecord("snapshot," + QByteArray::number(nFrames));
+}
+
+
+// Pilot commands go on the session timeline too, the polling
+// (still alive, depth requests) does not
+void
+MainWindow::sendControl() {
+  if(!tcpClient.isOpen()) return;
+  tcpClient.write(message);
+  QByteArray record("control");
+  for(int i=0; i<message.size(); i++)
+    record += ',' + QByteArray::number(int(message.at(i)));
+  pRecorder->addRecord(record);
+}
+
+
+// The pose of a sensor as it has just been stored
+void
+MainWindow::recordPose(int iSensorNumber) {
+  QByteArray record = "pose," + QByteArray::number(iSensorNumber);
+  const float* values[7] = { poses.qw(), poses.qx(), poses.qy(), poses.qz(),
+                             poses.px(), poses.py(), poses.pz() };
+  for(int k=0; k<7; k++)
+    record += ',' + QByteArray::number(values[k][iSensorNumber], 'g', 7);
+  pRecorder->addRecord(record);
+}
+
+
 
 void
 MainWindow::onWatchDogTimerTimeout() {
   if(tcpClient.isOpen()) {
     tcpClient.close();
-    console.appendPlainText("Timeout in getting data from ROV");
+    Logger::warning("link", "Timeout in getting data from ROV");
   }
 }
 
 
 void
 MainWindow::updateWidgets() {
-  pFrontWidget->updateGL();
+  pFrontWidget->scheduleUpdate();
 }
 
 
@@ -178,6 +243,37 @@ MainWindow::onGetDepthTimerTimeout() {
 }
 
 
+void
+MainWindow::onDepthHoldToggled(bool bChecked) {
+  depthHoldTarget = depthEstimator.depth();
+  // Leave the vertical thrusters as the pilot wants them
+  if(!bChecked && pilotUpDown == 0 && tcpClient.isOpen()) {
+    pPanel->setValue(pUpDown, 0);
+    message.clear();
+    message.append(char(upDownAxis));
+    message.append(char(0));
+    sendControl();
+  }
+}
+
+
+// Depth hold assist: while the pilot leaves the up/down stick alone
+// the vertical thrust comes from a PD law on the predicted depth
+void
+MainWindow::holdDepth() {
+  if(!pCheckDepthHold->isChecked() || pilotUpDown != 0) return;
+  if(!depthEstimator.isValid() || !tcpClient.isOpen()) return;
+  float error  = depthEstimator.predict(predictor.now() + depthHoldLookahead) - depthHoldTarget;// > 0: too deep
+  float thrust = -(depthHoldGain*error + depthHoldDamping*depthEstimator.verticalSpeed());
+  int command = qBound(-10, qRound(thrust), 10) * diveDirection;
+  pPanel->setValue(pUpDown, command);
+  message.clear();
+  message.append(char(upDownAxis));
+  message.append(char(command));
+  sendControl();
+}
+
+
 void
 MainWindow::initCamera() {
   //     Set(eyePosX, eyePosY, eyePosZ, centerX, centerY, centerZ, upX, upY, upZ)
@@ -188,21 +284,63 @@ MainWindow::initCamera() {
 }
 
 
+// With "--latency-probe URL" the video is taken from a synthetic
+// stream (tools/mjpegsource) instead of the ROV, and its capture to
+// display latency is reported every few seconds.
+// "--latency-log FILE" also writes every frame to a CSV file.
+void
+MainWindow::initLatencyProbe() {
+  QStringList arguments = QCoreApplication::arguments();
+  int i = arguments.indexOf("--latency-probe");
+  if(i < 0 || i+1 >= arguments.size())
+    return;
+  sVideoURL = arguments.at(i+1);
+  pLatencyProbe = new LatencyProbe(pVideoClient);
+  i = arguments.indexOf("--latency-log");
+  if(i >= 0 && i+1 < arguments.size() && !pLatencyProbe->setLogFile(arguments.at(i+1)))
+    Logger::error("probe", "Unable to write " + arguments.at(i+1));
+  connect(&latencyReportTimer, SIGNAL(timeout()), this, SLOT(onLatencyReportTimeout()));
+}
+
+
+void
+MainWindow::onLatencyReportTimeout() {
+  foreach(const QString& sLine, pLatencyProbe->report().split('\n', QString::SkipEmptyParts))
+    Logger::info("probe", sLine);
+  Logger::infof("probe", "Jitter buffer: delay %.1f ms, %lld frames late, %lld dropped",
+                 pVideoClient->playoutDelay()/1.0e6,
+                 (long long)pVideoClient->framesLate(),
+                 (long long)pVideoClient->framesDropped());
+}
+
+
 void
 MainWindow::initWidgets() {
-  boxes.clear();
-  boxes.append(new Shimmer3Box());
-  pFrontWidget = new GLWidget(&camera, this);
+  poses.clear();
+  poses.ensure(0);
+  // With --threaded-render the scene is drawn by a dedicated thread
+  // and the GUI thread only composites the result
+  bool bThreadedRender = QCoreApplication::arguments().contains("--threaded-render");
+  pFrontWidget = new GLWidget(&camera, this, bThreadedRender);
+  pFrontWidget->setAssetLoader(&assets);
   camera.Set(-2.0,     0.0,     0.0,     0.0,     0.0,     0.0,     0.0, 0.0, 1.0);
   pFrontWidget->lightPos = QVector4D(-2800, -2800, 2800, 1.0);
 
-  pFrontWidget->setShimmerBoxes(&boxes);
+  pFrontWidget->setPoseStore(&poses);
+  pFrontWidget->setPosePredictor(&predictor);
+  // One surface: the video with the attitude model over it
+  if(pLatencyProbe)
+    pFrontWidget->setVideoSource(pLatencyProbe);
+  else
+    pFrontWidget->setVideoSource(pVideoClient);
+  connect(pVideoClient, SIGNAL(frameReady()), pFrontWidget, SLOT(scheduleUpdate()));
   pFrontWidget->setFixedSize(widgetSize);
 }
 
 
 void
 MainWindow::initLayout() {
+  pPanel       = new PanelModel(this, this);
   pMainLayout  = new QHBoxLayout;
   pLeftLayout  = new QVBoxLayout;
   pAngleRow    = new QVBoxLayout;
@@ -228,11 +366,15 @@ MainWindow::initLayout() {
   pDepth->setInvertedAppearance(true);
 
   pDepthEdit            = new QLineEdit("0", this);
+  pVerticalSpeedEdit    = new QLineEdit("0.00 m/s", this);
+  pVerticalSpeedEdit->setReadOnly(true);
 
   pEditHostName         = new QLineEdit("192.168.1.123", this);
   pButtonConnect        = new QPushButton("Connect", this);
   pCheckInflate         = new QCheckBox("Inflate");
   pCheckDeflate         = new QCheckBox("Deflate");
+  pCheckDepthHold       = new QCheckBox("Depth Hold");
+  pCheckDepthHold->setEnabled(false);
 
   pSpeedRowLayout    = new QHBoxLayout;
   pSpeedRowLayout->addWidget(pSpeed,     0, Qt::AlignCenter);
@@ -245,6 +387,7 @@ MainWindow::initLayout() {
   pDepthRowLayout = new QHBoxLayout;
   pDepthRowLayout->addWidget(pDepth,    0, Qt::AlignCenter);
   pDepthRowLayout->addWidget(pDepthEdit,    0, Qt::AlignCenter);
+  pDepthRowLayout->addWidget(pVerticalSpeedEdit, 0, Qt::AlignCenter);
 
   pAngleRow->addLayout(pSpeedRowLayout);
   pAngleRow->addSpacing(10);
@@ -254,6 +397,7 @@ MainWindow::initLayout() {
   pAngleRow->addSpacing(10);
   pAngleRow->addWidget(pCheckInflate, 0, Qt::AlignCenter);
   pAngleRow->addWidget(pCheckDeflate, 0, Qt::AlignCenter);
+  pAngleRow->addWidget(pCheckDepthHold, 0, Qt::AlignCenter);
 
   pButtonRow->addWidget(pEditHostName);
   pButtonRow->addWidget(pButtonConnect);
@@ -262,7 +406,9 @@ MainWindow::initLayout() {
   pButtonRecording   = new QPushButton("StartRec");
   pButtonResetOrientation = new QPushButton("Reset Pos");
   pButtonSwitchOff        = new QPushButton("Switch Off");
+  pButtonSnapshot         = new QPushButton("Snapshot");
   pButtonRowLayout->addWidget(pButtonRecording);
+  pButtonRowLayout->addWidget(pButtonSnapshot);
   pButtonRowLayout->addWidget(pButtonResetOrientation);
   pButtonRowLayout->addWidget(pButtonSwitchOff);
   pButtonRecording->setEnabled(false);
@@ -282,9 +428,6 @@ MainWindow::initLayout() {
 
   pGLBoxLayout = new QVBoxLayout();
   pGLBoxLayout->addWidget(pFrontWidget);
-#ifdef Q_OS_LINUX
-  pGLBoxLayout->addWidget(pVlcWidgetVideo);
-#endif
 
   pMainLayout->addLayout(pLeftLayout);
   pMainLayout->addLayout(pGLBoxLayout);
@@ -309,22 +452,17 @@ MainWindow::handleLookup(QHostInfo hostInfo) {
   // Handle the results.
   if(hostInfo.error() == QHostInfo::NoError) {
     serverAddress = hostInfo.addresses().first();
-    console.appendPlainText("Connecting to: " + hostInfo.hostName());
+    Logger::info("link", "Connecting to: " + hostInfo.hostName());
     bytesWritten = 0;
     bytesReceived = 0;
     tcpClient.connectToHost(serverAddress, 43210);
-#ifdef Q_OS_LINUX
-      if(pVlcMedia) {
-        delete pVlcMedia;
-        pVlcMedia = NULL;
-      }
-//      sVideoURL = QString("http://") + hostInfo.hostName() + QString(":8080/?action=stream");
+//    sVideoURL = QString("http://") + hostInfo.hostName() + QString(":8080/?action=stream");
+    if(!pLatencyProbe) {
       sVideoURL = QString("http://192.168.1.124:8080/?action=stream");
-      pVlcMedia = new VlcMedia(sVideoURL, pVlcInstance);
-      pVlcPlayer->open(pVlcMedia);
-#endif
+      pVideoClient->open(QUrl(sVideoURL));
+    }
   } else {
-    console.appendPlainText(hostInfo.errorString());
+    Logger::error("link", hostInfo.errorString());
     pButtonConnect->setEnabled(true);
     pEditHostName->setEnabled(true);
   }
@@ -334,11 +472,11 @@ MainWindow::handleLookup(QHostInfo hostInfo) {
 void
 MainWindow::displayError(QAbstractSocket::SocketError socketError) {
   if(socketError == QTcpSocket::RemoteHostClosedError) {
-    console.appendPlainText("The remote host has closed the connection");
+    Logger::warning("link", "The remote host has closed the connection");
     tcpClient.close();
     return;
   }
-  console.appendPlainText(tcpClient.errorString());
+  Logger::error("link", tcpClient.errorString());
   tcpClient.close();
   pButtonConnect->setEnabled(true);
   pEditHostName->setEnabled(true);
@@ -347,13 +485,13 @@ MainWindow::displayError(QAbstractSocket::SocketError socketError) {
 
 void
 MainWindow::onServerConnected() {
-  console.appendPlainText("Connected");
+  Logger::info("link", "Connected");
   pButtonConnect->setText("Disconnect");
   pButtonConnect->setEnabled(true);
   pButtonResetOrientation->setEnabled(true);
-#ifdef Q_OS_LINUX
   pButtonRecording->setEnabled(true);
-#endif
+  pCheckDepthHold->setEnabled(true);
+  depthEstimator.reset();
   watchDogTimer.start(watchDogTime);
   getDepthTimer.start(getDepthTime);
 }
@@ -361,25 +499,16 @@ MainWindow::onServerConnected() {
 
 void
 MainWindow::onServerDisconnected() {
-  console.appendPlainText("Disconnected");
+  Logger::info("link", "Disconnected");
   pButtonConnect->setText("Connect");
   pEditHostName->setEnabled(true);
-#ifdef Q_OS_LINUX
-  pVlcPlayer->stop();
-  if(pVlcMedia) {
-    delete pVlcMedia;
-    pVlcMedia = NULL;
-  }
-  QStringList arguments = VlcCommon::args();
-  arguments.append(QString("--network-caching=200"));
-  VlcInstance* pNewVlcInstance = new VlcInstance(arguments, this);
-  VlcMediaPlayer* pNewVlcPlayer = new VlcMediaPlayer(pNewVlcInstance);
-  pVlcWidgetVideo->setMediaPlayer(pNewVlcPlayer);
-  pNewVlcPlayer->setVideoWidget(pVlcWidgetVideo);
-#endif
+  if(!pLatencyProbe)
+    pVideoClient->close();
+  stopRecording();
   pButtonRecording->setEnabled(false);
   pButtonResetOrientation->setEnabled(false);
-  pButtonRecording->setText("StartRec");
+  pCheckDepthHold->setChecked(false);
+  pCheckDepthHold->setEnabled(false);
   watchDogTimer.stop();
   getDepthTimer.stop();
 }
@@ -398,6 +527,21 @@ MainWindow::onNewDataAvailable() {
     receivedCommand = receivedCommand.mid(iPos+1);
     iPos = receivedCommand.indexOf("#");
   }
+  // The raw samples just received are fused all together
+  if(fusion.update() > 0) {
+    const std::vector<int>& sensors = fusion.updatedSensors();
+    qint64 now = predictor.now();
+    float w, x, y, z;
+    for(size_t i=0; i<sensors.size(); i++) {
+      int iSensorNumber = sensors[i];
+      if(!poses.ensure(iSensorNumber)) continue;
+      fusion.orientation(iSensorNumber, w, x, y, z);
+      poses.setOrientation(iSensorNumber, w, x, y, z, now);
+      predictor.addSample(poses, iSensorNumber);
+      recordPose(iSensorNumber);
+    }
+    updateWidgets();
+  }
 }
 
 
@@ -408,33 +552,53 @@ MainWindow::executeCommand(QString command) {
     tokens.removeFirst();
     if(tokens.count() == 8) {
       int iSensorNumber = tokens.at(0).toInt();
-      if(iSensorNumber >= boxes.count()) {
-        for(int i=boxes.count(); i<=iSensorNumber; i++) {
-          boxes.append(new Shimmer3Box());
-        }
-      }
-      if(iSensorNumber < boxes.count()) {
-        Shimmer3Box* pBox = boxes[iSensorNumber];
-        pBox->x      = tokens.at(1).toDouble();
-        pBox->y      = tokens.at(2).toDouble();
-        pBox->z      = tokens.at(3).toDouble();
-        pBox->pos[0] = tokens.at(4).toDouble();
-        pBox->pos[1] = tokens.at(5).toDouble();
-        pBox->pos[2] = tokens.at(6).toDouble();
-        pBox->angle  = tokens.at(7).toDouble();
+      // Sensor numbers beyond the store capacity are ignored
+      if(poses.ensure(iSensorNumber)) {
+        poses.setPose(iSensorNumber,
+                      tokens.at(7).toFloat(),// angle
+                      tokens.at(1).toFloat(),// axis
+                      tokens.at(2).toFloat(),
+                      tokens.at(3).toFloat(),
+                      tokens.at(4).toFloat(),// position
+                      tokens.at(5).toFloat(),
+                      tokens.at(6).toFloat(),
+                      predictor.now());
+        predictor.addSample(poses, iSensorNumber);
+        recordPose(iSensorNumber);
         updateWidgets();
       }
     }
 
+  } else if(command.contains(QString("imu"))) {
+    // Raw samples: "imu sensor dt gx gy gz ax ay az mx my mz" with dt
+    // in us and the gyroscope in deg/s. They are queued here and fused
+    // by onNewDataAvailable().
+    QStringList tokens = command.split(' ');
+    tokens.removeFirst();
+    if(tokens.count() == 11) {
+      ImuSample sample;
+      sample.dt = tokens.at(1).toFloat()*1.0e-6f;
+      for(int i=0; i<3; i++) {
+        sample.gyro[i]  = tokens.at(2+i).toFloat()*float(M_PI/180.0);
+        sample.accel[i] = tokens.at(5+i).toFloat();
+        sample.mag[i]   = tokens.at(8+i).toFloat();
+      }
+      fusion.addSample(tokens.at(0).toInt(), sample);
+    }
+
   } else if(command.contains(QString("depth"))) {
       QStringList tokens = command.split(' ');
       tokens.removeFirst();
       double depth = tokens.at(0).toInt()/100.0;// Now in meters
 //      qDebug() << "Depth= " << depth;
-      pDepth->setValue(tokens.at(0).toInt());
-      QString sDepth;
-      sDepth.sprintf("%.2f", depth);
-      pDepthEdit->setText(sDepth);
+      depthEstimator.addSample(depth, predictor.now());
+      pRecorder->addRecord("depth," + QByteArray::number(depth, 'f', 2) + ',' +
+                           QByteArray::number(depthEstimator.depth(), 'f', 3) + ',' +
+                           QByteArray::number(depthEstimator.verticalSpeed(), 'f', 3));
+      pPanel->setValue(pDepth, qRound(depthEstimator.depth()*100.0f));
+      pPanel->setText(pDepthEdit, QString::number(depthEstimator.depth(), 'f', 2));
+      pPanel->setText(pVerticalSpeedEdit, QString("%1 m/s").arg(depthEstimator.verticalSpeed(), 0, 'f', 2));
+      holdDepth();
 
   } else if(command.contains(QString("alive"))) {
         watchDogTimer.start(watchDogTime);
@@ -444,9 +608,13 @@ MainWindow::executeCommand(QString command) {
 
 int
 MainWindow::start() {
+  if(pLatencyProbe) {
+    pVideoClient->open(QUrl(sVideoURL));
+    latencyReportTimer.start(5000);
+  }
   // Ensure that the joystick was found and that we can use it
   if (!pJoystick->isFound()) {
-    console.appendPlainText("Joystick open failed.");
+    Logger::error("joy", "Joystick open failed.");
     return joystickNotFoundError;
   }
   pJoystick->moveToThread(&joystickThread);
@@ -467,83 +635,79 @@ MainWindow::onJoystickMessage(JoystickEvent* pEvent) {
     message.clear();
     if (pEvent->isButton()) {
         if(pEvent->number == InflateButton) {//Inflate Button
-          pCheckInflate->setChecked(pEvent->value ? true : false);
+          pPanel->setChecked(pCheckInflate, pEvent->value ? true : false);
           message.append(char(pEvent->number+100));
           message.append(char(pEvent->value));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
         }
         else if(pEvent->number == DeflateButton) {//Deflate Button
-          pCheckDeflate->setChecked(pEvent->value ? true : false);
+          pPanel->setChecked(pCheckDeflate, pEvent->value ? true : false);
           message.append(char(pEvent->number+100));
           message.append(char(pEvent->value));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
+        }
+        else if(pEvent->number == SnapshotButton && pEvent->value) {
+          takeSnapshot(1);
+        }
+        else if(pEvent->number == BurstButton && pEvent->value) {
+          takeSnapshot(snapshotBurst);
         }
     }
     else if (pEvent->isAxis()) {
       if(pEvent->number == upDownAxis) {//Left stick Y
-          pUpDown->setValue(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
+          pilotUpDown = pEvent->value*10/JoystickEvent::MAX_AXES_VALUE;
+          // Releasing the stick holds the depth reached
+          if(pilotUpDown == 0)
+            depthHoldTarget = depthEstimator.depth();
+          pPanel->setValue(pUpDown, pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
           message.append(char(pEvent->number));
           message.append(char(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
       }
       if(pEvent->number == pitchAxis) {//Left stick X
-          pPitch->setValue(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
+          pPanel->setValue(pPitch, pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
           message.append(char(pEvent->number));
           message.append(char(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
       }
       else if(pEvent->number == SpeedAxis) {//Right stick Up/Down (Motor Speed)
-          pSpeed->setValue(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
+          pPanel->setValue(pSpeed, pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
           message.append(char(pEvent->number));
           message.append(char(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
       }
       else if(pEvent->number == LeftRightAxis) {//Right stick Left/Right (Motor Speed)
-          pDirection->setValue(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
+          pPanel->setValue(pDirection, pEvent->value*10/JoystickEvent::MAX_AXES_VALUE);
           message.append(char(pEvent->number));
           message.append(char(pEvent->value*10/JoystickEvent::MAX_AXES_VALUE));
-          if(tcpClient.isOpen()) tcpClient.write(message);
+          sendControl();
       }
     }
 }
 
 
+// The frames are recorded as they are received (see StreamRecorder),
+// in segments of 5 minutes: "ROV_<date>_000.mjpeg" and its index
+// "ROV_<date>_000.idx", then "_001"... The telemetry and the pilot
+// commands go in "ROV_<date>.tlm", on the same timeline.
 void
 MainWindow::startSopRecording() {
-  pVlcPlayer->stop();
-  if(pVlcMedia) {
-    delete pVlcMedia;
-    pVlcMedia = NULL;
-  }
-  VlcInstance* pNewVlcInstance = NULL;
-  VlcMediaPlayer* pNewVlcPlayer = NULL;
-  QStringList arguments = VlcCommon::args();
-  arguments.append(QString("--network-caching=200"));
-  if(pButtonRecording->text() == tr("StartRec")) {
-    // The following is mandatory for using VLC-Qt and all its other classes.
-    QString sFileName = QString("/home/rov/Video/ROV_") + dateTime.currentDateTime().toString() + QString(".avi");
-    sFileName.replace(" ", "_");
-    qDebug() << sFileName;
-    QString argument = QString("--sout=#duplicate{dst=std{access=file,mux=avi,dst='") + sFileName + QString("'},dst=display}");
-    qDebug() << argument;
-    arguments.append(argument);
-
-    pNewVlcInstance = new VlcInstance(arguments, this);
-    pNewVlcPlayer = new VlcMediaPlayer(pNewVlcInstance);
-    pVlcWidgetVideo->setMediaPlayer(pNewVlcPlayer);
-    pNewVlcPlayer->setVideoWidget(pVlcWidgetVideo);
-    pButtonRecording->setText("StopRec");
-  } else {//pButtonConnect->text() == tr("StopRec")
-    pNewVlcInstance = new VlcInstance(arguments, this);
-    pNewVlcPlayer = new VlcMediaPlayer(pNewVlcInstance);
-    pVlcWidgetVideo->setMediaPlayer(pNewVlcPlayer);
-    pNewVlcPlayer->setVideoWidget(pVlcWidgetVideo);
-    pButtonRecording->setText("StartRec");
+  if(pRecorder->isRecording()) {
+    stopRecording();
+    return;
   }
-  delete pVlcPlayer;
-  delete pVlcInstance;
-  pVlcPlayer = pNewVlcPlayer;
-  pVlcInstance = pNewVlcInstance;
-  pVlcMedia = new VlcMedia(sVideoURL, pVlcInstance);
-  pVlcPlayer->open(pVlcMedia);
+  QString sPrefix = QString("/home/rov/Video/ROV_") +
+                    QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
+  Logger::info("rec", "Recording to " + sPrefix);
+  if(!pRecorder->start(sPrefix)) return;
+  pButtonRecording->setText("StopRec");
+}
+
+
+void
+MainWindow::stopRecording() {
+  if(!pRecorder->isRecording()) return;
+  Logger::infof("rec", "Recording stopped, %lld frames dropped", (long long)pRecorder->framesDropped());
+  pRecorder->stop();
+  pButtonRecording->setText("StartRec");
 }
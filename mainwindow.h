@@ -12,6 +12,11 @@
 #include <QTimer>
 
 #include "GrCamera.h"
+#include "assetloader.h"
+#include "posestore.h"
+#include "posepredictor.h"
+#include "imufusion.h"
+#include "depthestimator.h"
 
 QT_FORWARD_DECLARE_CLASS(Joystick)
 QT_FORWARD_DECLARE_CLASS(QDial)
@@ -23,15 +28,13 @@ QT_FORWARD_DECLARE_CLASS(QVBoxLayout)
 QT_FORWARD_DECLARE_CLASS(JoystickEvent)
 QT_FORWARD_DECLARE_CLASS(Joystick)
 QT_FORWARD_DECLARE_CLASS(QCheckBox)
-QT_FORWARD_DECLARE_CLASS(Shimmer3Box)
 QT_FORWARD_DECLARE_CLASS(GLWidget)
+QT_FORWARD_DECLARE_CLASS(MjpegClient)
+QT_FORWARD_DECLARE_CLASS(LatencyProbe)
+QT_FORWARD_DECLARE_CLASS(StreamRecorder)
+QT_FORWARD_DECLARE_CLASS(SnapshotWriter)
+QT_FORWARD_DECLARE_CLASS(PanelModel)
 
-#ifdef Q_OS_LINUX
-  QT_FORWARD_DECLARE_CLASS(VlcInstance)
-  QT_FORWARD_DECLARE_CLASS(VlcMedia)
-  QT_FORWARD_DECLARE_CLASS(VlcMediaPlayer)
-  QT_FORWARD_DECLARE_CLASS(VlcWidgetVideo)
-#endif
 
 class MainWindow : public QWidget
 {
@@ -48,6 +51,12 @@ private:
   void initWidgets();
   void initLayout();
   void executeCommand(QString command);
+  void holdDepth();
+  void stopRecording();
+  void initLatencyProbe();
+  void sendControl();
+  void recordPose(int iSensorNumber);
+  void takeSnapshot(int nFrames);
 
 public:
   static const int noError = -1;
@@ -61,8 +70,12 @@ public:
 
   static const int DeflateButton  =   9;
   static const int InflateButton  =  11;
+  static const int SnapshotButton =   0;
+  static const int BurstButton    =   1;
+  static const int snapshotBurst  =   5;// Frames
 
   static const int depthSensor    =  81;
+  static const int diveDirection  =   1;// Sign of the up/down axis going deeper
 
   static const int SetOrientation = 125;
   static const int StillAlive     = 126;
@@ -81,6 +94,10 @@ public slots:
   void onWatchDogTimerTimeout();
   void startSopRecording();
   void onGetDepthTimerTimeout();
+  void onDepthHoldToggled(bool bChecked);
+  void onLatencyReportTimeout();
+  void onSnapshot();
+  void showMessages(QString sBatch);
 
 signals:
   void operate();
@@ -88,7 +105,6 @@ signals:
 private:
   QTcpSocket tcpClient;
   QHostAddress serverAddress;
-  QDateTime     dateTime;
 
   int bytesWritten;
   int bytesReceived;
@@ -102,15 +118,18 @@ private:
   QSlider* pDepth;
 
   QLineEdit*   pDepthEdit;
+  QLineEdit*   pVerticalSpeedEdit;
   QLineEdit*   pEditHostName;
   QPushButton* pButtonConnect;
 
   QPushButton*  pButtonRecording;
   QPushButton*  pButtonResetOrientation;
   QPushButton*  pButtonSwitchOff;
+  QPushButton*  pButtonSnapshot;
 
   QCheckBox*   pCheckInflate;
   QCheckBox*   pCheckDeflate;
+  QCheckBox*   pCheckDepthHold;
 
   QHBoxLayout* pSpeedRowLayout;
   QHBoxLayout* pThrustersRowLayout;
@@ -134,22 +153,33 @@ private:
   QByteArray message;
   QString receivedCommand;
 
+  AssetLoader   assets;
   CGrCamera     camera;
   GLWidget*     pFrontWidget;
-  QVector<Shimmer3Box*> boxes; // The graphical objects
-
-#ifdef Q_OS_LINUX
-  VlcInstance*    pVlcInstance;
-  VlcMedia*       pVlcMedia;
-  VlcMediaPlayer* pVlcPlayer;
-  VlcWidgetVideo* pVlcWidgetVideo;
+  PoseStore     poses;         // One per sensor, written by the telemetry
+  PosePredictor predictor;     // Smooths the poses between telemetry samples
+  ImuFusion     fusion;        // Attitude from the raw IMU samples
+  DepthEstimator depthEstimator;
+
+  // Depth hold assist
+  int    pilotUpDown;       // Last up/down stick position
+  float  depthHoldTarget;   // in m
+  float  depthHoldGain;     // Thrust per m of depth error
+  float  depthHoldDamping;  // Thrust per m/s of vertical speed
+  qint64 depthHoldLookahead;// in ns
+
+  MjpegClient*    pVideoClient;
+  LatencyProbe*   pLatencyProbe;// Only with --latency-probe
   QString         sVideoURL;
-#endif
+  StreamRecorder* pRecorder;    // Gets the frames from pVideoClient
+  SnapshotWriter* pSnapshots;   // Idem, when asked
+  PanelModel*     pPanel;       // The widgets showing the sticks and the depth
 
   QSize           widgetSize;
   QTimer          stillAliveTimer;
   QTimer          watchDogTimer;
   QTimer          getDepthTimer;
+  QTimer          latencyReportTimer;
   int             stillAliveTime;
   int             watchDogTime;
   int             getDepthTime;
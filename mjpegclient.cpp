@@ -0,0 +1,346 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "mjpegclient.h"
+#include "sessionclock.h"
+#include "logger.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <string.h>
+
+#include <turbojpeg.h>
+
+
+MjpegClient::MjpegClient()
+  : QObject()
+  , pSocket(NULL)
+  , pPlayoutTimer(NULL)
+  , pDecoder(NULL)
+  , nDecoded(0)
+  , nDropped(0)
+  , nSkipped(0)
+  , nLate(0)
+  , delay(0)
+  , lastFrameTime(0)
+{
+  videoThread.setObjectName("Video");
+  moveToThread(&videoThread);
+  videoThread.start();
+}
+
+
+MjpegClient::~MjpegClient() {
+  stop();
+}
+
+
+void
+MjpegClient::stop() {
+  if(!videoThread.isRunning()) return;
+  // The socket must be deleted by the thread owning it
+  QMetaObject::invokeMethod(this, "releaseResources", Qt::BlockingQueuedConnection);
+  videoThread.quit();
+  videoThread.wait();
+}
+
+
+qint64
+MjpegClient::now() const {
+  return SessionClock::now();
+}
+
+
+// Every frame received is also given to the sink, in the video
+// thread, including the ones that are never decoded
+void
+MjpegClient::addFrameSink(MjpegFrameSink* pFrameSink) {
+  parser.addFrameSink(pFrameSink);
+}
+
+
+// Called from the GUI thread: the connection is made by the video thread
+void
+MjpegClient::open(const QUrl& url) {
+  QMetaObject::invokeMethod(this, "openStream", Qt::QueuedConnection, Q_ARG(QUrl, url));
+}
+
+
+void
+MjpegClient::close() {
+  QMetaObject::invokeMethod(this, "closeStream", Qt::QueuedConnection);
+}
+
+
+// Called from the rendering thread. The newest frame due is given,
+// the frame given back is recycled.
+bool
+MjpegClient::takeFrame(VideoFrame& frame) {
+  QMutexLocker locker(&mutex);
+  qint64 now = SessionClock::now();
+  int nDue = 0;
+  while(nDue < pending.size() && pending.at(nDue).presentationTime <= now)
+    nDue++;
+  if(nDue == 0) return false;
+  for(int i=0; i<nDue-1; i++)
+    spares.append(pending.takeFirst());
+  nDropped += nDue-1;
+  qSwap(frame, pending.first());
+  spares.append(pending.takeFirst());
+  return true;
+}
+
+
+qint64
+MjpegClient::framesDecoded() const {
+  QMutexLocker locker(&mutex);
+  return nDecoded;
+}
+
+
+qint64
+MjpegClient::framesDropped() const {
+  QMutexLocker locker(&mutex);
+  return nDropped + nSkipped;
+}
+
+
+qint64
+MjpegClient::framesLate() const {
+  QMutexLocker locker(&mutex);
+  return nLate;
+}
+
+
+qint64
+MjpegClient::playoutDelay() const {
+  QMutexLocker locker(&mutex);
+  return delay;
+}
+
+
+bool
+MjpegClient::isStreaming() const {
+  static const qint64 timeout = 1000000000;// ns
+  QMutexLocker locker(&mutex);
+  return lastFrameTime > 0 && SessionClock::now() - lastFrameTime < timeout;
+}
+
+
+void
+MjpegClient::openStream(QUrl url) {
+  if(!pSocket) {
+    pSocket = new QTcpSocket(this);
+    connect(pSocket, SIGNAL(connected()), this, SLOT(onConnected()));
+    connect(pSocket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(pSocket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(pSocket, SIGNAL(error(QAbstractSocket::SocketError)),
+            this, SLOT(onSocketError(QAbstractSocket::SocketError)));
+    pPlayoutTimer = new QTimer(this);
+    pPlayoutTimer->setSingleShot(true);
+    pPlayoutTimer->setTimerType(Qt::PreciseTimer);
+    connect(pPlayoutTimer, SIGNAL(timeout()), this, SLOT(schedulePlayout()));
+  }
+  if(!pDecoder)
+    pDecoder = tjInitDecompress();
+  pSocket->abort();
+  parser.reset();
+  jitter.reset();
+  streamUrl = url;
+  pSocket->connectToHost(url.host(), quint16(url.port(80)));
+}
+
+
+void
+MjpegClient::closeStream() {
+  if(pSocket)
+    pSocket->abort();
+  publishNoVideo();
+}
+
+
+// An empty frame tells the display to stop showing the last image,
+// at once: the frames still waiting are dropped
+void
+MjpegClient::publishNoVideo() {
+  {
+    QMutexLocker locker(&mutex);
+    nDropped += pending.size();
+    while(!pending.isEmpty())
+      spares.append(pending.takeFirst());
+    pending.append(VideoFrame());
+    pending.last().presentationTime = SessionClock::now();
+    lastFrameTime = 0;
+  }
+  emit frameReady();
+}
+
+
+// Video thread. The frame is swapped into the queue and replaced by
+// a spare buffer. If the queue is full the oldest frame is dropped:
+// delay is never accumulated.
+void
+MjpegClient::queueFrame(VideoFrame& frame) {
+  static const int maxPending = 10;// More than the largest playout delay
+  QMutexLocker locker(&mutex);
+  if(pending.size() >= maxPending) {
+    spares.append(pending.takeFirst());
+    nDropped++;
+  }
+  lastFrameTime = frame.receivedTime;
+  pending.append(VideoFrame());
+  qSwap(pending.last(), frame);
+  if(!spares.isEmpty())
+    frame = spares.takeLast();
+  nDecoded++;
+  nSkipped = parser.framesDropped();
+  nLate    = jitter.framesLate();
+  delay    = jitter.delay();
+}
+
+
+// Video thread: frameReady() when the first frame is due, and again
+// at the presentation time of the next one
+void
+MjpegClient::schedulePlayout() {
+  qint64 now  = SessionClock::now();
+  bool   bDue = false;
+  qint64 next = -1;
+  {
+    QMutexLocker locker(&mutex);
+    for(int i=0; i<pending.size(); i++) {
+      if(pending.at(i).presentationTime <= now)
+        bDue = true;
+      else {
+        next = pending.at(i).presentationTime;
+        break;
+      }
+    }
+  }
+  if(next >= 0)
+    pPlayoutTimer->start(int((next-now+999999)/1000000));
+  if(bDue)
+    emit frameReady();
+}
+
+
+// HTTP/1.0: the server answers without chunked encoding
+void
+MjpegClient::onConnected() {
+  pSocket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  QByteArray path = streamUrl.toEncoded(QUrl::RemoveScheme | QUrl::RemoveAuthority);
+  if(path.isEmpty()) path = "/";
+  QByteArray request = "GET " + path + " HTTP/1.0\r\n"
+                       "Host: " + streamUrl.host().toLatin1() + "\r\n"
+                       "\r\n";
+  pSocket->write(request);
+}
+
+
+void
+MjpegClient::onReadyRead() {
+  QByteArray data = pSocket->readAll();
+  if(!parser.feed(data.constData(), size_t(data.size()))) {
+    Logger::errorf("video", "%s", parser.errorString().c_str());
+    emit streamError(QString::fromStdString(parser.errorString()));
+    pSocket->abort();
+    return;
+  }
+  // Whatever arrived while the last frame was being decoded has
+  // just been parsed: only its newest complete frame is decoded.
+  if(!parser.takeFrame(jpeg)) return;
+  decodedFrame.receivedTime = SessionClock::now();
+  decodedFrame.captureTime  = parser.frameTimestamp();
+  decodedFrame.sequence     = parser.framesParsed() - 1;
+  if(!decode(jpeg, decodedFrame)) {
+    Logger::warningf("video", "Unable to decode a video frame: %s", tjGetErrorStr());
+    return;
+  }
+  decodedFrame.decodedTime = SessionClock::now();
+  // The decoding time is jitter too: it is measured up to here
+  if(decodedFrame.captureTime >= 0.0)
+    decodedFrame.presentationTime = jitter.playoutTime(qint64(decodedFrame.captureTime*1.0e9),
+                                                       decodedFrame.decodedTime);
+  else
+    decodedFrame.presentationTime = decodedFrame.decodedTime;
+  queueFrame(decodedFrame);
+  schedulePlayout();
+}
+
+
+void
+MjpegClient::onDisconnected() {
+  publishNoVideo();
+  Logger::info("video", "Stream closed");
+  emit streamClosed();
+}
+
+
+void
+MjpegClient::onSocketError(QAbstractSocket::SocketError socketError) {
+  if(socketError == QAbstractSocket::RemoteHostClosedError) return;
+  Logger::error("video", pSocket->errorString());
+  emit streamError(pSocket->errorString());
+}
+
+
+// Straight to the YCbCr planes: the color conversion is left to
+// the fragment shader. Grayscale streams get 1x1 neutral chroma.
+bool
+MjpegClient::decode(const std::vector<unsigned char>& jpeg, VideoFrame& frame) {
+  tjhandle decoder = tjhandle(pDecoder);
+  if(!decoder || jpeg.empty()) return false;
+  unsigned char* pJpeg = const_cast<unsigned char*>(&jpeg[0]);
+  unsigned long  size  = (unsigned long)jpeg.size();
+  int width, height, subsampling, colorspace;
+  if(tjDecompressHeader3(decoder, pJpeg, size, &width, &height, &subsampling, &colorspace) != 0)
+    return false;
+  if(colorspace == TJCS_CMYK || colorspace == TJCS_YCCK)
+    return false;
+
+  bool bGray = (subsampling == TJSAMP_GRAY);
+  frame.width        = width;
+  frame.height       = height;
+  frame.chromaWidth  = bGray ? 1 : tjPlaneWidth(1, width, subsampling);
+  frame.chromaHeight = bGray ? 1 : tjPlaneHeight(1, height, subsampling);
+  int lumaSize   = width * height;
+  int chromaSize = frame.chromaWidth * frame.chromaHeight;
+  // Reuses the allocation when the size does not change
+  frame.planes.resize(lumaSize + 2*chromaSize);
+
+  unsigned char* pPlanes[3];
+  pPlanes[0] = reinterpret_cast<unsigned char*>(frame.planes.data());
+  pPlanes[1] = pPlanes[0] + lumaSize;
+  pPlanes[2] = pPlanes[1] + chromaSize;
+  int strides[3] = { width, frame.chromaWidth, frame.chromaWidth };
+  if(bGray)
+    pPlanes[1][0] = pPlanes[2][0] = 128;
+  return tjDecompressToYUVPlanes(decoder, pJpeg, size, pPlanes, width, strides, height,
+                                 TJFLAG_FASTDCT) == 0;
+}
+
+
+void
+MjpegClient::releaseResources() {
+  delete pSocket;
+  pSocket = NULL;
+  delete pPlayoutTimer;
+  pPlayoutTimer = NULL;
+  if(pDecoder)
+    tjDestroy(tjhandle(pDecoder));
+  pDecoder = NULL;
+  // Give the object back so that it can be deleted by the GUI thread
+  moveToThread(QCoreApplication::instance()->thread());
+}
@@ -0,0 +1,96 @@
+#ifndef MJPEGCLIENT_H
+#define MJPEGCLIENT_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QUrl>
+#include <QList>
+#include <QAbstractSocket>
+#include <vector>
+
+#include "mjpegparser.h"
+#include "jitterbuffer.h"
+#include "videoframe.h"
+
+QT_FORWARD_DECLARE_CLASS(QTcpSocket)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+
+// Native client of the mjpg-streamer "?action=stream" feed.
+//
+// The socket is read, the multipart stream parsed and the newest
+// JPEG decoded (libjpeg-turbo, straight to YCbCr planes) in a thread
+// of its own. Frames superseded before being decoded are dropped.
+//
+// Decoded frames wait for their presentation time, given by an
+// adaptive jitter buffer from the camera timestamps (see
+// jitterbuffer.h): just enough delay to absorb the jitter of the
+// link. takeFrame() gives the newest frame due; older frames due are
+// dropped, never shown late. Streams without timestamps are shown
+// as soon as decoded. Frame buffers are recycled between the decoder,
+// the queue and the display, without copies or allocations.
+class MjpegClient : public QObject, public VideoSource
+{
+  Q_OBJECT
+
+public:
+  MjpegClient();
+  ~MjpegClient();
+
+  void open(const QUrl& url);
+  void close();
+  void stop();
+  qint64 now() const;
+  void addFrameSink(MjpegFrameSink* pFrameSink);// Before open()
+
+  bool takeFrame(VideoFrame& frame);
+
+  qint64 framesDecoded() const;
+  qint64 framesDropped() const;
+  qint64 framesLate() const;  // Decoded after their presentation time
+  qint64 playoutDelay() const;// ns, added by the jitter buffer
+  bool   isStreaming() const; // A frame was received in the last second
+
+signals:
+  void frameReady();
+  void streamError(QString sError);
+  void streamClosed();
+
+private slots:
+  void openStream(QUrl url);
+  void closeStream();
+  void onConnected();
+  void onReadyRead();
+  void onDisconnected();
+  void onSocketError(QAbstractSocket::SocketError socketError);
+  void schedulePlayout();
+  void releaseResources();
+
+private:
+  bool decode(const std::vector<unsigned char>& jpeg, VideoFrame& frame);
+  void publishNoVideo();
+  void queueFrame(VideoFrame& frame);
+
+  QThread       videoThread;
+  QTcpSocket*   pSocket;
+  QTimer*       pPlayoutTimer;
+  QUrl          streamUrl;
+  MjpegParser   parser;
+  void*         pDecoder;// tjhandle
+  std::vector<unsigned char> jpeg;
+  VideoFrame    decodedFrame;// Owned by the video thread
+  JitterBuffer  jitter;
+
+  mutable QMutex mutex;
+  QList<VideoFrame> pending;// In presentation order
+  QList<VideoFrame> spares;
+  qint64        nDecoded;
+  qint64        nDropped;// Decoded but never displayed
+  qint64        nSkipped;// Not even decoded
+  qint64        nLate;
+  qint64        delay;
+  qint64        lastFrameTime;// Received, ns; 0 with no stream
+};
+
+#endif // MJPEGCLIENT_H
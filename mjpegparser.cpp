@@ -0,0 +1,305 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "mjpegparser.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static const size_t maxHeaderSize = 16384;
+static const size_t maxPartSize   = 4 << 20;// Far more than any camera JPEG
+
+
+static std::string
+toLower(const std::string& s) {
+  std::string lower(s);
+  for(size_t i=0; i<lower.size(); i++)
+    lower[i] = char(tolower((unsigned char)lower[i]));
+  return lower;
+}
+
+
+// Value of the header line "name: value" (name in lower case)
+static bool
+headerValue(const std::string& header, const std::string& name, std::string& value) {
+  std::string lower = toLower(header);
+  size_t pos = 0;
+  while((pos = lower.find(name, pos)) != std::string::npos) {
+    bool bLineStart = (pos == 0) || (lower[pos-1] == '\n');
+    size_t colon = pos + name.size();
+    pos = colon;
+    if(!bLineStart || colon >= lower.size() || lower[colon] != ':') continue;
+    size_t start = header.find_first_not_of(" \t", colon+1);
+    size_t end   = header.find_first_of("\r\n", colon+1);
+    if(start == std::string::npos || (end != std::string::npos && start >= end))
+      value.clear();
+    else
+      value = header.substr(start, end == std::string::npos ? std::string::npos : end-start);
+    return true;
+  }
+  return false;
+}
+
+
+// memchr() runs through JPEG data much faster than std::search()
+static size_t
+search(const std::vector<char>& buffer, size_t from, const char* pPattern, size_t length) {
+  if(buffer.size() < length || from > buffer.size()-length) return std::string::npos;
+  const char* pBegin = &buffer[0];
+  const char* pLast  = pBegin + buffer.size() - length;// Last possible start
+  for(const char* p=pBegin+from; p<=pLast; p++) {
+    p = static_cast<const char*>(memchr(p, pPattern[0], size_t(pLast-p) + 1));
+    if(!p) break;
+    if(memcmp(p, pPattern, length) == 0)
+      return size_t(p - pBegin);
+  }
+  return std::string::npos;
+}
+
+
+MjpegParser::MjpegParser() {
+  reset();
+}
+
+
+void
+MjpegParser::reset() {
+  state         = httpHeader;
+  buffer.clear();
+  readPos       = 0;
+  scanPos       = 0;
+  boundary.clear();
+  partLength    = -1;
+  partTimestamp = -1.0;
+  frame.clear();
+  timestamp      = -1.0;
+  takenTimestamp = -1.0;
+  bNewFrame     = false;
+  sError.clear();
+  nParsed       = 0;
+  nDropped      = 0;
+}
+
+
+bool
+MjpegParser::feed(const char* pData, size_t size) {
+  if(state == error) return false;
+
+  // Drop what has been parsed before it costs more than the copy
+  if(readPos > 0 && readPos >= buffer.size()/2) {
+    buffer.erase(buffer.begin(), buffer.begin()+readPos);
+    scanPos -= readPos;
+    readPos = 0;
+  }
+  buffer.insert(buffer.end(), pData, pData+size);
+
+  for(;;) {
+    size_t end;
+    switch(state) {
+      case httpHeader:
+        if(!findHeaderEnd(end)) return state != error;
+        if(!parseHttpHeader(std::string(&buffer[readPos], end-readPos))) return false;
+        readPos = scanPos = end + 4;
+        state = partBoundary;
+        break;
+
+      case partBoundary:
+        end = search(buffer, scanPos, boundary.data(), boundary.size());
+        if(end == std::string::npos) {
+          if(buffer.size() - readPos > maxPartSize) {
+            fail("Part too long");
+            return false;
+          }
+          // Keep the tail that could be the start of the boundary
+          if(buffer.size() >= boundary.size())
+            scanPos = std::max(scanPos, buffer.size() - boundary.size() + 1);
+          return true;
+        }
+        readPos = scanPos = end + boundary.size();
+        state = partHeader;
+        break;
+
+      case partHeader:
+        if(!findHeaderEnd(end)) return state != error;
+        parsePartHeader(std::string(&buffer[readPos], end-readPos));
+        // Never wait for bytes that could not be held
+        if(partLength > long(maxPartSize)) {
+          fail("Part too long");
+          return false;
+        }
+        readPos = scanPos = end + 4;
+        state = partBody;
+        break;
+
+      case partBody:
+        if(partLength >= 0) {
+          if(buffer.size() - readPos < size_t(partLength)) return true;
+          completeFrame(&buffer[readPos], size_t(partLength));
+          readPos = scanPos = readPos + size_t(partLength);
+        }
+        else {
+          std::string delimiter = "\r\n" + boundary;
+          end = search(buffer, scanPos, delimiter.data(), delimiter.size());
+          if(end == std::string::npos) {
+            if(buffer.size() - readPos > maxPartSize) {
+              fail("Part too long");
+              return false;
+            }
+            if(buffer.size() >= delimiter.size())
+              scanPos = std::max(scanPos, buffer.size() - delimiter.size() + 1);
+            return true;
+          }
+          completeFrame(&buffer[readPos], end-readPos);
+          readPos = scanPos = end + 2;
+        }
+        state = partBoundary;
+        break;
+
+      case error:
+        return false;
+    }
+  }
+}
+
+
+// End of a header block ("\r\n\r\n") starting at readPos
+bool
+MjpegParser::findHeaderEnd(size_t& end) {
+  end = search(buffer, scanPos, "\r\n\r\n", 4);
+  if(end != std::string::npos) return true;
+  if(buffer.size() - readPos > maxHeaderSize)
+    fail("Header too long");
+  else if(buffer.size() >= 3)
+    scanPos = std::max(scanPos, buffer.size() - 3);
+  return false;
+}
+
+
+bool
+MjpegParser::parseHttpHeader(const std::string& header) {
+  size_t lineEnd = header.find("\r\n");
+  std::string statusLine = header.substr(0, lineEnd);
+  size_t space = statusLine.find(' ');
+  if(statusLine.compare(0, 5, "HTTP/") != 0 || space == std::string::npos) {
+    fail("Not an HTTP response");
+    return false;
+  }
+  if(atoi(statusLine.c_str() + space + 1) != 200) {
+    fail("HTTP error: " + statusLine.substr(space + 1));
+    return false;
+  }
+
+  std::string contentType;
+  headerValue(header, "content-type", contentType);
+  std::string lower = toLower(contentType);
+  size_t pos = lower.find("boundary=");
+  if(lower.find("multipart/") == std::string::npos || pos == std::string::npos) {
+    fail("Not a multipart stream: " + contentType);
+    return false;
+  }
+  std::string value = contentType.substr(pos + 9);
+  value = value.substr(0, value.find_first_of("; \t"));
+  if(value.size() >= 2 && value[0] == '"')
+    value = value.substr(1, value.find('"', 1) - 1);
+  if(value.empty()) {
+    fail("Empty boundary");
+    return false;
+  }
+  // Some servers already put the leading dashes in the header
+  boundary = value.compare(0, 2, "--") == 0 ? value : "--" + value;
+  return true;
+}
+
+
+void
+MjpegParser::parsePartHeader(const std::string& header) {
+  std::string value;
+  partLength = -1;
+  if(headerValue(header, "content-length", value)) {
+    char* pEnd = NULL;
+    long length = strtol(value.c_str(), &pEnd, 10);
+    if(pEnd != value.c_str() && length >= 0)
+      partLength = length;
+  }
+  partTimestamp = -1.0;
+  if(headerValue(header, "x-timestamp", value))
+    partTimestamp = atof(value.c_str());
+}
+
+
+void
+MjpegParser::addFrameSink(MjpegFrameSink* pFrameSink) {
+  sinks.push_back(pFrameSink);
+}
+
+
+void
+MjpegParser::completeFrame(const char* pData, size_t size) {
+  for(size_t i=0; i<sinks.size(); i++)
+    sinks[i]->frameParsed(reinterpret_cast<const unsigned char*>(pData), size, partTimestamp);
+  if(bNewFrame) nDropped++;
+  frame.assign(pData, pData+size);
+  timestamp = partTimestamp;
+  bNewFrame = true;
+  nParsed++;
+}
+
+
+void
+MjpegParser::fail(const std::string& reason) {
+  state  = error;
+  sError = reason;
+}
+
+
+bool
+MjpegParser::takeFrame(std::vector<unsigned char>& jpeg) {
+  if(!bNewFrame) return false;
+  jpeg.swap(frame);
+  takenTimestamp = timestamp;
+  bNewFrame = false;
+  return true;
+}
+
+
+double
+MjpegParser::frameTimestamp() const {
+  return takenTimestamp;
+}
+
+
+bool
+MjpegParser::failed() const {
+  return state == error;
+}
+
+
+const std::string&
+MjpegParser::errorString() const {
+  return sError;
+}
+
+
+long long
+MjpegParser::framesParsed() const {
+  return nParsed;
+}
+
+
+long long
+MjpegParser::framesDropped() const {
+  return nDropped;
+}
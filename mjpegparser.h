@@ -0,0 +1,81 @@
+#ifndef MJPEGPARSER_H
+#define MJPEGPARSER_H
+
+#include <string>
+#include <vector>
+
+
+// Gets every complete frame, including the ones that will be
+// superseded before being taken (e.g. to record them). It is called
+// from within MjpegParser::feed() and must not keep the pointer.
+class MjpegFrameSink
+{
+public:
+  virtual ~MjpegFrameSink() {}
+  virtual void frameParsed(const unsigned char* pJpeg, size_t size, double timestamp) = 0;
+};
+
+
+// Incremental parser of an MJPEG over HTTP stream, as served by
+// mjpg-streamer ("?action=stream"): an HTTP response header, then a
+// multipart/x-mixed-replace body with one JPEG per part.
+//
+// Data is fed in whatever pieces the socket delivers. Parts are cut
+// by their Content-Length when present, otherwise by the next
+// boundary; bytes already scanned are never scanned again. Only the
+// newest complete frame is kept: older ones not taken in the meantime
+// are counted as dropped, since for live video a late frame is worth
+// nothing. A header over 16 KiB or a part over 4 MiB is an error:
+// the buffer never grows without bound.
+// Plain C++, to be benchmarked without Qt.
+class MjpegParser
+{
+public:
+  MjpegParser();
+
+  void reset();
+  void addFrameSink(MjpegFrameSink* pFrameSink);
+  bool feed(const char* pData, size_t size);// False once the stream is invalid
+
+  bool   takeFrame(std::vector<unsigned char>& jpeg);// Swaps the newest frame out
+  double frameTimestamp() const;// X-Timestamp of the taken frame, in s, or -1
+
+  bool               failed() const;
+  const std::string& errorString() const;
+  long long          framesParsed() const;
+  long long          framesDropped() const;
+
+private:
+  enum State {
+    httpHeader,
+    partBoundary,
+    partHeader,
+    partBody,
+    error
+  };
+
+  bool parseHttpHeader(const std::string& header);
+  void parsePartHeader(const std::string& header);
+  bool findHeaderEnd(size_t& end);
+  void completeFrame(const char* pData, size_t size);
+  void fail(const std::string& reason);
+
+  std::vector<MjpegFrameSink*> sinks;
+  State             state;
+  std::vector<char> buffer;
+  size_t            readPos;  // Start of the unparsed data
+  size_t            scanPos;  // Where the next search resumes
+  std::string       boundary; // "--" + boundary of the parts
+  long              partLength;// -1 if not given
+  double            partTimestamp;
+
+  std::vector<unsigned char> frame;
+  double      timestamp;
+  double      takenTimestamp;
+  bool        bNewFrame;
+  std::string sError;
+  long long   nParsed;
+  long long   nDropped;
+};
+
+#endif // MJPEGPARSER_H
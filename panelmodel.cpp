@@ -0,0 +1,75 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "panelmodel.h"
+
+#include <QAbstractSlider>
+#include <QAbstractButton>
+#include <QLineEdit>
+
+
+PanelModel::PanelModel(QWidget* pWindow, QObject* parent)
+  : QObject(parent)
+  , scheduler(pWindow, this)
+{
+  connect(&scheduler, SIGNAL(frameDue()), this, SLOT(onFrameDue()));
+}
+
+
+// A value already shown does not even start the timer
+void
+PanelModel::setValue(QAbstractSlider* pSlider, int value) {
+  if(!values.contains(pSlider) && pSlider->value() == value) return;
+  values[pSlider] = value;
+  scheduler.requestFrame();
+}
+
+
+void
+PanelModel::setText(QLineEdit* pEdit, const QString& sText) {
+  if(!texts.contains(pEdit) && pEdit->text() == sText) return;
+  texts[pEdit] = sText;
+  scheduler.requestFrame();
+}
+
+
+void
+PanelModel::setChecked(QAbstractButton* pButton, bool bChecked) {
+  if(!checks.contains(pButton) && pButton->isChecked() == bChecked) return;
+  checks[pButton] = bChecked;
+  scheduler.requestFrame();
+}
+
+
+void
+PanelModel::flush() {
+  for(QHash<QAbstractSlider*, int>::const_iterator i=values.constBegin(); i!=values.constEnd(); ++i)
+    i.key()->setValue(i.value());
+  for(QHash<QLineEdit*, QString>::const_iterator i=texts.constBegin(); i!=texts.constEnd(); ++i)
+    if(i.key()->text() != i.value())// setText() repaints anyway
+      i.key()->setText(i.value());
+  for(QHash<QAbstractButton*, bool>::const_iterator i=checks.constBegin(); i!=checks.constEnd(); ++i)
+    i.key()->setChecked(i.value());
+  values.clear();
+  texts.clear();
+  checks.clear();
+}
+
+
+// Only the last value of each widget is shown: a burst of joystick
+// events costs one repaint per widget
+void
+PanelModel::onFrameDue() {
+  flush();
+  scheduler.frameRendered();
+}
@@ -0,0 +1,43 @@
+#ifndef PANELMODEL_H
+#define PANELMODEL_H
+
+#include <QObject>
+#include <QHash>
+#include <QString>
+
+#include "renderscheduler.h"
+
+QT_FORWARD_DECLARE_CLASS(QAbstractSlider)
+QT_FORWARD_DECLARE_CLASS(QAbstractButton)
+QT_FORWARD_DECLARE_CLASS(QLineEdit)
+
+
+// The values shown by the instrument panel: sticks, depth, vertical
+// speed... They change at joystick and telemetry rate, far faster
+// than anybody can read them. The model keeps the latest value of
+// each widget and pushes the ones that changed at most once per
+// display refresh. With nothing changing, no timer runs.
+class PanelModel : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit PanelModel(QWidget* pWindow, QObject* parent = 0);
+
+  void setValue(QAbstractSlider* pSlider, int value);
+  void setText(QLineEdit* pEdit, const QString& sText);
+  void setChecked(QAbstractButton* pButton, bool bChecked);
+
+  void flush();// Now: when the widgets must be up to date at once
+
+private slots:
+  void onFrameDue();
+
+private:
+  RenderScheduler scheduler;
+  QHash<QAbstractSlider*, int>     values;
+  QHash<QLineEdit*, QString>       texts;
+  QHash<QAbstractButton*, bool>    checks;
+};
+
+#endif // PANELMODEL_H
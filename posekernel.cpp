@@ -0,0 +1,195 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "posekernel.h"
+#include "simdops.h"
+
+
+// With M = s*R*T(p) the inverse is T(-p)*R'/s, so the normal matrix
+// transpose(inverse(M)) has R/s in the upper 3x3 block and -p in the
+// bottom row. No inversion is needed.
+
+
+// Matrix elements of a block of poses. Element (row, col)
+// is at [col*4 + row], as in the column-major output.
+template<class Ops>
+static inline void
+computeBlock(const PoseArrays& poses, int i, const float* r, float scale,
+             typename Ops::V model[16], typename Ops::V normal[16])
+{
+  typedef typename Ops::V V;
+  V w = Ops::load(poses.qw + i);
+  V x = Ops::load(poses.qx + i);
+  V y = Ops::load(poses.qy + i);
+  V z = Ops::load(poses.qz + i);
+  if(r) {// Hamilton product reference * q
+    V rw = Ops::set1(r[0]), rx = Ops::set1(r[1]);
+    V ry = Ops::set1(r[2]), rz = Ops::set1(r[3]);
+    V nw = Ops::sub(Ops::sub(Ops::sub(Ops::mul(rw, w), Ops::mul(rx, x)), Ops::mul(ry, y)), Ops::mul(rz, z));
+    V nx = Ops::sub(Ops::add(Ops::add(Ops::mul(rw, x), Ops::mul(rx, w)), Ops::mul(ry, z)), Ops::mul(rz, y));
+    V ny = Ops::add(Ops::add(Ops::sub(Ops::mul(rw, y), Ops::mul(rx, z)), Ops::mul(ry, w)), Ops::mul(rz, x));
+    V nz = Ops::add(Ops::sub(Ops::add(Ops::mul(rw, z), Ops::mul(rx, y)), Ops::mul(ry, x)), Ops::mul(rz, w));
+    w = nw; x = nx; y = ny; z = nz;
+  }
+
+  // Rotation matrix of the (normalized) quaternion
+  V n2 = Ops::add(Ops::add(Ops::mul(w, w), Ops::mul(x, x)), Ops::add(Ops::mul(y, y), Ops::mul(z, z)));
+  V s2 = Ops::twoOver(n2);
+  V xs = Ops::mul(x, s2), ys = Ops::mul(y, s2), zs = Ops::mul(z, s2);
+  V wx = Ops::mul(w, xs), wy = Ops::mul(w, ys), wz = Ops::mul(w, zs);
+  V xx = Ops::mul(x, xs), xy = Ops::mul(x, ys), xz = Ops::mul(x, zs);
+  V yy = Ops::mul(y, ys), yz = Ops::mul(y, zs), zz = Ops::mul(z, zs);
+  V one = Ops::set1(1.0f);
+  V rot[9];// Column major 3x3
+  rot[0] = Ops::sub(one, Ops::add(yy, zz));
+  rot[1] = Ops::add(xy, wz);
+  rot[2] = Ops::sub(xz, wy);
+  rot[3] = Ops::sub(xy, wz);
+  rot[4] = Ops::sub(one, Ops::add(xx, zz));
+  rot[5] = Ops::add(yz, wx);
+  rot[6] = Ops::add(xz, wy);
+  rot[7] = Ops::sub(yz, wx);
+  rot[8] = Ops::sub(one, Ops::add(xx, yy));
+
+  V p[3];
+  p[0] = Ops::load(poses.px + i);
+  p[1] = Ops::load(poses.py + i);
+  p[2] = Ops::load(poses.pz + i);
+
+  V s    = Ops::set1(scale);
+  V invS = Ops::set1(1.0f/scale);
+  V zero = Ops::set1(0.0f);
+  for(int col=0; col<3; col++) {
+    for(int row=0; row<3; row++) {
+      model [col*4+row] = Ops::mul(s,    rot[col*3+row]);
+      normal[col*4+row] = Ops::mul(invS, rot[col*3+row]);
+    }
+    model [col*4+3] = zero;
+    normal[col*4+3] = Ops::sub(zero, p[col]);
+  }
+  for(int row=0; row<3; row++) {
+    V t = Ops::add(Ops::add(Ops::mul(model[row], p[0]), Ops::mul(model[4+row], p[1])),
+                   Ops::mul(model[8+row], p[2]));
+    model [12+row] = t;
+    normal[12+row] = zero;
+  }
+  model [15] = one;
+  normal[15] = one;
+}
+
+
+void
+poseMatricesScalar(const PoseArrays& poses, int first, int count,
+                   const float* pReference, float scale,
+                   float* pOut, int stride)
+{
+  float model[16], normal[16];
+  for(int i=first; i<first+count; i++) {
+    computeBlock<ScalarOps>(poses, i, pReference, scale, model, normal);
+    float* pDst = pOut + i*stride;
+    for(int k=0; k<16; k++) {
+      pDst[k]    = model[k];
+      pDst[16+k] = normal[k];
+    }
+  }
+}
+
+
+#ifdef SIMDOPS_SSE
+// Turns the element-wise vectors of 4 poses into 4 column-major
+// matrices, one column at a time
+static inline void
+storeFour(__m128 m[16], float* pDst, int stride) {
+  for(int col=0; col<4; col++) {
+    __m128 a = m[col*4+0];
+    __m128 b = m[col*4+1];
+    __m128 c = m[col*4+2];
+    __m128 d = m[col*4+3];
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(pDst + 0*stride + col*4, a);
+    _mm_storeu_ps(pDst + 1*stride + col*4, b);
+    _mm_storeu_ps(pDst + 2*stride + col*4, c);
+    _mm_storeu_ps(pDst + 3*stride + col*4, d);
+  }
+}
+#endif
+
+
+void
+poseMatrices(const PoseArrays& poses, int first, int count,
+             const float* pReference, float scale,
+             float* pOut, int stride)
+{
+  int i = first;
+  int end = first + count;
+#if defined(SIMDOPS_AVX)
+  __m256 model8[16], normal8[16];
+  __m128 model[16], normal[16];
+  for(; i+8<=end; i+=8) {
+    computeBlock<AvxOps>(poses, i, pReference, scale, model8, normal8);
+    for(int k=0; k<16; k++) {
+      model [k] = _mm256_castps256_ps128(model8[k]);
+      normal[k] = _mm256_castps256_ps128(normal8[k]);
+    }
+    storeFour(model,  pOut + i*stride,      stride);
+    storeFour(normal, pOut + i*stride + 16, stride);
+    for(int k=0; k<16; k++) {
+      model [k] = _mm256_extractf128_ps(model8[k],  1);
+      normal[k] = _mm256_extractf128_ps(normal8[k], 1);
+    }
+    storeFour(model,  pOut + (i+4)*stride,      stride);
+    storeFour(normal, pOut + (i+4)*stride + 16, stride);
+  }
+#elif defined(SIMDOPS_SSE)
+  __m128 model[16], normal[16];
+  for(; i+4<=end; i+=4) {
+    computeBlock<SseOps>(poses, i, pReference, scale, model, normal);
+    storeFour(model,  pOut + i*stride,      stride);
+    storeFour(normal, pOut + i*stride + 16, stride);
+  }
+#endif
+  // Whatever does not fill a vector
+  poseMatricesScalar(poses, i, end-i, pReference, scale, pOut, stride);
+}
+
+
+void
+axisAngleToQuaternions(int count,
+                       const float* angle,
+                       const float* axisX, const float* axisY, const float* axisZ,
+                       float* qw, float* qx, float* qy, float* qz)
+{
+  for(int i=0; i<count; i++) {
+    float length = sqrtf(axisX[i]*axisX[i] + axisY[i]*axisY[i] + axisZ[i]*axisZ[i]);
+    if(length > 0.0f) {
+      float halfAngle = 0.5f * angle[i] * float(M_PI/180.0);
+      float s = sinf(halfAngle) / length;
+      qw[i] = cosf(halfAngle);
+      qx[i] = axisX[i]*s;
+      qy[i] = axisY[i]*s;
+      qz[i] = axisZ[i]*s;
+    }
+    else {// No rotation
+      qw[i] = 1.0f;
+      qx[i] = 0.0f;
+      qy[i] = 0.0f;
+      qz[i] = 0.0f;
+    }
+  }
+}
+
+
+const char*
+poseKernelInstructionSet() {
+  return simdInstructionSet();
+}
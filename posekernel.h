@@ -0,0 +1,51 @@
+#ifndef POSEKERNEL_H
+#define POSEKERNEL_H
+
+
+// Batch conversion of sensor poses into the matrices used to draw them.
+// Plain C++ without Qt: the inputs are the structure of arrays of a
+// PoseStore, the outputs are column-major 4x4 float matrices.
+//
+// The work is done 8 poses at a time with AVX, 4 at a time with SSE2 or
+// one at a time otherwise (see simdops.h).
+
+
+struct PoseArrays
+{
+  const float* qw;// Rotation as a quaternion
+  const float* qx;
+  const float* qy;
+  const float* qz;
+  const float* px;// Position
+  const float* py;
+  const float* pz;
+};
+
+
+// For every pose i in [first, first+count) writes
+//
+//   model  = scale * R(reference * q[i]) * T(p[i])
+//   normal = transpose(inverse(model))
+//
+// at pOut + i*stride (model) and pOut + i*stride + 16 (normal).
+// The normal matrix exploits the rigid body form of the model
+// matrix instead of a general inversion. A NULL reference is the
+// identity; quaternions need not be normalized.
+void poseMatrices(const PoseArrays& poses, int first, int count,
+                  const float* pReference, float scale,
+                  float* pOut, int stride);
+
+// The same, one pose at a time
+void poseMatricesScalar(const PoseArrays& poses, int first, int count,
+                        const float* pReference, float scale,
+                        float* pOut, int stride);
+
+// Quaternions from rotations given as angle (in degrees) and axis
+void axisAngleToQuaternions(int count,
+                            const float* angle,
+                            const float* axisX, const float* axisY, const float* axisZ,
+                            float* qw, float* qx, float* qy, float* qz);
+
+const char* poseKernelInstructionSet();
+
+#endif // POSEKERNEL_H
@@ -0,0 +1,207 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "posepredictor.h"
+#include "sessionclock.h"
+
+#include <math.h>
+
+
+static const double nsPerSecond = 1.0e9;
+
+
+// Rotation by the vector omega*dt (omega in rad/s, dt in s)
+static QQuaternion
+rotationFromVelocity(const QVector3D& omega, double dt) {
+  float speed = omega.length();
+  if(speed <= 0.0f || dt <= 0.0) return QQuaternion();
+  return QQuaternion::fromAxisAndAngle(omega/speed, float(speed*dt*180.0/M_PI));
+}
+
+
+// Angle in degrees of a rotation
+static float
+rotationAngle(const QQuaternion& q) {
+  float w = qBound(-1.0f, qAbs(q.scalar())/q.length(), 1.0f);
+  return float(2.0*acos(w)*180.0/M_PI);
+}
+
+
+PosePredictor::PosePredictor()
+  : lookahead(50000000)          // 50 ms, about half of the link RTT
+  , maxExtrapolation(250000000)  // Two or three telemetry periods
+  , maxSampleGap(1000000000)
+  , blendTime(100000000)
+  , snapAngle(20.0f)
+  , snapDistance(0.5f)
+  , smoothing(0.5f)
+{
+}
+
+
+qint64
+PosePredictor::now() const {
+  return SessionClock::now();
+}
+
+
+void
+PosePredictor::setLookahead(qint64 ns) {
+  lookahead = ns;
+}
+
+
+void
+PosePredictor::setMaxExtrapolation(qint64 ns) {
+  maxExtrapolation = ns;
+}
+
+
+void
+PosePredictor::setBlendTime(qint64 ns) {
+  blendTime = qMax(ns, qint64(1));
+}
+
+
+void
+PosePredictor::setSnapThresholds(float degrees, float distance) {
+  snapAngle    = degrees;
+  snapDistance = distance;
+}
+
+
+void
+PosePredictor::clear() {
+  motions.clear();
+}
+
+
+void
+PosePredictor::extrapolate(const Motion& motion, qint64 time,
+                           QQuaternion& orientation, QVector3D& position) const
+{
+  qint64 age = qBound(qint64(0), time - motion.timestamp, maxExtrapolation);
+  double dt  = (age + lookahead) / nsPerSecond;
+  orientation = rotationFromVelocity(motion.angularVelocity, dt) * motion.orientation;
+  position    = motion.position + motion.linearVelocity * float(dt);
+
+  // What is left of the last correction
+  float decay = float(exp(-double(qMax(qint64(0), time - motion.timestamp))/blendTime));
+  orientation = QQuaternion::slerp(QQuaternion(), motion.correction, decay) * orientation;
+  position   += motion.offset * decay;
+}
+
+
+void
+PosePredictor::addSample(const PoseStore& store, int id) {
+  if(id >= motions.count()) {
+    int nOld = motions.count();
+    motions.resize(id+1);
+    for(int i=nOld; i<motions.count(); i++)
+      motions[i].bValid = false;
+  }
+  Motion& motion = motions[id];
+  QQuaternion orientation(store.qw()[id], store.qx()[id], store.qy()[id], store.qz()[id]);
+  QVector3D   position(store.px()[id], store.py()[id], store.pz()[id]);
+  qint64      timestamp = store.timestamps()[id];
+
+  qint64 gap = timestamp - motion.timestamp;
+  if(!motion.bValid || gap <= 0 || gap > maxSampleGap) {
+    motion.angularVelocity = QVector3D();
+    motion.linearVelocity  = QVector3D();
+    motion.correction      = QQuaternion();
+    motion.offset          = QVector3D();
+  }
+  else {
+    // Where the display is now...
+    QQuaternion displayed;
+    QVector3D   displayedPosition;
+    extrapolate(motion, timestamp, displayed, displayedPosition);
+
+    // ...the velocities given by the new sample...
+    double dt = gap / nsPerSecond;
+    QQuaternion delta = orientation * motion.orientation.conjugated();
+    if(delta.scalar() < 0.0f) delta = -delta;// Shortest arc
+    QVector3D axis;
+    float angle;
+    delta.getAxisAndAngle(&axis, &angle);
+    QVector3D omega = axis * float(angle*M_PI/180.0/dt);
+    QVector3D velocity = (position - motion.position) / float(dt);
+    motion.angularVelocity += (omega - motion.angularVelocity) * smoothing;
+    motion.linearVelocity  += (velocity - motion.linearVelocity) * smoothing;
+
+    // ...and the correction that keeps the display continuous
+    motion.orientation = orientation;
+    motion.position    = position;
+    motion.timestamp   = timestamp;
+    motion.correction  = QQuaternion();
+    motion.offset      = QVector3D();
+    QQuaternion target;
+    QVector3D   targetPosition;
+    extrapolate(motion, timestamp, target, targetPosition);
+    QQuaternion correction = displayed * target.conjugated();
+    if(rotationAngle(correction) <= snapAngle)
+      motion.correction = correction.normalized();
+    if((displayedPosition - targetPosition).length() <= snapDistance)
+      motion.offset = displayedPosition - targetPosition;
+  }
+  motion.orientation = orientation;
+  motion.position    = position;
+  motion.timestamp   = timestamp;
+  motion.bValid      = true;
+}
+
+
+// Sensors without samples are copied as they are
+void
+PosePredictor::predict(const PoseStore& measured, qint64 time, PoseStore& predicted) const {
+  if(predicted.capacity() < measured.capacity())
+    predicted = PoseStore(measured.capacity());
+  predicted.clear();
+  int nSensors = measured.count();
+  if(nSensors == 0) return;
+  predicted.ensure(nSensors-1);
+  QQuaternion orientation;
+  QVector3D   position;
+  for(int i=0; i<nSensors; i++) {
+    if(i < motions.count() && motions.at(i).bValid) {
+      extrapolate(motions.at(i), time, orientation, position);
+      predicted.setOrientation(i, orientation.scalar(), orientation.x(), orientation.y(), orientation.z(), time);
+      predicted.setPosition(i, position.x(), position.y(), position.z());
+    }
+    else {
+      predicted.setOrientation(i, measured.qw()[i], measured.qx()[i], measured.qy()[i], measured.qz()[i],
+                               measured.timestamps()[i]);
+      predicted.setPosition(i, measured.px()[i], measured.py()[i], measured.pz()[i]);
+    }
+  }
+}
+
+
+// The view has to be redrawn while a pose is being extrapolated
+// or a correction is being blended away
+bool
+PosePredictor::isExtrapolating(qint64 time) const {
+  for(int i=0; i<motions.count(); i++) {
+    const Motion& motion = motions.at(i);
+    if(!motion.bValid) continue;
+    qint64 age = time - motion.timestamp;
+    bool bMoving = !motion.angularVelocity.isNull() || !motion.linearVelocity.isNull();
+    if(bMoving && age < maxExtrapolation)
+      return true;
+    bool bCorrecting = !motion.correction.isIdentity() || !motion.offset.isNull();
+    if(bCorrecting && age < 5*blendTime)
+      return true;
+  }
+  return false;
+}
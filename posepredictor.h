@@ -0,0 +1,64 @@
+#ifndef POSEPREDICTOR_H
+#define POSEPREDICTOR_H
+
+#include <QVector>
+#include <QVector3D>
+#include <QQuaternion>
+
+#include "posestore.h"
+
+
+// Hides the low rate and the latency of the telemetry link.
+//
+// For every sensor the angular and linear velocities are estimated
+// from the last samples. At render time each pose is extrapolated
+// from its last sample to "now + lookahead". When a new sample
+// disagrees with what is being displayed the difference is blended
+// away (or snapped, when above the snap thresholds) instead of making
+// the model jump.
+//
+// Times are in ns on the session clock (see sessionclock.h).
+class PosePredictor
+{
+public:
+  PosePredictor();
+
+  qint64 now() const;
+
+  void setLookahead(qint64 ns);
+  void setMaxExtrapolation(qint64 ns);// Poses older than this are held
+  void setBlendTime(qint64 ns);       // Time constant of the corrections
+  void setSnapThresholds(float degrees, float distance);
+
+  void clear();
+  void addSample(const PoseStore& store, int id);// Uses the store timestamp
+  void predict(const PoseStore& measured, qint64 time, PoseStore& predicted) const;
+  bool isExtrapolating(qint64 time) const;// Is the prediction still moving?
+
+private:
+  struct Motion
+  {
+    QQuaternion orientation;// Last sample
+    QVector3D   position;
+    qint64      timestamp;
+    QVector3D   angularVelocity;// rad/s, world frame
+    QVector3D   linearVelocity;
+    QQuaternion correction;// displayed = correction * extrapolated
+    QVector3D   offset;    // Position correction
+    bool        bValid;
+  };
+
+  void extrapolate(const Motion& motion, qint64 time,
+                   QQuaternion& orientation, QVector3D& position) const;
+
+  QVector<Motion> motions;// One per sensor id
+  qint64 lookahead;
+  qint64 maxExtrapolation;
+  qint64 maxSampleGap;// Longer gaps reset the velocities
+  qint64 blendTime;
+  float  snapAngle;
+  float  snapDistance;
+  float  smoothing;// Weight of the newest velocity sample
+};
+
+#endif // POSEPREDICTOR_H
@@ -0,0 +1,107 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "posestore.h"
+#include "posekernel.h"
+
+
+PoseStore::PoseStore(int capacity)
+  : nCapacity(capacity)
+{
+  quatW.reserve(nCapacity);
+  quatX.reserve(nCapacity);
+  quatY.reserve(nCapacity);
+  quatZ.reserve(nCapacity);
+  posX.reserve(nCapacity);
+  posY.reserve(nCapacity);
+  posZ.reserve(nCapacity);
+  stamps.reserve(nCapacity);
+}
+
+
+int
+PoseStore::capacity() const {
+  return nCapacity;
+}
+
+
+int
+PoseStore::count() const {
+  return quatW.count();
+}
+
+
+// New sensors start at the origin with no rotation
+bool
+PoseStore::ensure(int id) {
+  if(id < 0 || id >= nCapacity) return false;
+  int nNew = id + 1;
+  int nOld = count();
+  if(nNew <= nOld) return true;
+  quatW.resize(nNew);
+  quatX.resize(nNew);
+  quatY.resize(nNew);
+  quatZ.resize(nNew);
+  posX.resize(nNew);
+  posY.resize(nNew);
+  posZ.resize(nNew);
+  stamps.resize(nNew);
+  for(int i=nOld; i<nNew; i++)
+    quatW[i] = 1.0f;
+  return true;
+}
+
+
+void
+PoseStore::clear() {
+  quatW.resize(0);
+  quatX.resize(0);
+  quatY.resize(0);
+  quatZ.resize(0);
+  posX.resize(0);
+  posY.resize(0);
+  posZ.resize(0);
+  stamps.resize(0);
+}
+
+
+// Axis-angle as sent by the ROV. The axis needs not be normalized.
+void
+PoseStore::setPose(int id,
+                   float angle, float axisX, float axisY, float axisZ,
+                   float x, float y, float z,
+                   qint64 timestamp)
+{
+  float w, qx, qy, qz;
+  axisAngleToQuaternions(1, &angle, &axisX, &axisY, &axisZ, &w, &qx, &qy, &qz);
+  setOrientation(id, w, qx, qy, qz, timestamp);
+  setPosition(id, x, y, z);
+}
+
+
+void
+PoseStore::setOrientation(int id, float w, float x, float y, float z, qint64 timestamp) {
+  quatW[id] = w;
+  quatX[id] = x;
+  quatY[id] = y;
+  quatZ[id] = z;
+  stamps[id] = timestamp;
+}
+
+
+void
+PoseStore::setPosition(int id, float x, float y, float z) {
+  posX[id] = x;
+  posY[id] = y;
+  posZ[id] = z;
+}
@@ -0,0 +1,57 @@
+#ifndef POSESTORE_H
+#define POSESTORE_H
+
+#include <QVector>
+
+
+// Poses of the tracked sensors stored as structure of arrays:
+// unit quaternions, positions and timestamps, each in its own
+// contiguous float array. A sensor id is its index and never
+// changes. Storage is reserved once for the given capacity, so
+// adding sensors does not reallocate, and readers can walk the
+// arrays linearly.
+//
+// The store is a value type (the arrays are implicitly shared):
+// taking a snapshot for the renderer is cheap, but the first write
+// after a snapshot that is still alive copies all the arrays
+// (copy on write). Writes between two snapshots never allocate.
+class PoseStore
+{
+public:
+  explicit PoseStore(int capacity = 64);
+
+  int capacity() const;
+  int count() const;
+  bool ensure(int id);// Makes ids up to "id" valid. False if over capacity
+  void clear();
+
+  void setPose(int id,
+               float angle, float axisX, float axisY, float axisZ,// degrees
+               float posX, float posY, float posZ,
+               qint64 timestamp);
+  void setOrientation(int id, float w, float x, float y, float z, qint64 timestamp);
+  void setPosition(int id, float x, float y, float z);
+
+  // Linear access to the arrays (count() elements each)
+  const float*  qw() const { return quatW.constData(); }
+  const float*  qx() const { return quatX.constData(); }
+  const float*  qy() const { return quatY.constData(); }
+  const float*  qz() const { return quatZ.constData(); }
+  const float*  px() const { return posX.constData(); }
+  const float*  py() const { return posY.constData(); }
+  const float*  pz() const { return posZ.constData(); }
+  const qint64* timestamps() const { return stamps.constData(); }
+
+private:
+  int nCapacity;
+  QVector<float>  quatW;
+  QVector<float>  quatX;
+  QVector<float>  quatY;
+  QVector<float>  quatZ;
+  QVector<float>  posX;
+  QVector<float>  posY;
+  QVector<float>  posZ;
+  QVector<qint64> stamps;
+};
+
+#endif // POSESTORE_H
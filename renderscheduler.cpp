@@ -0,0 +1,104 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "renderscheduler.h"
+
+#include <QWidget>
+#include <QWindow>
+#include <QScreen>
+#include <QGuiApplication>
+
+
+RenderScheduler::RenderScheduler(QWidget* pTargetWidget, QObject* parent)
+  : QObject(parent)
+  , pWidget(pTargetWidget)
+  , lastFrameTime(0)
+  , framePeriod(1000000000/60)
+  , nRequested(0)
+  , nRendered(0)
+  , bDirty(false)
+{
+  frameTimer.setSingleShot(true);
+  frameTimer.setTimerType(Qt::PreciseTimer);
+  connect(&frameTimer, SIGNAL(timeout()), this, SLOT(onFrameTimerTimeout()));
+  clock.start();
+}
+
+
+// Telemetry may arrive much faster than the display refresh:
+// many requests between two refreshes collapse into one frame.
+void
+RenderScheduler::requestFrame() {
+  nRequested++;
+  bDirty = true;
+  if(frameTimer.isActive()) return;
+  updateFramePeriod();
+  qint64 nextSlot = lastFrameTime + framePeriod;
+  qint64 delay = (nextSlot - clock.nsecsElapsed()) / 1000000;
+  frameTimer.start(delay > 0 ? int(delay) : 0);
+}
+
+
+void
+RenderScheduler::onFrameTimerTimeout() {
+  if(!bDirty) return;
+  bDirty = false;
+  // The target is expected to call update() (and not to repaint at
+  // once): the paint event is delivered by the event loop after the
+  // pending network messages.
+  emit frameDue();
+}
+
+
+void
+RenderScheduler::frameRendered() {
+  nRendered++;
+  lastFrameTime = clock.nsecsElapsed();
+}
+
+
+bool
+RenderScheduler::isDirty() const {
+  return bDirty;
+}
+
+
+qint64
+RenderScheduler::now() const {
+  return clock.nsecsElapsed();
+}
+
+
+qint64
+RenderScheduler::framesRequested() const {
+  return nRequested;
+}
+
+
+qint64
+RenderScheduler::framesRendered() const {
+  return nRendered;
+}
+
+
+void
+RenderScheduler::updateFramePeriod() {
+  QScreen* pScreen = NULL;
+  QWidget* pWindow = pWidget->window();
+  if(pWindow && pWindow->windowHandle())
+    pScreen = pWindow->windowHandle()->screen();
+  if(!pScreen)
+    pScreen = QGuiApplication::primaryScreen();
+  if(pScreen && pScreen->refreshRate() > 1.0)
+    framePeriod = qint64(1.0e9/pScreen->refreshRate());
+}
@@ -0,0 +1,48 @@
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+QT_FORWARD_DECLARE_CLASS(QWidget)
+
+
+// Coalesces the repaint requests of a widget so that it is
+// rendered at most once per display refresh and only when
+// something in the scene has really changed.
+class RenderScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit RenderScheduler(QWidget* pTargetWidget, QObject* parent = 0);
+
+  void requestFrame();   // The scene has changed: render it at the next slot
+  void frameRendered();  // To be called by the target at the end of each frame
+  bool isDirty() const;
+  qint64 now() const;    // ns, on the clock of the frame slots
+
+  qint64 framesRequested() const;
+  qint64 framesRendered() const;
+
+signals:
+  void frameDue();// Time to render: the scene changed since the last frame
+
+private slots:
+  void onFrameTimerTimeout();
+
+private:
+  void updateFramePeriod();
+
+  QWidget*      pWidget;
+  QTimer        frameTimer;
+  QElapsedTimer clock;
+  qint64        lastFrameTime;// in ns
+  qint64        framePeriod;  // in ns
+  qint64        nRequested;
+  qint64        nRendered;
+  bool          bDirty;
+};
+
+#endif // RENDERSCHEDULER_H
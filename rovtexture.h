@@ -0,0 +1,43 @@
+#ifndef ROVTEXTURE_H
+#define ROVTEXTURE_H
+
+#include <QtGlobal>
+
+// Layout of the baked texture files (".rtex") written by tools/texbake
+// and read by TextureAsset. All the values are little endian.
+//
+//   RovTextureHeader
+//   RovTextureLevel[levels]   largest level first
+//   level data, each level starting at a 16 bytes aligned offset
+//
+// Images are stored already flipped for OpenGL (first row at the bottom)
+// with their whole mipmap chain, so loading is a single map of the file
+// followed by one upload per level.
+
+static const quint32 rovTextureMagic   = 0x58455452;// "RTEX"
+static const quint32 rovTextureVersion = 1;
+
+enum RovTextureFormat {
+  rovTextureRGBA8 = 0,// 4 bytes per pixel
+  rovTextureBC1   = 1 // S3TC DXT1: 8 bytes per 4x4 block, opaque RGB
+};
+
+struct RovTextureHeader
+{
+  quint32 magic;
+  quint32 version;
+  quint32 format;// RovTextureFormat
+  quint32 width;
+  quint32 height;
+  quint32 levels;
+};
+
+struct RovTextureLevel
+{
+  quint32 offset;// From the beginning of the file
+  quint32 size;  // In bytes
+  quint32 width;
+  quint32 height;
+};
+
+#endif // ROVTEXTURE_H
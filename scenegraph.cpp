@@ -0,0 +1,146 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "scenegraph.h"
+#include "posekernel.h"
+
+#include <string.h>
+
+
+SceneGraph::SceneGraph()
+  : scale(1.0)
+  , bAllDirty(true)
+  , nUpdated(0)
+{
+}
+
+
+void
+SceneGraph::setModelScale(float newScale) {
+  if(newScale == scale) return;
+  scale = newScale;
+  bAllDirty = true;
+}
+
+
+// Going from one to more sensors changes the role of sensor 0,
+// so everything is recomputed when the count changes
+void
+SceneGraph::setSensorCount(int nSensors) {
+  if(nSensors == sensorCount()) return;
+  poses.resize(nSensors);
+  instances.resize(nSensors * instanceStride);
+  bAllDirty = true;
+}
+
+
+// Sensor 0 is the reference of the others: they are rotated by the
+// inverse of its attitude, while it is only translated. Alone, it
+// is rotated by its own attitude.
+void
+SceneGraph::computeSensors(const PoseStore& store, int first, int count) {
+  PoseArrays arrays = { store.qw(), store.qx(), store.qy(), store.qz(),
+                        store.px(), store.py(), store.pz() };
+  int nSensors = sensorCount();
+  if(nSensors > 1 && first == 0) {
+    static const float identity[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    PoseArrays translation = arrays;
+    translation.qw = &identity[0];
+    translation.qx = &identity[1];
+    translation.qy = &identity[2];
+    translation.qz = &identity[3];
+    poseMatrices(translation, 0, 1, NULL, scale, instances.data(), instanceStride);
+    // translation.q* hold a single element, so we go on from sensor 1
+    first++;
+    count--;
+  }
+  if(count <= 0) return;
+  const float* pReference = NULL;
+  float reference[4];
+  if(nSensors > 1) {
+    const SensorPose& pose0 = poses.at(0);
+    reference[0] =  pose0.q[0];
+    reference[1] = -pose0.q[1];
+    reference[2] = -pose0.q[2];
+    reference[3] = -pose0.q[3];
+    pReference = reference;
+  }
+  poseMatrices(arrays, first, count, pReference, scale, instances.data(), instanceStride);
+}
+
+
+// Walks the store arrays once and recomputes the runs of
+// consecutive sensors that moved
+void
+SceneGraph::update(const PoseStore& store) {
+  setSensorCount(store.count());
+  int nSensors = sensorCount();
+  const float* qw = store.qw();
+  const float* qx = store.qx();
+  const float* qy = store.qy();
+  const float* qz = store.qz();
+  const float* px = store.px();
+  const float* py = store.py();
+  const float* pz = store.pz();
+
+  nUpdated = 0;
+  int iRunStart = -1;
+  SensorPose pose;
+  for(int i=0; i<nSensors; i++) {
+    pose.q[0]   = qw[i];
+    pose.q[1]   = qx[i];
+    pose.q[2]   = qy[i];
+    pose.q[3]   = qz[i];
+    pose.pos[0] = px[i];
+    pose.pos[1] = py[i];
+    pose.pos[2] = pz[i];
+    bool bChanged = memcmp(&poses.at(i), &pose, sizeof(SensorPose)) != 0;
+    if(bChanged) {
+      poses[i] = pose;
+      // The others depend on the attitude of sensor 0
+      if(i == 0 && nSensors > 1)
+        bAllDirty = true;
+    }
+    if(bChanged || bAllDirty) {
+      if(iRunStart < 0) iRunStart = i;
+    }
+    else if(iRunStart >= 0) {
+      computeSensors(store, iRunStart, i-iRunStart);
+      nUpdated += i-iRunStart;
+      iRunStart = -1;
+    }
+  }
+  if(iRunStart >= 0) {
+    computeSensors(store, iRunStart, nSensors-iRunStart);
+    nUpdated += nSensors-iRunStart;
+  }
+  bAllDirty = false;
+}
+
+
+int
+SceneGraph::sensorCount() const {
+  return poses.count();
+}
+
+
+const float*
+SceneGraph::instanceData() const {
+  return instances.constData();
+}
+
+
+int
+SceneGraph::updatedSensors() const {
+  return nUpdated;
+}
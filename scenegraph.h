@@ -0,0 +1,58 @@
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <QVector>
+
+#include "posestore.h"
+
+
+// Attitude of one sensor as cached by the graph
+struct SensorPose
+{
+  float q[4];  // w, x, y, z
+  float pos[3];
+};
+
+
+// Transform hierarchy of the vehicle and of its sensors:
+//
+//   vehicle (model scale)
+//    +- sensor 0            rotated by its own attitude only when alone
+//    +- sensor 0 frame      undoes the attitude of sensor 0
+//        +- sensor 1..n-1   i.e. boxes i>0 are relative to box 0
+//
+// The hierarchy is folded into a reference quaternion so that the
+// matrices of all the sensors are computed in batches by the pose
+// kernel (see posekernel.h). Results are cached: only the sensors
+// whose pose changed are recomputed by update(), unless the scale or
+// sensor 0 changed. Once the sensor count is stable no memory is
+// allocated.
+class SceneGraph
+{
+public:
+  enum {
+    instanceStride = 32// Floats per sensor: model then normal matrix
+  };
+
+  SceneGraph();
+
+  void setModelScale(float scale);
+  void update(const PoseStore& store);
+
+  int sensorCount() const;
+  // sensorCount() blocks of instanceStride floats, column major
+  const float* instanceData() const;
+  int updatedSensors() const;// Recomputed by the last update()
+
+private:
+  void setSensorCount(int nSensors);
+  void computeSensors(const PoseStore& store, int first, int count);
+
+  float scale;
+  bool  bAllDirty;
+  QVector<SensorPose> poses;
+  QVector<float> instances;
+  int nUpdated;
+};
+
+#endif // SCENEGRAPH_H
@@ -0,0 +1,252 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "scenerenderer.h"
+
+#include <QDebug>
+#include <QImage>
+
+#include "textureasset.h"
+#include "assetloader.h"
+#include "startuptrace.h"
+#include "scenegraph.h"
+
+
+SceneFrame::SceneFrame()
+  : fieldOfView(45.0)
+  , lightPos(0, 4000, 4000, 1.0)
+  , useInstancing(true)
+  , pVideo(NULL)
+  , modelRect(0.6, 0.0, 0.4, 0.4)// Bottom right
+{
+  viewMatrix.lookAt(QVector3D(0.0, 0.0, 2.0), QVector3D(0.0, 0.0, 0.0), QVector3D(0.0, 1.0, 0.0));
+}
+
+
+SceneRenderer::SceneRenderer()
+  : viewportWidth(1)
+  , viewportHeight(1)
+  , nDrawCalls(0)
+  , pSceneGraph(new SceneGraph())
+  , texture(NULL)
+{
+}
+
+
+SceneRenderer::~SceneRenderer() {
+  // The context used to initialize the renderer must be current
+  videoTexture.destroy();
+  videoVao.destroy();
+  delete texture;
+  delete pSceneGraph;
+}
+
+
+// Returns false if the shaders or the ROV model can't be loaded.
+// The assets are taken from pAssets when given (see AssetLoader),
+// otherwise they are decoded here.
+bool
+SceneRenderer::initialize(const AssetLoader* pAssets) {
+  if(!initializeOpenGLFunctions()) {
+    qDebug() << "OpenGL 3.3 core is not available";
+    return false;
+  }
+  StartupTrace::begin("shaders");
+  bool bShaders = initShaders();
+  StartupTrace::end("shaders");
+  if(!bShaders)
+    return false;
+  initTextures(pAssets);
+  videoTexture.initialize();
+  // Core profile needs a bound vertex array object even without attributes
+  videoVao.create();
+
+  glClearColor(0.1, 0.1, 0.5, 0.0);
+
+  glEnable(GL_DEPTH_TEST);// Enable depth test
+  glDepthFunc(GL_LESS);// Accept fragment if it closer to the camera than the former one
+  glCullFace(GL_BACK);
+  glEnable(GL_CULL_FACE);// Cull triangles whose normal is not towards the camera
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glEnable(GL_MULTISAMPLE);
+
+  AssetLoader localAssets;
+  MeshData mesh = pAssets ? pAssets->mesh() : localAssets.mesh();
+  StartupTrace::Scope trace("mesh upload");
+  return geometries.init(mesh);
+}
+
+
+bool
+SceneRenderer::initShaders() {
+  // The single box pipeline
+  if(!shaderCache.buildProgram(&program, ":/vshader.glsl", ":/fshader.glsl"))
+    return false;
+  // The instanced pipeline
+  if(!shaderCache.buildProgram(&instancedProgram, ":/vshader_instanced.glsl", ":/fshader.glsl"))
+    return false;
+  // The video background
+  if(!shaderCache.buildProgram(&videoProgram, ":/vshader_composite.glsl", ":/fshader_video.glsl"))
+    return false;
+  return true;
+}
+
+
+// The texture baked by tools/texbake is used when available,
+// otherwise the PNG in the resources
+void
+SceneRenderer::initTextures(const AssetLoader* pAssets) {
+  AssetLoader localAssets;
+  if(!pAssets)
+    pAssets = &localAssets;
+  QImage skin = pAssets->skinImage();
+  StartupTrace::Scope trace("skin upload");
+  if(skin.isNull())
+    texture = TextureAsset::load(pAssets->bakedSkinPath());
+  if(!texture) {
+    if(skin.isNull())// The baked texture turned out to be unusable
+      skin = QImage(":/uvUnwrapROV_2.png").mirrored();
+    // Mipmaps are generated by QOpenGLTexture
+    texture = new QOpenGLTexture(skin);
+  }
+  // Trilinear filtering for texture minification
+  texture->setMinificationFilter(QOpenGLTexture::LinearMipMapLinear);
+  // Set bilinear filtering mode for texture magnification
+  texture->setMagnificationFilter(QOpenGLTexture::Linear);
+  // Wrap texture coordinates by repeating
+  // f.ex. texture coordinate (1.1, 1.2) is same as (0.1, 0.2)
+  texture->setWrapMode(QOpenGLTexture::Repeat);
+}
+
+
+void
+SceneRenderer::resize(int width, int height) {
+  viewportWidth  = qMax(width,  1);
+  viewportHeight = qMax(height, 1);
+}
+
+
+void
+SceneRenderer::render(const SceneFrame& frame) {
+  // The newest video frame is taken as late as possible
+  if(frame.pVideo && frame.pVideo->takeFrame(videoFrame))
+    videoTexture.upload(videoFrame);
+  bool bVideo = frame.pVideo && videoTexture.isValid();
+
+  glViewport(0, 0, viewportWidth, viewportHeight);
+  nDrawCalls = 0;
+  if(bVideo) {
+    // The video covers every pixel: no need to clear the colors
+    glClear(GL_DEPTH_BUFFER_BIT);
+    drawVideo();
+  }
+  else
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  if(frame.poses.count() == 0) return;
+
+  // Over the video the model keeps to its corner
+  int width  = viewportWidth;
+  int height = viewportHeight;
+  if(bVideo) {
+    width  = qMax(int(frame.modelRect.width()  * viewportWidth),  1);
+    height = qMax(int(frame.modelRect.height() * viewportHeight), 1);
+    glViewport(int(frame.modelRect.x() * viewportWidth),
+               int(frame.modelRect.y() * viewportHeight), width, height);
+  }
+
+  texture->bind();
+
+  // Projection matrix :
+  projectionMatrix.setToIdentity();
+  projectionMatrix.perspective(frame.fieldOfView, float(width)/float(height), 0.1f, 100.0f);
+
+  // Camera matrix
+  viewMatrix = frame.viewMatrix;
+
+  lightPos = frame.lightPos;
+
+  // Only the sensors that moved are recomputed
+  pSceneGraph->setModelScale(1.0/(geometries.max-geometries.min));
+  pSceneGraph->update(frame.poses);
+
+  if(frame.useInstancing)
+    drawSensorsInstanced();
+  else
+    drawSensors();
+}
+
+
+// One draw call per sensor
+void
+SceneRenderer::drawSensors() {
+  // Use our shader
+  program.bind();
+  program.setUniformValue("LightPosition_worldspace", lightPos);
+  program.setUniformValue("view_Matrix",  viewMatrix);
+
+  const float* pInstance = pSceneGraph->instanceData();
+  for(int i=0; i<pSceneGraph->sensorCount(); i++) {
+    // The instance data is column major, QMatrix4x4(const float*) row major
+    QMatrix4x4 modelMatrix  = QMatrix4x4(pInstance).transposed();
+    QMatrix4x4 normalMatrix = QMatrix4x4(pInstance+16).transposed();
+    pInstance += SceneGraph::instanceStride;
+
+    // Set modelview-projection matrix
+    mvpMatrix = projectionMatrix * viewMatrix * modelMatrix;
+
+    program.setUniformValue("mvp_Matrix",   mvpMatrix);
+    program.setUniformValue("model_Matrix", modelMatrix);
+    program.setUniformValue("normal_Matrix", normalMatrix);
+
+    // Draw the ROV
+    geometries.drawROVGeometry();
+    nDrawCalls++;
+  }
+}
+
+
+// A single draw call for all the sensors
+void
+SceneRenderer::drawSensorsInstanced() {
+  instancedProgram.bind();
+  instancedProgram.setUniformValue("LightPosition_worldspace", lightPos);
+  instancedProgram.setUniformValue("view_Matrix", viewMatrix);
+  instancedProgram.setUniformValue("vp_Matrix", projectionMatrix * viewMatrix);
+
+  geometries.drawROVGeometryInstanced(pSceneGraph->instanceData(), pSceneGraph->sensorCount());
+  nDrawCalls++;
+}
+
+
+// Full screen triangle behind everything, converted to RGB by the shader
+void
+SceneRenderer::drawVideo() {
+  glDisable(GL_DEPTH_TEST);
+  videoProgram.bind();
+  videoProgram.setUniformValue("yTexture",  1);
+  videoProgram.setUniformValue("cbTexture", 2);
+  videoProgram.setUniformValue("crTexture", 3);
+  videoTexture.bind(1);// Unit 0 is for the skin of the ROV
+  QOpenGLVertexArrayObject::Binder vaoBinder(&videoVao);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  videoProgram.release();
+  glEnable(GL_DEPTH_TEST);
+  nDrawCalls++;
+}
+
+
+int
+SceneRenderer::drawCalls() const {
+  return nDrawCalls;
+}
@@ -0,0 +1,80 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include <QRectF>
+#include <QVector>
+
+#include "geometryengine.h"
+#include "shadercache.h"
+#include "posestore.h"
+#include "videotexture.h"
+
+class AssetLoader;
+class SceneGraph;
+
+
+// Everything needed to draw one frame. It is a plain value
+// so it can be handed over to a different rendering thread.
+struct SceneFrame
+{
+  SceneFrame();
+
+  QMatrix4x4 viewMatrix;
+  float      fieldOfView;
+  QVector4D  lightPos;
+  bool       useInstancing;
+  PoseStore  poses;
+  VideoSource* pVideo;// Drawn behind the model when given
+  QRectF     modelRect;// Normalized part of the surface with the model over the video
+};
+
+
+// Draws the ROV scene in the current OpenGL 3.3 core context.
+// It is used both by GLWidget and by its rendering thread.
+class SceneRenderer : protected QOpenGLFunctions_3_3_Core
+{
+public:
+  SceneRenderer();
+  ~SceneRenderer();
+
+  bool initialize(const AssetLoader* pAssets = NULL);
+  void resize(int width, int height);
+  void render(const SceneFrame& frame);
+  int  drawCalls() const;// Issued by the last render()
+
+private:
+  bool initShaders();
+  void initTextures(const AssetLoader* pAssets);
+  void drawSensors();
+  void drawSensorsInstanced();
+  void drawVideo();
+
+  int viewportWidth;
+  int viewportHeight;
+  int nDrawCalls;
+
+  QMatrix4x4 projectionMatrix;
+  QMatrix4x4 viewMatrix;
+  QMatrix4x4 mvpMatrix;
+  QVector4D  lightPos;
+  SceneGraph* pSceneGraph;
+
+  QOpenGLTexture* texture;
+  QOpenGLShaderProgram program;
+  QOpenGLShaderProgram instancedProgram;
+  QOpenGLShaderProgram videoProgram;
+  QOpenGLVertexArrayObject videoVao;
+  ShaderCache shaderCache;
+  GeometryEngine geometries;
+  VideoTexture videoTexture;
+  VideoFrame   videoFrame;// Recycled by VideoSource::takeFrame()
+};
+
+#endif // SCENERENDERER_H
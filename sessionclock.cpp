@@ -0,0 +1,44 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "sessionclock.h"
+
+#include <QElapsedTimer>
+
+
+static QElapsedTimer
+startedTimer() {
+  QElapsedTimer elapsed;
+  elapsed.start();
+  return elapsed;
+}
+
+
+// Started on first use, once for all the threads
+static const QElapsedTimer&
+timer() {
+  static const QElapsedTimer elapsed = startedTimer();
+  return elapsed;
+}
+
+
+void
+SessionClock::start() {
+  timer();
+}
+
+
+qint64
+SessionClock::now() {
+  return timer().nsecsElapsed();
+}
@@ -0,0 +1,18 @@
+#ifndef SESSIONCLOCK_H
+#define SESSIONCLOCK_H
+
+#include <QtGlobal>
+
+
+// The one timeline of the application: monotonic ns since start().
+// Video frames, telemetry samples, pilot commands and predictions
+// are all stamped on it, so that they can be related to each other,
+// live and in the recordings. Thread safe.
+class SessionClock
+{
+public:
+  static void   start();// To be called as early as possible in main()
+  static qint64 now();
+};
+
+#endif // SESSIONCLOCK_H
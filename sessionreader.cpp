@@ -0,0 +1,260 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "sessionreader.h"
+
+#include <QList>
+#include <algorithm>
+
+
+static const int maxSensors = 64;// As a default PoseStore
+
+
+// Index of the last entry not after "time", -1 if none.
+// Entries are sorted by time.
+template<class Entry>
+static int
+lastAtOrBefore(const QVector<Entry>& entries, qint64 time) {
+  int lo = 0;
+  int hi = entries.size();
+  while(lo < hi) {
+    int mid = (lo+hi)/2;
+    if(entries.at(mid).time <= time)
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+  return lo-1;
+}
+
+
+template<class Entry>
+static bool
+earlier(const Entry& a, const Entry& b) {
+  return a.time < b.time;
+}
+
+
+SessionReader::SessionReader()
+  : lastTime(0)
+  , bOpen(false)
+  , iOpenSegment(-1)
+{
+}
+
+
+bool
+SessionReader::fail(const QString& sReason) {
+  sError = sReason;
+  close();
+  return false;
+}
+
+
+QString
+SessionReader::errorString() const {
+  return sError;
+}
+
+
+bool
+SessionReader::open(const QString& sSessionFile) {
+  close();
+  sError.clear();
+  const QString sExtension(".session");
+  if(!sSessionFile.endsWith(sExtension))
+    return fail("Not a session file: " + sSessionFile);
+  sPrefix = sSessionFile.left(sSessionFile.size() - sExtension.size());
+
+  QFile manifest(sSessionFile);
+  if(!manifest.open(QIODevice::ReadOnly | QIODevice::Text))
+    return fail("Unable to read " + sSessionFile);
+  while(!manifest.atEnd()) {
+    QList<QByteArray> tokens = manifest.readLine().trimmed().split(' ');
+    if(tokens.size() == 2 && tokens.at(0) == "started")
+      started = QDateTime::fromString(QString::fromLatin1(tokens.at(1)), Qt::ISODate);
+    else if(tokens.size() == 2 && tokens.at(0) == "version" && tokens.at(1) != "1")
+      return fail("Unknown session version " + QString::fromLatin1(tokens.at(1)));
+  }
+
+  // The segments follow each other until the first missing one
+  for(int segment=0; QFile::exists(segmentName(segment) + ".idx"); segment++)
+    if(!loadIndex(segment))
+      return false;
+  if(!loadRecords())
+    return false;
+  bOpen = true;
+  return true;
+}
+
+
+void
+SessionReader::close() {
+  segmentFile.close();
+  iOpenSegment = -1;
+  video.clear();
+  poses.clear();
+  depths.clear();
+  lastTime = 0;
+  bOpen    = false;
+}
+
+
+bool
+SessionReader::isOpen() const {
+  return bOpen;
+}
+
+
+QDateTime
+SessionReader::startedAt() const {
+  return started;
+}
+
+
+qint64
+SessionReader::duration() const {
+  return lastTime;
+}
+
+
+int
+SessionReader::videoFrames() const {
+  return video.size();
+}
+
+
+QString
+SessionReader::segmentName(int segment) const {
+  return QString("%1_%2").arg(sPrefix).arg(segment, 3, 10, QChar('0'));
+}
+
+
+// "time_us,offset,size,timestamp". A truncated last line (the
+// recorder crashed while writing it) is ignored.
+bool
+SessionReader::loadIndex(int segment) {
+  QFile index(segmentName(segment) + ".idx");
+  if(!index.open(QIODevice::ReadOnly))
+    return fail("Unable to read " + index.fileName());
+  index.readLine();// Header
+  while(!index.atEnd()) {
+    QByteArray line = index.readLine();
+    if(!line.endsWith('\n')) break;
+    QList<QByteArray> fields = line.trimmed().split(',');
+    if(fields.size() < 3) continue;
+    VideoEntry entry;
+    entry.time    = fields.at(0).toLongLong()*1000;
+    entry.segment = segment;
+    entry.offset  = fields.at(1).toLongLong();
+    entry.size    = fields.at(2).toInt();
+    video.append(entry);
+    lastTime = qMax(lastTime, entry.time);
+  }
+  return true;
+}
+
+
+// "time_us,type,values...": pose and depth records are kept, the
+// others (pilot commands) are not needed to show the dive
+bool
+SessionReader::loadRecords() {
+  QFile records(sPrefix + ".tlm");
+  if(!records.exists())
+    return true;// A session without telemetry
+  if(!records.open(QIODevice::ReadOnly))
+    return fail("Unable to read " + records.fileName());
+  records.readLine();// Header
+  while(!records.atEnd()) {
+    QByteArray line = records.readLine();
+    if(!line.endsWith('\n')) break;
+    QList<QByteArray> fields = line.trimmed().split(',');
+    if(fields.size() < 2) continue;
+    qint64 time = fields.at(0).toLongLong()*1000;
+    if(fields.at(1) == "pose" && fields.size() == 10) {
+      int id = fields.at(2).toInt();
+      if(id < 0 || id >= maxSensors) continue;
+      if(poses.size() <= id)
+        poses.resize(id+1);
+      PoseEntry entry;
+      entry.time = time;
+      for(int i=0; i<4; i++)
+        entry.orientation[i] = fields.at(3+i).toFloat();
+      for(int i=0; i<3; i++)
+        entry.position[i] = fields.at(7+i).toFloat();
+      poses[id].append(entry);
+    }
+    else if(fields.at(1) == "depth" && fields.size() == 5) {
+      DepthEntry entry;
+      entry.time  = time;
+      entry.depth = fields.at(3).toFloat();
+      entry.speed = fields.at(4).toFloat();
+      depths.append(entry);
+    }
+    else
+      continue;
+    lastTime = qMax(lastTime, time);
+  }
+  // Records are stamped before being queued, but queued in batches:
+  // make sure they are in time order
+  for(int i=0; i<poses.size(); i++)
+    std::stable_sort(poses[i].begin(), poses[i].end(), earlier<PoseEntry>);
+  std::stable_sort(depths.begin(), depths.end(), earlier<DepthEntry>);
+  return true;
+}
+
+
+bool
+SessionReader::videoFrameAt(qint64 time, QByteArray& jpeg, qint64* pFrameTime) {
+  int i = lastAtOrBefore(video, time);
+  if(i < 0) return false;
+  const VideoEntry& entry = video.at(i);
+  if(entry.segment != iOpenSegment) {
+    segmentFile.close();
+    iOpenSegment = -1;
+    segmentFile.setFileName(segmentName(entry.segment) + ".mjpeg");
+    if(!segmentFile.open(QIODevice::ReadOnly)) return false;
+    iOpenSegment = entry.segment;
+  }
+  if(!segmentFile.seek(entry.offset)) return false;
+  jpeg = segmentFile.read(entry.size);
+  if(jpeg.size() != entry.size) return false;
+  if(pFrameTime) *pFrameTime = entry.time;
+  return true;
+}
+
+
+bool
+SessionReader::posesAt(qint64 time, PoseStore& store) const {
+  bool bFound = false;
+  for(int id=0; id<poses.size(); id++) {
+    int i = lastAtOrBefore(poses.at(id), time);
+    if(i < 0 || !store.ensure(id)) continue;
+    const PoseEntry& entry = poses.at(id).at(i);
+    store.setOrientation(id, entry.orientation[0], entry.orientation[1],
+                             entry.orientation[2], entry.orientation[3], entry.time);
+    store.setPosition(id, entry.position[0], entry.position[1], entry.position[2]);
+    bFound = true;
+  }
+  return bFound;
+}
+
+
+bool
+SessionReader::depthAt(qint64 time, float& depth, float& verticalSpeed) const {
+  int i = lastAtOrBefore(depths, time);
+  if(i < 0) return false;
+  depth         = depths.at(i).depth;
+  verticalSpeed = depths.at(i).speed;
+  return true;
+}
@@ -0,0 +1,75 @@
+#ifndef SESSIONREADER_H
+#define SESSIONREADER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QVector>
+#include <QFile>
+
+#include "posestore.h"
+
+
+// Reads back a session written by StreamRecorder, for playback.
+//
+// open() loads the video indexes and the telemetry in memory, sorted
+// by time. Then the state of the dive at any time (ns since the start
+// of the session) is found with binary searches: the frame displayed,
+// the pose of every sensor and the depth, each the last one received
+// not after that time. Only the JPEG of the frame is read from disk.
+class SessionReader
+{
+public:
+  SessionReader();
+
+  bool open(const QString& sSessionFile);// "<prefix>.session"
+  void close();
+  bool isOpen() const;
+  QString errorString() const;
+
+  QDateTime startedAt() const;
+  qint64    duration() const;// ns, to the last frame or record
+  int       videoFrames() const;
+
+  bool videoFrameAt(qint64 time, QByteArray& jpeg, qint64* pFrameTime = NULL);
+  bool posesAt(qint64 time, PoseStore& poses) const;// False if no pose yet
+  bool depthAt(qint64 time, float& depth, float& verticalSpeed) const;
+
+private:
+  struct VideoEntry {
+    qint64 time;
+    int    segment;
+    qint64 offset;
+    int    size;
+  };
+  struct PoseEntry {
+    qint64 time;
+    float  orientation[4];// w, x, y, z
+    float  position[3];
+  };
+  struct DepthEntry {
+    qint64 time;
+    float  depth;// Filtered
+    float  speed;
+  };
+
+  bool loadIndex(int segment);
+  bool loadRecords();
+  bool fail(const QString& sError);
+  QString segmentName(int segment) const;
+
+  QString   sPrefix;
+  QString   sError;
+  QDateTime started;
+  qint64    lastTime;
+  bool      bOpen;
+
+  QVector<VideoEntry> video;
+  QVector< QVector<PoseEntry> > poses;// One track per sensor
+  QVector<DepthEntry> depths;
+
+  QFile segmentFile;
+  int   iOpenSegment;
+};
+
+#endif // SESSIONREADER_H
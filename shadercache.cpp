@@ -0,0 +1,232 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "shadercache.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH           0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS      0x87FE
+#endif
+
+
+static const quint32 cacheMagic   = 0x524f5653;// "ROVS"
+static const quint32 cacheVersion = 1;
+
+
+bool ShaderCache::bEnabled = true;
+
+// Programs may be built by the GUI and by the rendering thread
+static QMutex statsMutex;
+static int    nLoaded       = 0;
+static int    nCompiled     = 0;
+static qint64 loadedTime    = 0;// ns
+static qint64 compiledTime  = 0;
+
+
+ShaderCache::ShaderCache()
+  : getProgramBinary(NULL)
+  , programBinary(NULL)
+  , programParameteri(NULL)
+{
+}
+
+
+void
+ShaderCache::setEnabled(bool enable) {
+  bEnabled = enable;
+}
+
+
+bool
+ShaderCache::isEnabled() {
+  return bEnabled;
+}
+
+
+void
+ShaderCache::account(bool bLoaded, qint64 ns) {
+  QMutexLocker locker(&statsMutex);
+  if(bLoaded) {
+    nLoaded++;
+    loadedTime += ns;
+  } else {
+    nCompiled++;
+    compiledTime += ns;
+  }
+}
+
+
+QString
+ShaderCache::report() {
+  QMutexLocker locker(&statsMutex);
+  return QString("Shaders: %1 loaded from the cache in %2 ms, %3 compiled from source in %4 ms")
+         .arg(nLoaded).arg(loadedTime*1.0e-6, 0, 'f', 1)
+         .arg(nCompiled).arg(compiledTime*1.0e-6, 0, 'f', 1);
+}
+
+
+// Program binaries are core since OpenGL 4.1 and are also
+// available through ARB_get_program_binary. The driver may
+// still support no binary format at all (e.g. old Mesa).
+bool
+ShaderCache::resolveFunctions() {
+  QOpenGLContext* pContext = QOpenGLContext::currentContext();
+  if(!pContext) return false;
+  QSurfaceFormat format = pContext->format();
+  bool bCore41 = format.version() >= qMakePair(4, 1);
+  if(!bCore41 && !pContext->hasExtension("GL_ARB_get_program_binary"))
+    return false;
+  getProgramBinary  = (GetProgramBinaryFunc) pContext->getProcAddress("glGetProgramBinary");
+  programBinary     = (ProgramBinaryFunc)    pContext->getProcAddress("glProgramBinary");
+  programParameteri = (ProgramParameteriFunc)pContext->getProcAddress("glProgramParameteri");
+  if(!getProgramBinary || !programBinary || !programParameteri)
+    return false;
+  GLint nFormats = 0;
+  pContext->functions()->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+  return nFormats > 0;
+}
+
+
+QByteArray
+ShaderCache::cacheKey(const QByteArray& vertexSource, const QByteArray& fragmentSource) {
+  QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QByteArray((const char*)f->glGetString(GL_VENDOR)));
+  hash.addData(QByteArray((const char*)f->glGetString(GL_RENDERER)));
+  hash.addData(QByteArray((const char*)f->glGetString(GL_VERSION)));
+  hash.addData(vertexSource);
+  hash.addData(fragmentSource);
+  return hash.result().toHex();
+}
+
+
+QString
+ShaderCache::cacheFilePath(const QByteArray& key) {
+  QString sDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/shaders");
+  QDir().mkpath(sDir);
+  return sDir + QString("/") + QString::fromLatin1(key) + QString(".bin");
+}
+
+
+bool
+ShaderCache::loadBinary(QOpenGLShaderProgram* pProgram, const QString& path) {
+  QFile file(path);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+  QDataStream in(&file);
+  quint32 magic, version, binaryFormat;
+  QByteArray binary;
+  in >> magic >> version >> binaryFormat >> binary;
+  if(in.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion)
+    return false;
+  if(!pProgram->create())
+    return false;
+  programBinary(pProgram->programId(), binaryFormat, binary.constData(), binary.size());
+  // Without attached shaders link() only checks GL_LINK_STATUS
+  return pProgram->link();
+}
+
+
+void
+ShaderCache::saveBinary(QOpenGLShaderProgram* pProgram, const QString& path) {
+  QOpenGLFunctions* f = QOpenGLContext::currentContext()->functions();
+  GLint length = 0;
+  f->glGetProgramiv(pProgram->programId(), GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0) return;
+  QByteArray binary(length, 0);
+  GLenum binaryFormat = 0;
+  GLsizei written = 0;
+  getProgramBinary(pProgram->programId(), length, &written, &binaryFormat, binary.data());
+  if(written <= 0) return;
+  binary.resize(written);
+
+  QSaveFile file(path);// Never leave a truncated binary behind
+  if(!file.open(QIODevice::WriteOnly))
+    return;
+  QDataStream out(&file);
+  out << cacheMagic << cacheVersion << quint32(binaryFormat) << binary;
+  file.commit();
+}
+
+
+// Link pProgram from the given shader files, loading the binary from the
+// cache when possible and saving it otherwise. Falls back transparently
+// to a plain compilation when binaries are not supported.
+bool
+ShaderCache::buildProgram(QOpenGLShaderProgram* pProgram,
+                          const QString& vertexShaderPath,
+                          const QString& fragmentShaderPath)
+{
+  QElapsedTimer timer;
+  timer.start();
+  QString sName = QFileInfo(vertexShaderPath).fileName() + QString("+") + QFileInfo(fragmentShaderPath).fileName();
+
+  QFile vertexFile(vertexShaderPath);
+  QFile fragmentFile(fragmentShaderPath);
+  if(!vertexFile.open(QIODevice::ReadOnly) || !fragmentFile.open(QIODevice::ReadOnly)) {
+    qDebug() << "Unable to read" << sName;
+    return false;
+  }
+  QByteArray vertexSource   = vertexFile.readAll();
+  QByteArray fragmentSource = fragmentFile.readAll();
+
+  bool bBinaries = bEnabled && resolveFunctions();
+  QString sPath;
+  if(bBinaries) {
+    sPath = cacheFilePath(cacheKey(vertexSource, fragmentSource));
+    if(loadBinary(pProgram, sPath)) {
+      account(true, timer.nsecsElapsed());
+      qDebug() << sName << "loaded from the shader cache in" << timer.elapsed() << "ms";
+      return true;
+    }
+    // Stale or corrupted: rebuild it from source
+    pProgram->removeAllShaders();
+  }
+
+  if(!pProgram->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexSource) ||
+     !pProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentSource))
+  {
+    qDebug() << pProgram->log();
+    return false;
+  }
+  if(bBinaries)
+    programParameteri(pProgram->programId(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  if(!pProgram->link()) {
+    qDebug() << pProgram->log();
+    return false;
+  }
+  if(bBinaries)
+    saveBinary(pProgram, sPath);
+  account(false, timer.nsecsElapsed());
+  qDebug() << sName << "compiled from source in" << timer.elapsed() << "ms";
+  return true;
+}
@@ -0,0 +1,48 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <qopengl.h>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
+
+
+// Builds shader programs reusing, when the driver allows it, the
+// binaries saved by a previous run (glGetProgramBinary/glProgramBinary).
+// Binaries are stored in the user cache directory and are keyed by
+// driver vendor, renderer, version and by the hash of the sources:
+// a driver update or a shader change simply misses the cache.
+class ShaderCache
+{
+public:
+  ShaderCache();
+
+  bool buildProgram(QOpenGLShaderProgram* pProgram,
+                    const QString& vertexShaderPath,
+                    const QString& fragmentShaderPath);
+
+  static void setEnabled(bool enable);
+  static bool isEnabled();
+  static QString report();// Programs loaded and compiled so far, and their time
+
+private:
+  bool resolveFunctions();
+  QByteArray cacheKey(const QByteArray& vertexSource, const QByteArray& fragmentSource);
+  QString cacheFilePath(const QByteArray& key);
+  bool loadBinary(QOpenGLShaderProgram* pProgram, const QString& path);
+  void saveBinary(QOpenGLShaderProgram* pProgram, const QString& path);
+
+  typedef void (QOPENGLF_APIENTRYP GetProgramBinaryFunc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+  typedef void (QOPENGLF_APIENTRYP ProgramBinaryFunc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+  typedef void (QOPENGLF_APIENTRYP ProgramParameteriFunc)(GLuint program, GLenum pname, GLint value);
+
+  GetProgramBinaryFunc  getProgramBinary;
+  ProgramBinaryFunc     programBinary;
+  ProgramParameteriFunc programParameteri;
+
+  static bool bEnabled;
+  static void account(bool bLoaded, qint64 ns);
+};
+
+#endif // SHADERCACHE_H
@@ -0,0 +1,99 @@
+#ifndef SIMDOPS_H
+#define SIMDOPS_H
+
+// Vector traits for the batch kernels (see posekernel.h, imufusion.h).
+// A kernel is written once as a template over Ops and instantiated
+// for 8 lanes with AVX, 4 with SSE2, and for the scalar fallback,
+// depending on the instruction set the file is compiled for.
+
+#include <math.h>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define SIMDOPS_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define SIMDOPS_SSE
+#endif
+
+
+struct ScalarOps
+{
+  typedef float V;
+  enum { width = 1 };
+  static V    load(const float* p)   { return *p; }
+  static void store(float* p, V a)   { *p = a; }
+  static V    set1(float f)          { return f; }
+  static V    add(V a, V b)          { return a + b; }
+  static V    sub(V a, V b)          { return a - b; }
+  static V    mul(V a, V b)          { return a * b; }
+  static V    sqrt(V a)              { return sqrtf(a); }
+  static V    twoOver(V n2)          { return n2 > 0.0f ? 2.0f/n2 : 0.0f; }
+  static V    invSqrtOrZero(V n2)    { return n2 > 0.0f ? 1.0f/sqrtf(n2) : 0.0f; }
+  static V    keepIf(V cond, V a)    { return cond > 0.0f ? a : 0.0f; }// a if cond > 0, else 0
+};
+
+
+#ifdef SIMDOPS_SSE
+struct SseOps
+{
+  typedef __m128 V;
+  enum { width = 4 };
+  static V    load(const float* p)   { return _mm_loadu_ps(p); }
+  static void store(float* p, V a)   { _mm_storeu_ps(p, a); }
+  static V    set1(float f)          { return _mm_set1_ps(f); }
+  static V    add(V a, V b)          { return _mm_add_ps(a, b); }
+  static V    sub(V a, V b)          { return _mm_sub_ps(a, b); }
+  static V    mul(V a, V b)          { return _mm_mul_ps(a, b); }
+  static V    sqrt(V a)              { return _mm_sqrt_ps(a); }
+  static V    twoOver(V n2) {
+    return keepIf(n2, _mm_div_ps(_mm_set1_ps(2.0f), n2));
+  }
+  static V    invSqrtOrZero(V n2) {
+    return keepIf(n2, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(n2)));
+  }
+  static V    keepIf(V cond, V a) {
+    return _mm_and_ps(_mm_cmpgt_ps(cond, _mm_setzero_ps()), a);
+  }
+};
+#endif
+
+
+#ifdef SIMDOPS_AVX
+struct AvxOps
+{
+  typedef __m256 V;
+  enum { width = 8 };
+  static V    load(const float* p)   { return _mm256_loadu_ps(p); }
+  static void store(float* p, V a)   { _mm256_storeu_ps(p, a); }
+  static V    set1(float f)          { return _mm256_set1_ps(f); }
+  static V    add(V a, V b)          { return _mm256_add_ps(a, b); }
+  static V    sub(V a, V b)          { return _mm256_sub_ps(a, b); }
+  static V    mul(V a, V b)          { return _mm256_mul_ps(a, b); }
+  static V    sqrt(V a)              { return _mm256_sqrt_ps(a); }
+  static V    twoOver(V n2) {
+    return keepIf(n2, _mm256_div_ps(_mm256_set1_ps(2.0f), n2));
+  }
+  static V    invSqrtOrZero(V n2) {
+    return keepIf(n2, _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(n2)));
+  }
+  static V    keepIf(V cond, V a) {
+    return _mm256_and_ps(_mm256_cmp_ps(cond, _mm256_setzero_ps(), _CMP_GT_OQ), a);
+  }
+};
+#endif
+
+
+inline const char*
+simdInstructionSet() {
+#if defined(SIMDOPS_AVX)
+  return "AVX";
+#elif defined(SIMDOPS_SSE)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+#endif // SIMDOPS_H
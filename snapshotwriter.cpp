@@ -0,0 +1,149 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "snapshotwriter.h"
+#include "sessionclock.h"
+#include "logger.h"
+
+#include <QMutexLocker>
+#include <QDateTime>
+#include <QFile>
+#include <QDir>
+
+
+static const qint64 captureTimeout = 1000000000;// ns, from the command
+
+
+SnapshotWriter::SnapshotWriter()
+  : QObject()
+  , sDirectory(QDir::homePath())
+  , nArmed(0)
+  , nBurst(0)
+  , commandTime(0)
+  , deadline(0)
+{
+  writerThread.setObjectName("Snapshots");
+  moveToThread(&writerThread);
+  writerThread.start();
+}
+
+
+SnapshotWriter::~SnapshotWriter() {
+  // Writes what was already taken
+  QMetaObject::invokeMethod(this, "releaseResources", Qt::BlockingQueuedConnection);
+  writerThread.quit();
+  writerThread.wait();
+}
+
+
+void
+SnapshotWriter::setDirectory(const QString& sPath) {
+  QMutexLocker locker(&mutex);
+  sDirectory = sPath;
+}
+
+
+// A new command restarts the burst, with the new description
+void
+SnapshotWriter::capture(int nFrames, const QByteArray& snapshotDescription) {
+  QMutexLocker locker(&mutex);
+  sBaseName = QString("%1/ROV_%2").arg(sDirectory)
+              .arg(QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss-zzz"));
+  description = snapshotDescription;
+  nArmed = nBurst = qMax(1, nFrames);
+  commandTime = SessionClock::now();
+  deadline    = commandTime + captureTimeout;
+}
+
+
+// Video thread: a copy of the frame, if armed and still in time
+void
+SnapshotWriter::frameParsed(const unsigned char* pJpeg, size_t size, double timestamp) {
+  qint64 receivedTime = SessionClock::now();
+  QMutexLocker locker(&mutex);
+  if(nArmed == 0) return;
+  int i = nBurst - nArmed;
+  if(receivedTime > deadline) {
+    Logger::warningf("snap", "No frame within %lld ms: %d of %d pictures taken",
+                     (long long)(captureTimeout/1000000), i, nBurst);
+    nArmed = 0;
+    return;
+  }
+  nArmed--;
+  Snapshot snapshot;
+  snapshot.jpeg = QByteArray(reinterpret_cast<const char*>(pJpeg), int(size));
+  snapshot.description = description +
+                         "time " + QDateTime::currentDateTime().toString(Qt::ISODate).toLatin1() + "\n" +
+                         "frame " + QByteArray::number(i+1) + "/" + QByteArray::number(nBurst) + "\n" +
+                         "session_us " + QByteArray::number(receivedTime/1000) + "\n" +
+                         "description_age_ms " + QByteArray::number((receivedTime-commandTime)/1000000) + "\n" +
+                         "camera_timestamp " + QByteArray::number(timestamp, 'f', 6) + "\n";
+  snapshot.sFileName = nBurst == 1 ? sBaseName + ".jpg"
+                                   : QString("%1_%2.jpg").arg(sBaseName).arg(i+1, 2, 10, QChar('0'));
+  queue.append(snapshot);
+  QMetaObject::invokeMethod(this, "writePending", Qt::QueuedConnection);
+}
+
+
+// The comment goes after the APPn segments (JFIF, EXIF...) that
+// must open the file
+QByteArray
+SnapshotWriter::withComment(const QByteArray& jpeg, const QByteArray& comment) {
+  const uchar* p = reinterpret_cast<const uchar*>(jpeg.constData());
+  int size = jpeg.size();
+  if(size < 4 || p[0] != 0xFF || p[1] != 0xD8)
+    return QByteArray();
+  int pos = 2;
+  while(pos+4 <= size && p[pos] == 0xFF && p[pos+1] >= 0xE0 && p[pos+1] <= 0xEF)
+    pos += 2 + (p[pos+2] << 8 | p[pos+3]);
+  if(pos > size)
+    return QByteArray();
+  QByteArray text = comment.left(65533);
+  int length = text.size() + 2;
+  QByteArray segment;
+  segment.reserve(length + 2);
+  segment.append(char(0xFF));
+  segment.append(char(0xFE));// COM
+  segment.append(char(length >> 8));
+  segment.append(char(length & 0xFF));
+  segment.append(text);
+  return jpeg.left(pos) + segment + jpeg.mid(pos);
+}
+
+
+// Writer thread
+void
+SnapshotWriter::writePending() {
+  for(;;) {
+    Snapshot snapshot;
+    {
+      QMutexLocker locker(&mutex);
+      if(queue.isEmpty()) return;
+      snapshot = queue.takeFirst();
+    }
+    QByteArray jpeg = withComment(snapshot.jpeg, snapshot.description);
+    QFile file(snapshot.sFileName);
+    if(jpeg.isEmpty())
+      Logger::error("snap", "Not a JPEG frame: snapshot not saved");
+    else if(!file.open(QIODevice::WriteOnly) || file.write(jpeg) != jpeg.size())
+      Logger::errorf("snap", "Unable to write %s", qPrintable(snapshot.sFileName));
+    else
+      Logger::info("snap", snapshot.sFileName);
+  }
+}
+
+
+void
+SnapshotWriter::releaseResources() {
+  writePending();
+}
@@ -0,0 +1,63 @@
+#ifndef SNAPSHOTWRITER_H
+#define SNAPSHOTWRITER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+#include "mjpegparser.h"
+
+
+// Still pictures of the camera stream, one or a burst at a time.
+//
+// capture() only arms the writer: the next frames received are
+// copied as they come from the camera (full resolution, no decoding
+// nor encoding) and written by a thread of their own, with the
+// description given (depth, attitude...) in a JPEG comment segment.
+// Each frame is stamped with its own receive time and with the age
+// of the description. A burst not completed within a second of the
+// command is cut short: a late frame would not match the description.
+// Neither the GUI nor the video thread ever waits on the disk.
+class SnapshotWriter : public QObject, public MjpegFrameSink
+{
+  Q_OBJECT
+
+public:
+  SnapshotWriter();
+  ~SnapshotWriter();
+
+  void setDirectory(const QString& sPath);
+  void capture(int nFrames, const QByteArray& description);// Any thread
+
+  void frameParsed(const unsigned char* pJpeg, size_t size, double timestamp);
+
+private slots:
+  void writePending();
+  void releaseResources();
+
+private:
+  struct Snapshot {
+    QByteArray jpeg;
+    QByteArray description;
+    QString    sFileName;
+  };
+
+  static QByteArray withComment(const QByteArray& jpeg, const QByteArray& comment);
+
+  QThread writerThread;
+
+  QMutex  mutex;
+  QString sDirectory;
+  QString sBaseName;   // Of the burst being taken
+  QByteArray description;
+  int     nArmed;      // Frames still to take
+  int     nBurst;
+  qint64  commandTime; // Session clock, ns
+  qint64  deadline;    // Idem: later frames are not taken
+  QList<Snapshot> queue;
+};
+
+#endif // SNAPSHOTWRITER_H
@@ -0,0 +1,115 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "startuptrace.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+
+struct TracePhase
+{
+  QString sName;
+  QString sThread;
+  qint64  begin;// ns since start()
+  qint64  end;  // -1 while running
+};
+
+
+static QElapsedTimer      traceClock;
+static QMutex             traceMutex;
+static QVector<TracePhase> tracePhases;
+static bool               bTraceDone = false;
+
+
+static QString
+currentThreadName() {
+  QString sName = QThread::currentThread()->objectName();
+  if(sName.isEmpty())
+    sName = QString("0x%1").arg(quintptr(QThread::currentThreadId()), 0, 16);
+  return sName;
+}
+
+
+void
+StartupTrace::start() {
+  QMutexLocker locker(&traceMutex);
+  traceClock.start();
+  QThread::currentThread()->setObjectName("GUI");
+}
+
+
+void
+StartupTrace::begin(const QString& phase) {
+  QMutexLocker locker(&traceMutex);
+  if(bTraceDone || !traceClock.isValid()) return;
+  TracePhase tracePhase;
+  tracePhase.sName   = phase;
+  tracePhase.sThread = currentThreadName();
+  tracePhase.begin   = traceClock.nsecsElapsed();
+  tracePhase.end     = -1;
+  tracePhases.append(tracePhase);
+}
+
+
+void
+StartupTrace::end(const QString& phase) {
+  QMutexLocker locker(&traceMutex);
+  if(bTraceDone || !traceClock.isValid()) return;
+  for(int i=tracePhases.count()-1; i>=0; i--) {
+    if(tracePhases[i].sName == phase && tracePhases[i].end < 0) {
+      tracePhases[i].end = traceClock.nsecsElapsed();
+      return;
+    }
+  }
+}
+
+
+// Print the breakdown of the time to first frame (only once)
+void
+StartupTrace::firstFrame() {
+  QMutexLocker locker(&traceMutex);
+  if(bTraceDone || !traceClock.isValid()) return;
+  bTraceDone = true;
+  qint64 now = traceClock.nsecsElapsed();
+  qDebug() << "Startup trace (ms):";
+  qDebug("  %-24s %-8s %9s %9s", "phase", "thread", "start", "duration");
+  for(int i=0; i<tracePhases.count(); i++) {
+    const TracePhase& tracePhase = tracePhases.at(i);
+    qint64 end = tracePhase.end < 0 ? now : tracePhase.end;
+    qDebug("  %-24s %-8s %9.1f %9.1f%s",
+           qPrintable(tracePhase.sName),
+           qPrintable(tracePhase.sThread),
+           tracePhase.begin*1.0e-6,
+           (end-tracePhase.begin)*1.0e-6,
+           tracePhase.end < 0 ? " (running)" : "");
+  }
+  qDebug("  %-24s %-8s %9.1f", "first frame", qPrintable(currentThreadName()), now*1.0e-6);
+  tracePhases.clear();
+}
+
+
+StartupTrace::Scope::Scope(const QString& phase)
+  : sPhase(phase)
+{
+  StartupTrace::begin(sPhase);
+}
+
+
+StartupTrace::Scope::~Scope() {
+  StartupTrace::end(sPhase);
+}
@@ -0,0 +1,29 @@
+#ifndef STARTUPTRACE_H
+#define STARTUPTRACE_H
+
+#include <QString>
+
+
+// Records how long each startup phase takes, and on which thread,
+// and prints the whole breakdown when the first frame is rendered.
+// Phases may run concurrently: they can be recorded from any thread.
+class StartupTrace
+{
+public:
+  static void start();// To be called as early as possible in main()
+  static void begin(const QString& phase);
+  static void end(const QString& phase);
+  static void firstFrame();
+
+  // Records the phase for the lifetime of the object
+  class Scope
+  {
+  public:
+    explicit Scope(const QString& phase);
+    ~Scope();
+  private:
+    QString sPhase;
+  };
+};
+
+#endif // STARTUPTRACE_H
@@ -0,0 +1,371 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "streamrecorder.h"
+#include "sessionclock.h"
+#include "logger.h"
+
+#include <QMutexLocker>
+#include <QDateTime>
+#include <string.h>
+
+
+static const qint64 chunkSize    = 1 << 20;
+static const size_t alignment    = 4096;
+static const int    nChunks      = 16;// 16 MiB: many seconds of disk stall
+static const qint64 recordsDelay = 500000000;// Telemetry is written at least this often
+static const int    maxRecords   = 65536;// bytes
+
+
+StreamRecorder::StreamRecorder()
+  : QObject()
+  , pFill(NULL)
+  , bRecording(false)
+  , sessionStart(0)
+  , segmentDuration(300000000000LL)// 5 min
+  , segmentStart(0)
+  , segmentOffset(0)
+  , iSegment(0)
+  , recordsTime(0)
+  , nBytes(0)
+  , nDropped(0)
+  , iOpenSegment(-1)
+  , segmentSize(0)
+{
+  for(int i=0; i<nChunks; i++) {
+    Chunk* pChunk = new Chunk;
+    pChunk->pData = static_cast<char*>(qMallocAligned(size_t(chunkSize), alignment));
+    freeChunks.append(pChunk);
+  }
+  writerThread.setObjectName("Recorder");
+  moveToThread(&writerThread);
+  writerThread.start();
+}
+
+
+StreamRecorder::~StreamRecorder() {
+  stop();
+  // Waits for the queued buffers to be written
+  QMetaObject::invokeMethod(this, "releaseResources", Qt::BlockingQueuedConnection);
+  writerThread.quit();
+  writerThread.wait();
+  while(!freeChunks.isEmpty()) {
+    Chunk* pChunk = freeChunks.takeFirst();
+    qFreeAligned(pChunk->pData);
+    delete pChunk;
+  }
+}
+
+
+void
+StreamRecorder::setSegmentDuration(qint64 ns) {
+  QMutexLocker locker(&mutex);
+  segmentDuration = ns;
+}
+
+
+bool
+StreamRecorder::start(const QString& sPathPrefix) {
+  QMutexLocker locker(&mutex);
+  if(bRecording) return false;
+  sPrefix       = sPathPrefix;
+  sessionStart  = SessionClock::now();
+  if(!writeManifest(sessionStart)) return false;
+  iSegment      = 0;
+  segmentOffset = 0;
+  segmentStart  = 0;
+  pendingRecords.clear();
+  nBytes        = 0;
+  nDropped      = 0;
+  bRecording    = true;
+  return true;
+}
+
+
+void
+StreamRecorder::stop() {
+  QMutexLocker locker(&mutex);
+  if(!bRecording) return;
+  endSegment(true);
+  bRecording = false;
+}
+
+
+bool
+StreamRecorder::isRecording() const {
+  QMutexLocker locker(&mutex);
+  return bRecording;
+}
+
+
+qint64
+StreamRecorder::bytesRecorded() const {
+  QMutexLocker locker(&mutex);
+  return nBytes;
+}
+
+
+qint64
+StreamRecorder::framesDropped() const {
+  QMutexLocker locker(&mutex);
+  return nDropped;
+}
+
+
+// With the mutex held: tiny, written once per session
+bool
+StreamRecorder::writeManifest(qint64 startTime) {
+  QFile manifest(sPrefix + ".session");
+  if(!manifest.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+    Logger::errorf("rec", "Unable to record to %s", qPrintable(manifest.fileName()));
+    return false;
+  }
+  manifest.write("# ROV dive session\n"
+                 "version 1\n");
+  manifest.write("started " + QDateTime::currentDateTime().toString(Qt::ISODate).toLatin1() + "\n");
+  manifest.write("clock_ns " + QByteArray::number(startTime) + "\n");
+  manifest.write("segment_s " + QByteArray::number(segmentDuration/1000000000) + "\n");
+  return true;
+}
+
+
+// With the mutex held. A free chunk for the current segment, NULL if
+// all the pool is waiting for the disk.
+StreamRecorder::Chunk*
+StreamRecorder::takeChunk() {
+  if(freeChunks.isEmpty()) return NULL;
+  Chunk* pChunk = freeChunks.takeFirst();
+  pChunk->used    = 0;
+  pChunk->sPrefix = sPrefix;
+  pChunk->segment = iSegment;
+  pChunk->bLast   = false;
+  pChunk->bEnd    = false;
+  pChunk->index.clear();
+  pChunk->records.clear();
+  return pChunk;
+}
+
+
+// With the mutex held. The chunk being filled with frames.
+StreamRecorder::Chunk*
+StreamRecorder::nextChunk() {
+  if(!pFill)
+    pFill = takeChunk();
+  return pFill;
+}
+
+
+// With the mutex held. The pending telemetry goes with the chunk.
+void
+StreamRecorder::queueChunk(Chunk* pChunk) {
+  pChunk->records.swap(pendingRecords);
+  pendingRecords.clear();
+  fullChunks.append(pChunk);
+  if(pChunk == pFill)
+    pFill = NULL;
+  QMetaObject::invokeMethod(this, "writePending", Qt::QueuedConnection);
+}
+
+
+// With the mutex held. The chunk being filled is queued even if empty,
+// to close the segment.
+void
+StreamRecorder::endSegment(bool bEndSession) {
+  Chunk* pChunk = nextChunk();
+  if(!pChunk) {
+    // All the pool is waiting for the disk: the segment ends with
+    // the last chunk queued
+    if(!fullChunks.isEmpty()) {
+      fullChunks.last()->bLast = true;
+      fullChunks.last()->bEnd  = fullChunks.last()->bEnd || bEndSession;
+    }
+    return;
+  }
+  pChunk->bLast = true;
+  pChunk->bEnd  = bEndSession;
+  queueChunk(pChunk);
+}
+
+
+// With the mutex held. Telemetry only, the chunk being filled with
+// frames is left alone.
+void
+StreamRecorder::flushRecords() {
+  Chunk* pChunk = takeChunk();
+  if(pChunk)
+    queueChunk(pChunk);
+}
+
+
+// Called by the video thread for every frame received
+void
+StreamRecorder::frameParsed(const unsigned char* pJpeg, size_t size, double timestamp) {
+  QMutexLocker locker(&mutex);
+  if(!bRecording || size == 0) return;
+  qint64 time = SessionClock::now() - sessionStart;
+  if(time-segmentStart >= segmentDuration && segmentOffset > 0) {
+    endSegment(false);
+    iSegment++;
+    segmentStart  = time;
+    segmentOffset = 0;
+  }
+  // All the space for the frame, or the frame is not recorded
+  qint64 used = pFill ? pFill->used : 0;
+  int nNeeded = int((used + qint64(size) - 1) / chunkSize) + (pFill ? 0 : 1);
+  if(freeChunks.size() < nNeeded) {
+    nDropped++;
+    return;
+  }
+  const char* pData = reinterpret_cast<const char*>(pJpeg);
+  qint64 left = qint64(size);
+  while(left > 0) {
+    Chunk* pChunk = nextChunk();
+    qint64 n = qMin(left, chunkSize - pChunk->used);
+    memcpy(pChunk->pData + pChunk->used, pData, size_t(n));
+    pChunk->used += n;
+    pData += n;
+    left  -= n;
+    if(left > 0)
+      queueChunk(pChunk);
+  }
+  // The index line goes with the end of the frame
+  Chunk* pChunk = nextChunk();
+  pChunk->index += QByteArray::number(time/1000) + ',' +
+                   QByteArray::number(segmentOffset) + ',' +
+                   QByteArray::number(qint64(size)) + ',' +
+                   QByteArray::number(timestamp, 'f', 6) + '\n';
+  if(pChunk->used == chunkSize)
+    queueChunk(pChunk);
+  segmentOffset += qint64(size);
+  nBytes        += qint64(size);
+}
+
+
+// The record is stamped now. Records are handed to the writer with
+// the next full chunk of video, or every recordsDelay without video.
+void
+StreamRecorder::addRecord(const QByteArray& record) {
+  QMutexLocker locker(&mutex);
+  if(!bRecording) return;
+  qint64 time = SessionClock::now() - sessionStart;
+  if(pendingRecords.isEmpty())
+    recordsTime = time;
+  pendingRecords += QByteArray::number(time/1000) + ',' + record + '\n';
+  if(time-recordsTime >= recordsDelay || pendingRecords.size() >= maxRecords)
+    flushRecords();
+}
+
+
+// Writer thread
+bool
+StreamRecorder::openSegment(const Chunk* pChunk) {
+  closeSegment();
+  QString sName = QString("%1_%2").arg(pChunk->sPrefix).arg(pChunk->segment, 3, 10, QChar('0'));
+  dataFile.setFileName(sName + ".mjpeg");
+  indexFile.setFileName(sName + ".idx");
+  // Unbuffered: the chunks go to write() as they are
+  if(!dataFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered) ||
+     !indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    Logger::errorf("rec", "Unable to record to %s", qPrintable(dataFile.fileName()));
+    dataFile.close();
+    return false;
+  }
+  indexFile.write("time_us,offset,size,timestamp\n");
+  indexFile.flush();
+  sOpenPrefix  = pChunk->sPrefix;
+  iOpenSegment = pChunk->segment;
+  segmentSize  = 0;
+  return true;
+}
+
+
+// Writer thread. The last chunk was padded to keep the writes
+// aligned: the padding goes away here.
+void
+StreamRecorder::closeSegment() {
+  if(iOpenSegment < 0) return;
+  dataFile.resize(segmentSize);
+  dataFile.close();
+  indexFile.close();
+  iOpenSegment = -1;
+}
+
+
+// Writer thread
+bool
+StreamRecorder::openRecords(const QString& sSessionPrefix) {
+  closeRecords();
+  recordsFile.setFileName(sSessionPrefix + ".tlm");
+  if(!recordsFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    Logger::errorf("rec", "Unable to record to %s", qPrintable(recordsFile.fileName()));
+    return false;
+  }
+  recordsFile.write("time_us,type,values\n");
+  return true;
+}
+
+
+void
+StreamRecorder::closeRecords() {
+  recordsFile.close();
+}
+
+
+// Writer thread: drains the queue
+void
+StreamRecorder::writePending() {
+  for(;;) {
+    Chunk* pChunk;
+    {
+      QMutexLocker locker(&mutex);
+      if(fullChunks.isEmpty()) return;
+      pChunk = fullChunks.takeFirst();
+    }
+    if(pChunk->used > 0) {
+      bool bOpen = (pChunk->segment == iOpenSegment && pChunk->sPrefix == sOpenPrefix) ||
+                   openSegment(pChunk);
+      if(bOpen) {
+        qint64 padded = (pChunk->used + qint64(alignment) - 1) & ~qint64(alignment-1);
+        memset(pChunk->pData + pChunk->used, 0, size_t(padded - pChunk->used));
+        if(!dataFile.seek(segmentSize) || dataFile.write(pChunk->pData, padded) != padded)
+          Logger::error("rec", dataFile.errorString());
+        segmentSize += pChunk->used;
+        // Only now the frames are in the file
+        indexFile.write(pChunk->index);
+        indexFile.flush();
+      }
+    }
+    if(!pChunk->records.isEmpty()) {
+      bool bOpen = (recordsFile.isOpen() && recordsFile.fileName() == pChunk->sPrefix + ".tlm") ||
+                   openRecords(pChunk->sPrefix);
+      if(bOpen) {
+        recordsFile.write(pChunk->records);
+        recordsFile.flush();
+      }
+    }
+    if(pChunk->bLast)
+      closeSegment();
+    if(pChunk->bEnd)
+      closeRecords();
+    QMutexLocker locker(&mutex);
+    freeChunks.append(pChunk);
+  }
+}
+
+
+void
+StreamRecorder::releaseResources() {
+  writePending();
+  closeSegment();
+  closeRecords();
+}
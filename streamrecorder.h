@@ -0,0 +1,106 @@
+#ifndef STREAMRECORDER_H
+#define STREAMRECORDER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+
+#include "mjpegparser.h"
+
+
+// Records a dive session: the camera stream as it is received and
+// the telemetry and pilot commands, all on the session clock.
+//
+// The JPEG frames are written unchanged, one after the other, in
+// segments of a few minutes ("<prefix>_000.mjpeg", "<prefix>_001.mjpeg"
+// ...), playable as raw MJPEG. Each segment has a CSV index
+// ("<prefix>_000.idx") with the time, offset and size of its frames.
+// Telemetry and commands are CSV records in "<prefix>.tlm", and
+// "<prefix>.session" tells when the session started. Times in the
+// files are in us since the start (see SessionReader).
+//
+// Frames are copied into 1 MiB buffers aligned to the page size and
+// only whole buffers are handed to a writer thread, so the file is
+// written with few large aligned writes and the receiving thread
+// never waits on the disk. The index only lists frames already
+// written: after a crash everything up to the last buffer (about a
+// second of video) can be read back. If the disk falls behind by the
+// whole pool, frames are dropped rather than queued.
+class StreamRecorder : public QObject, public MjpegFrameSink
+{
+  Q_OBJECT
+
+public:
+  StreamRecorder();
+  ~StreamRecorder();
+
+  void setSegmentDuration(qint64 ns);
+  bool start(const QString& sPathPrefix);
+  void stop();
+  bool isRecording() const;
+
+  void frameParsed(const unsigned char* pJpeg, size_t size, double timestamp);// Any thread
+  void addRecord(const QByteArray& record);// "type,values...", any thread
+
+  qint64 bytesRecorded() const;
+  qint64 framesDropped() const;
+
+private slots:
+  void writePending();
+  void releaseResources();
+
+private:
+  struct Chunk {
+    char*      pData;
+    qint64     used;
+    QByteArray index;  // Lines of the frames ending in this chunk
+    QByteArray records;// Telemetry lines
+    QString    sPrefix;
+    int        segment;
+    bool       bLast;  // Closes the segment
+    bool       bEnd;   // Closes the session
+  };
+
+  Chunk* takeChunk();
+  Chunk* nextChunk();
+  void   queueChunk(Chunk* pChunk);
+  void   endSegment(bool bEndSession);
+  void   flushRecords();
+  bool   writeManifest(qint64 startTime);
+  bool   openSegment(const Chunk* pChunk);
+  void   closeSegment();
+  bool   openRecords(const QString& sSessionPrefix);
+  void   closeRecords();
+
+  QThread writerThread;
+
+  mutable QMutex mutex;
+  QList<Chunk*> freeChunks;
+  QList<Chunk*> fullChunks;// Waiting for the writer
+  Chunk*  pFill;
+  bool    bRecording;
+  QString sPrefix;
+  qint64  sessionStart;// On the session clock
+  qint64  segmentDuration;
+  qint64  segmentStart;
+  qint64  segmentOffset;
+  int     iSegment;
+  QByteArray pendingRecords;
+  qint64  recordsTime;// Of the oldest pending record
+  qint64  nBytes;
+  qint64  nDropped;
+
+  // Only used by the writer thread
+  QFile   dataFile;
+  QFile   indexFile;
+  QFile   recordsFile;
+  QString sOpenPrefix; // Of the open segment
+  int     iOpenSegment;
+  qint64  segmentSize;
+};
+
+#endif // STREAMRECORDER_H
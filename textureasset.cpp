@@ -0,0 +1,121 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "textureasset.h"
+#include "rovtexture.h"
+
+#include <QOpenGLTexture>
+#include <QOpenGLContext>
+#include <QFile>
+#include <QDebug>
+
+
+static const quint32 maxTextureSize = 16384;// Keeps the level sizes far from overflowing
+
+
+bool
+TextureAsset::compressedFormatSupported() {
+  QOpenGLContext* pContext = QOpenGLContext::currentContext();
+  return pContext &&
+         (pContext->hasExtension("GL_EXT_texture_compression_s3tc") ||
+          pContext->hasExtension("GL_EXT_texture_compression_dxt1"));
+}
+
+
+// Number of levels of a full mipmap chain, down to 1x1
+static quint32
+maxLevels(quint32 width, quint32 height) {
+  quint32 size = qMax(width, height);
+  quint32 levels = 1;
+  while(size > 1) {
+    size >>= 1;
+    levels++;
+  }
+  return levels;
+}
+
+
+// Bytes the level must hold for glTexSubImage2D or
+// glCompressedTexSubImage2D not to read past it
+static qint64
+expectedLevelSize(const RovTextureHeader* pHeader, quint32 level) {
+  qint64 width  = qMax(quint32(1), pHeader->width  >> level);
+  qint64 height = qMax(quint32(1), pHeader->height >> level);
+  if(pHeader->format == rovTextureBC1)
+    return ((width+3)/4) * ((height+3)/4) * 8;
+  return width * height * 4;
+}
+
+
+// Returns NULL if the file is missing, malformed or uses a
+// compressed format the driver can't sample: the caller is
+// expected to fall back to the source image.
+QOpenGLTexture*
+TextureAsset::load(const QString& path) {
+  QFile file(path);
+  if(!file.open(QIODevice::ReadOnly))
+    return NULL;
+  qint64 fileSize = file.size();
+  if(fileSize < qint64(sizeof(RovTextureHeader)))
+    return NULL;
+  const uchar* pData = file.map(0, fileSize);
+  if(!pData)
+    return NULL;
+
+  const RovTextureHeader* pHeader = reinterpret_cast<const RovTextureHeader*>(pData);
+  const RovTextureLevel*  pLevels = reinterpret_cast<const RovTextureLevel*>(pData + sizeof(RovTextureHeader));
+  if(pHeader->magic   != rovTextureMagic   ||
+     pHeader->version != rovTextureVersion ||
+     (pHeader->format != rovTextureRGBA8 && pHeader->format != rovTextureBC1) ||
+     pHeader->width   == 0 || pHeader->width  > maxTextureSize ||
+     pHeader->height  == 0 || pHeader->height > maxTextureSize ||
+     pHeader->levels  == 0 || pHeader->levels > maxLevels(pHeader->width, pHeader->height) ||
+     qint64(sizeof(RovTextureHeader) + pHeader->levels*sizeof(RovTextureLevel)) > fileSize)
+  {
+    qDebug() << path << "is not a valid texture file";
+    return NULL;
+  }
+  for(quint32 i=0; i<pHeader->levels; i++) {
+    if(pLevels[i].width  != qMax(quint32(1), pHeader->width  >> i) ||
+       pLevels[i].height != qMax(quint32(1), pHeader->height >> i) ||
+       qint64(pLevels[i].size) != expectedLevelSize(pHeader, i))
+    {
+      qDebug() << path << "is not a valid texture file";
+      return NULL;
+    }
+    if(qint64(pLevels[i].offset) + qint64(pLevels[i].size) > fileSize) {
+      qDebug() << path << "is truncated";
+      return NULL;
+    }
+  }
+  bool bCompressed = (pHeader->format == rovTextureBC1);
+  if(bCompressed && !compressedFormatSupported()) {
+    qDebug() << "S3TC textures not supported by the driver";
+    return NULL;
+  }
+
+  QOpenGLTexture* pTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
+  pTexture->setFormat(bCompressed ? QOpenGLTexture::RGB_DXT1 : QOpenGLTexture::RGBA8_UNorm);
+  pTexture->setSize(pHeader->width, pHeader->height);
+  pTexture->setMipLevels(pHeader->levels);
+  pTexture->allocateStorage();
+  for(quint32 i=0; i<pHeader->levels; i++) {
+    const uchar* pLevelData = pData + pLevels[i].offset;
+    if(bCompressed)
+      pTexture->setCompressedData(i, pLevels[i].size, pLevelData);
+    else
+      pTexture->setData(i, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, pLevelData);
+  }
+  file.unmap(const_cast<uchar*>(pData));
+  return pTexture;
+}
@@ -0,0 +1,21 @@
+#ifndef TEXTUREASSET_H
+#define TEXTUREASSET_H
+
+#include <QString>
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLTexture)
+
+
+// Loads a texture baked by tools/texbake (see rovtexture.h).
+// The file is memory mapped and its precomputed mipmap levels are
+// uploaded one by one: no image decoding nor flipping at startup.
+class TextureAsset
+{
+public:
+  static QOpenGLTexture* load(const QString& path);
+
+private:
+  static bool compressedFormatSupported();
+};
+
+#endif // TEXTUREASSET_H
@@ -0,0 +1,175 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "threadedrenderer.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QOpenGLFramebufferObject>
+#include <QOffscreenSurface>
+#include <QGuiApplication>
+#include <QMutexLocker>
+#include <QDebug>
+
+
+// Must be created in the GUI thread with pShareContext
+// (the context of the compositing widget) already created
+ThreadedRenderer::ThreadedRenderer(QOpenGLContext* pShareContext, const AssetLoader* pAssetLoader)
+  : QObject()
+  , pContext(NULL)
+  , pSurface(NULL)
+  , pRenderer(NULL)
+  , pAssets(pAssetLoader)
+  , bRendererFailed(false)
+  , pMultisampleFbo(NULL)
+  , iDisplay(0)
+  , iReady(1)
+  , iRender(2)
+  , bNewFrame(false)
+  , bFramePending(false)
+{
+  pFbo[0] = pFbo[1] = pFbo[2] = NULL;
+
+  pContext = new QOpenGLContext();
+  pContext->setFormat(pShareContext->format());
+  pContext->setShareContext(pShareContext);
+  if(!pContext->create())
+    qDebug() << "Unable to create the rendering thread context";
+
+  // Offscreen surfaces have to be created in the GUI thread
+  pSurface = new QOffscreenSurface();
+  pSurface->setFormat(pContext->format());
+  pSurface->create();
+
+  renderThread.setObjectName("Render");
+  pContext->moveToThread(&renderThread);
+  moveToThread(&renderThread);
+  renderThread.start();
+}
+
+
+ThreadedRenderer::~ThreadedRenderer() {
+  stop();
+  delete pContext;
+  delete pSurface;
+}
+
+
+void
+ThreadedRenderer::stop() {
+  if(!renderThread.isRunning()) return;
+  // GL resources must be released by the thread owning the context
+  QMetaObject::invokeMethod(this, "releaseResources", Qt::BlockingQueuedConnection);
+  renderThread.quit();
+  renderThread.wait();
+}
+
+
+// Called from the GUI thread. Frames submitted while the previous
+// one is still rendering replace each other: only the last one counts.
+void
+ThreadedRenderer::submitFrame(const SceneFrame& frame, const QSize& size) {
+  QMutexLocker locker(&mutex);
+  pendingFrame = frame;
+  pendingSize  = size;
+  if(bFramePending) return;
+  bFramePending = true;
+  QMetaObject::invokeMethod(this, "renderPendingFrame", Qt::QueuedConnection);
+}
+
+
+// Called from the GUI thread: returns the texture holding the
+// latest completed frame (0 if nothing has been rendered yet).
+GLuint
+ThreadedRenderer::acquireDisplayTexture() {
+  QMutexLocker locker(&mutex);
+  if(bNewFrame) {
+    qSwap(iDisplay, iReady);
+    bNewFrame = false;
+  }
+  return pFbo[iDisplay] ? pFbo[iDisplay]->texture() : 0;
+}
+
+
+void
+ThreadedRenderer::ensureFbo(QOpenGLFramebufferObject** ppFbo, const QSize& size, int samples) {
+  if(*ppFbo && (*ppFbo)->size() == size) return;
+  delete *ppFbo;
+  QOpenGLFramebufferObjectFormat format;
+  format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+  format.setSamples(samples);
+  *ppFbo = new QOpenGLFramebufferObject(size, format);
+}
+
+
+void
+ThreadedRenderer::renderPendingFrame() {
+  SceneFrame frame;
+  QSize size;
+  int iTarget;
+  {
+    QMutexLocker locker(&mutex);
+    frame = pendingFrame;
+    size  = pendingSize;
+    bFramePending = false;
+    iTarget = iRender;
+  }
+  if(size.isEmpty() || bRendererFailed) return;
+
+  pContext->makeCurrent(pSurface);
+  if(!pRenderer) {
+    pRenderer = new SceneRenderer();
+    if(!pRenderer->initialize(pAssets)) {
+      qDebug() << "Unable to initialize the rendering thread";
+      delete pRenderer;
+      pRenderer = NULL;
+      bRendererFailed = true;
+      pContext->doneCurrent();
+      return;
+    }
+  }
+  ensureFbo(&pMultisampleFbo, size, pContext->format().samples());
+  ensureFbo(&pFbo[iTarget], size, 0);
+
+  pMultisampleFbo->bind();
+  pRenderer->resize(size.width(), size.height());
+  pRenderer->render(frame);
+  pMultisampleFbo->release();
+  QOpenGLFramebufferObject::blitFramebuffer(pFbo[iTarget], pMultisampleFbo);
+  // The frame must be complete before the GUI thread can sample it
+  pContext->functions()->glFinish();
+
+  {
+    QMutexLocker locker(&mutex);
+    qSwap(iRender, iReady);
+    bNewFrame = true;
+  }
+  emit frameReady();
+}
+
+
+void
+ThreadedRenderer::releaseResources() {
+  pContext->makeCurrent(pSurface);
+  delete pRenderer;
+  pRenderer = NULL;
+  delete pMultisampleFbo;
+  pMultisampleFbo = NULL;
+  for(int i=0; i<3; i++) {
+    delete pFbo[i];
+    pFbo[i] = NULL;
+  }
+  pContext->doneCurrent();
+  // Give the context back so that it can be deleted by the GUI thread
+  pContext->moveToThread(QGuiApplication::instance()->thread());
+}
@@ -0,0 +1,65 @@
+#ifndef THREADEDRENDERER_H
+#define THREADEDRENDERER_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QSize>
+#include <qopengl.h>
+
+#include "scenerenderer.h"
+
+QT_FORWARD_DECLARE_CLASS(QOpenGLContext)
+QT_FORWARD_DECLARE_CLASS(QOffscreenSurface)
+QT_FORWARD_DECLARE_CLASS(QOpenGLFramebufferObject)
+class AssetLoader;
+
+
+// Renders SceneFrames into framebuffer objects from a dedicated
+// thread with its own context, shared with the one of the widget
+// that will composite the results. Three color buffers rotate
+// between the roles of "being displayed", "latest complete frame"
+// and "being rendered", so neither side ever waits for the other.
+class ThreadedRenderer : public QObject
+{
+  Q_OBJECT
+
+public:
+  ThreadedRenderer(QOpenGLContext* pShareContext, const AssetLoader* pAssetLoader = NULL);
+  ~ThreadedRenderer();
+
+  void stop();
+  void submitFrame(const SceneFrame& frame, const QSize& size);
+  GLuint acquireDisplayTexture();
+
+signals:
+  void frameReady();
+
+private slots:
+  void renderPendingFrame();
+  void releaseResources();
+
+private:
+  void ensureFbo(QOpenGLFramebufferObject** ppFbo, const QSize& size, int samples);
+
+  QThread            renderThread;
+  QOpenGLContext*    pContext;
+  QOffscreenSurface* pSurface;
+  SceneRenderer*     pRenderer;
+  const AssetLoader* pAssets;
+  bool               bRendererFailed;
+
+  QOpenGLFramebufferObject* pMultisampleFbo;
+  QOpenGLFramebufferObject* pFbo[3];
+  int  iDisplay;
+  int  iReady;
+  int  iRender;
+  bool bNewFrame;
+
+  QMutex     mutex;
+  SceneFrame pendingFrame;
+  QSize      pendingSize;
+  bool       bFramePending;
+};
+
+#endif // THREADEDRENDERER_H
@@ -0,0 +1,281 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+// Synthetic MJPEG camera. Every frame gets the CLOCK_MONOTONIC time
+// at which it is generated drawn in as a LatencyPattern, so a client
+// on the same host can tell how long the frame took to be sent,
+// received, decoded and displayed. One client at a time, as the
+// real camera is used.
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <jpeglib.h>
+
+#include "latencypattern.h"
+
+
+static const char* boundary = "boundarydonotcross";
+
+
+struct Options
+{
+  Options()
+    : port(8080), width(640), height(480), fps(30), quality(80) {}
+
+  int port;
+  int width;
+  int height;
+  int fps;
+  int quality;
+};
+
+
+// A moving bar over a gradient, so that consecutive frames differ
+// and compress like a real scene more than a still picture does.
+// Pixels are interleaved YCbCr, as libjpeg takes them.
+static void
+drawScene(std::vector<unsigned char>& ycc, int width, int height, long long frame) {
+  int bar = int((frame*8) % width);
+  for(int y=0; y<height; y++) {
+    unsigned char* p = &ycc[size_t(y)*width*3];
+    for(int x=0; x<width; x++) {
+      bool bBar = x >= bar && x < bar+48;
+      p[3*x]   = (unsigned char)(bBar ? 200 : 40 + (x+y)*120/(width+height));
+      p[3*x+1] = (unsigned char)(bBar ? 90 : 128);
+      p[3*x+2] = (unsigned char)(bBar ? 170 : 128);
+    }
+  }
+}
+
+
+// The code goes in the luma, the chroma of its cells is neutral
+static void
+drawPattern(std::vector<unsigned char>& ycc, std::vector<unsigned char>& luma,
+            int width, unsigned long long value) {
+  int cell = LatencyPattern::cellSize(width);
+  int codeHeight = LatencyPattern::rows*cell;
+  int codeWidth  = LatencyPattern::columns*cell;
+  LatencyPattern::encode(value, &luma[0], width, codeHeight, width);
+  for(int y=0; y<codeHeight; y++) {
+    unsigned char* p = &ycc[size_t(y)*width*3];
+    for(int x=0; x<codeWidth; x++) {
+      p[3*x]   = luma[size_t(y)*width+x];
+      p[3*x+1] = 128;
+      p[3*x+2] = 128;
+    }
+  }
+}
+
+
+static void
+compress(jpeg_compress_struct& cinfo, std::vector<unsigned char>& ycc,
+         int width, int height, int quality,
+         unsigned char** ppJpeg, unsigned long* pSize) {
+  // After a compression *pSize is the bytes used, not the capacity:
+  // libjpeg would replace a buffer it finds too small without
+  // freeing it. A fresh one per frame.
+  free(*ppJpeg);
+  *ppJpeg = NULL;
+  *pSize  = 0;
+  jpeg_mem_dest(&cinfo, ppJpeg, pSize);
+  cinfo.image_width      = width;
+  cinfo.image_height     = height;
+  cinfo.input_components = 3;
+  cinfo.in_color_space   = JCS_YCbCr;// Written as is: 4:2:0 YCbCr
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  cinfo.dct_method = JDCT_IFAST;
+  jpeg_start_compress(&cinfo, TRUE);
+  while(cinfo.next_scanline < cinfo.image_height) {
+    JSAMPROW row = &ycc[size_t(cinfo.next_scanline)*width*3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+}
+
+
+static bool
+sendAll(int fd, const char* pData, size_t size) {
+  while(size > 0) {
+    ssize_t n = send(fd, pData, size, MSG_NOSIGNAL);
+    if(n <= 0)
+      return false;
+    pData += n;
+    size  -= size_t(n);
+  }
+  return true;
+}
+
+
+// Waits for the end of the request header, whatever it asks for
+static bool
+readRequest(int fd) {
+  std::string request;
+  char buffer[1024];
+  while(request.find("\r\n\r\n") == std::string::npos) {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if(n <= 0 || request.size() > 16384)
+      return false;
+    request.append(buffer, size_t(n));
+  }
+  return true;
+}
+
+
+static void
+serve(int fd, const Options& options) {
+  std::string header = "HTTP/1.0 200 OK\r\n"
+                       "Connection: close\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Content-Type: multipart/x-mixed-replace;boundary=";
+  header += boundary;
+  header += "\r\n\r\n--";
+  header += boundary;
+  header += "\r\n";
+  if(!sendAll(fd, header.data(), header.size()))
+    return;
+
+  jpeg_compress_struct cinfo;
+  jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+
+  std::vector<unsigned char> ycc(size_t(options.width)*options.height*3);
+  std::vector<unsigned char> luma(size_t(options.width)*options.height);
+  unsigned char* pJpeg = NULL;
+  unsigned long  jpegSize = 0;
+
+  std::chrono::nanoseconds period(1000000000LL/options.fps);
+  std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+  long long frame    = 0;
+  long long encodeNs = 0;
+  long long bytes    = 0;
+  for(;;) {
+    std::this_thread::sleep_until(next);
+    next += period;
+
+    // "Capture": the time the frame exists, before its compression
+    long long captured = LatencyPattern::now();
+    drawScene(ycc, options.width, options.height, frame);
+    drawPattern(ycc, luma, options.width, (unsigned long long)captured);
+    compress(cinfo, ycc, options.width, options.height, options.quality, &pJpeg, &jpegSize);
+    encodeNs += LatencyPattern::now() - captured;
+
+    char part[160];
+    snprintf(part, sizeof(part),
+             "Content-Type: image/jpeg\r\n"
+             "Content-Length: %lu\r\n"
+             "X-Timestamp: %lld.%06lld\r\n\r\n",
+             jpegSize, captured/1000000000LL, (captured/1000)%1000000LL);
+    std::string trailer = std::string("\r\n--") + boundary + "\r\n";
+    if(!sendAll(fd, part, strlen(part)) ||
+       !sendAll(fd, reinterpret_cast<const char*>(pJpeg), jpegSize) ||
+       !sendAll(fd, trailer.data(), trailer.size()))
+      break;
+    bytes += (long long)jpegSize;
+    frame++;
+
+    if(frame % (5*options.fps) == 0) {
+      printf("%lld frames, encode %.2f ms, %.1f kB per frame\n",
+             frame, encodeNs/1e6/frame, bytes/1024.0/frame);
+      fflush(stdout);
+    }
+    // A late sender does not try to catch up, like a camera
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(next < now)
+      next = now;
+  }
+  free(pJpeg);
+  jpeg_destroy_compress(&cinfo);
+  printf("Client gone after %lld frames\n", frame);
+}
+
+
+static bool
+parseArguments(int argc, char* argv[], Options& options) {
+  for(int i=1; i<argc; i++) {
+    if(i+1 >= argc)
+      return false;
+    const char* pValue = argv[++i];
+    if(strcmp(argv[i-1], "--port") == 0)
+      options.port = atoi(pValue);
+    else if(strcmp(argv[i-1], "--fps") == 0)
+      options.fps = atoi(pValue);
+    else if(strcmp(argv[i-1], "--quality") == 0)
+      options.quality = atoi(pValue);
+    else if(strcmp(argv[i-1], "--size") == 0) {
+      if(sscanf(pValue, "%dx%d", &options.width, &options.height) != 2)
+        return false;
+    }
+    else
+      return false;
+  }
+  // Even sizes for the 4:2:0 chroma, and room for the code
+  return options.port > 0 && options.fps > 0 && options.fps <= 1000 &&
+         options.quality > 0 && options.quality <= 100 &&
+         options.width % 16 == 0 && options.height % 16 == 0 &&
+         LatencyPattern::cellSize(options.width) > 0 &&
+         options.height >= LatencyPattern::rows*LatencyPattern::cellSize(options.width);
+}
+
+
+int
+main(int argc, char* argv[]) {
+  Options options;
+  if(!parseArguments(argc, argv, options)) {
+    fprintf(stderr, "Usage: %s [--port 8080] [--size 640x480] [--fps 30] [--quality 80]\n"
+                    "(sizes multiple of 16, at least 320 wide)\n", argv[0]);
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  int server = socket(AF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family      = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port        = htons((unsigned short)options.port);
+  if(server < 0 ||
+     bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+     listen(server, 1) != 0) {
+    perror("mjpegsource");
+    return 1;
+  }
+  printf("Serving %dx%d at %d fps on port %d\n",
+         options.width, options.height, options.fps, options.port);
+  fflush(stdout);
+
+  for(;;) {
+    int client = accept(server, NULL, NULL);
+    if(client < 0)
+      continue;
+    // Frames go out as soon as they are written
+    setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    if(readRequest(client))
+      serve(client, options);
+    close(client);
+  }
+  return 0;
+}
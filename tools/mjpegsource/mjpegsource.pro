@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Stand-in camera for latency measurements: serves
+# an mjpg-streamer like "?action=stream" feed of
+# generated frames, each carrying the time it was
+# generated (see latencypattern.h).
+#
+#   mjpegsource [--port 8080] [--size 640x480] [--fps 30] [--quality 80]
+#
+# then run JoyTest with
+#   --latency-probe http://127.0.0.1:8080/?action=stream
+#
+# Plain C++ (POSIX sockets, libjpeg).
+#
+#-------------------------------------------------
+
+TARGET = mjpegsource
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= qt app_bundle
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp \
+    $$ROOT/latencypattern.cpp
+
+HEADERS  += \
+    $$ROOT/latencypattern.h
+
+LIBS += -ljpeg
@@ -0,0 +1,229 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include <QGuiApplication>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QImage>
+#include <QFile>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "rovtexture.h"
+
+
+struct Level
+{
+  int width;
+  int height;
+  QByteArray rgba;// width*height*4 bytes
+};
+
+
+// Next mipmap level with a 2x2 box filter (edges are clamped
+// so that odd sizes are handled too)
+static Level
+downsample(const Level& src) {
+  Level dst;
+  dst.width  = qMax(1, src.width/2);
+  dst.height = qMax(1, src.height/2);
+  dst.rgba.resize(dst.width*dst.height*4);
+  const uchar* s = reinterpret_cast<const uchar*>(src.rgba.constData());
+  uchar* d = reinterpret_cast<uchar*>(dst.rgba.data());
+  for(int y=0; y<dst.height; y++) {
+    int y0 = qMin(2*y,   src.height-1);
+    int y1 = qMin(2*y+1, src.height-1);
+    for(int x=0; x<dst.width; x++) {
+      int x0 = qMin(2*x,   src.width-1);
+      int x1 = qMin(2*x+1, src.width-1);
+      for(int c=0; c<4; c++) {
+        int sum = s[(y0*src.width+x0)*4+c] + s[(y0*src.width+x1)*4+c] +
+                  s[(y1*src.width+x0)*4+c] + s[(y1*src.width+x1)*4+c];
+        d[(y*dst.width+x)*4+c] = uchar((sum+2)/4);
+      }
+    }
+  }
+  return dst;
+}
+
+
+static quint16
+toRGB565(const int* rgb) {
+  return quint16(((rgb[0]*31+127)/255) << 11 |
+                 ((rgb[1]*63+127)/255) <<  5 |
+                 ((rgb[2]*31+127)/255));
+}
+
+
+static void
+fromRGB565(quint16 c, int* rgb) {
+  rgb[0] = ((c >> 11) & 31) * 255 / 31;
+  rgb[1] = ((c >>  5) & 63) * 255 / 63;
+  rgb[2] = ( c        & 31) * 255 / 31;
+}
+
+
+// Encode one opaque 4x4 block. The endpoints are the extremes
+// of the block colors along the axis of their bounding box.
+static void
+encodeBC1Block(const uchar block[16][4], uchar* out) {
+  int minColor[3] = { 255, 255, 255 };
+  int maxColor[3] = {   0,   0,   0 };
+  for(int i=0; i<16; i++)
+    for(int c=0; c<3; c++) {
+      minColor[c] = qMin(minColor[c], int(block[i][c]));
+      maxColor[c] = qMax(maxColor[c], int(block[i][c]));
+    }
+  quint16 c0 = toRGB565(maxColor);
+  quint16 c1 = toRGB565(minColor);
+  if(c0 < c1) qSwap(c0, c1);
+
+  int palette[4][3];
+  fromRGB565(c0, palette[0]);
+  fromRGB565(c1, palette[1]);
+  for(int c=0; c<3; c++) {
+    if(c0 > c1) {// Four colors mode
+      palette[2][c] = (2*palette[0][c] +   palette[1][c]) / 3;
+      palette[3][c] = (  palette[0][c] + 2*palette[1][c]) / 3;
+    } else {// Uniform block: c0 == c1
+      palette[2][c] = palette[0][c];
+      palette[3][c] = palette[0][c];
+    }
+  }
+
+  quint32 indices = 0;
+  for(int i=0; i<16; i++) {
+    int best = 0;
+    int bestDistance = INT_MAX;
+    for(int p=0; p<4; p++) {
+      int distance = 0;
+      for(int c=0; c<3; c++) {
+        int delta = int(block[i][c]) - palette[p][c];
+        distance += delta*delta;
+      }
+      if(distance < bestDistance) {
+        bestDistance = distance;
+        best = p;
+      }
+    }
+    indices |= quint32(best) << (2*i);
+  }
+  out[0] = uchar(c0 & 0xff);  out[1] = uchar(c0 >> 8);
+  out[2] = uchar(c1 & 0xff);  out[3] = uchar(c1 >> 8);
+  out[4] = uchar(indices);       out[5] = uchar(indices >> 8);
+  out[6] = uchar(indices >> 16); out[7] = uchar(indices >> 24);
+}
+
+
+static QByteArray
+encodeBC1(const Level& level) {
+  int bw = (level.width +3)/4;
+  int bh = (level.height+3)/4;
+  QByteArray out(bw*bh*8, 0);
+  const uchar* s = reinterpret_cast<const uchar*>(level.rgba.constData());
+  uchar block[16][4];
+  for(int by=0; by<bh; by++) {
+    for(int bx=0; bx<bw; bx++) {
+      for(int i=0; i<16; i++) {
+        int x = qMin(bx*4 + i%4, level.width-1);
+        int y = qMin(by*4 + i/4, level.height-1);
+        memcpy(block[i], s + (y*level.width+x)*4, 4);
+      }
+      encodeBC1Block(block, reinterpret_cast<uchar*>(out.data()) + (by*bw+bx)*8);
+    }
+  }
+  return out;
+}
+
+
+static quint32
+alignTo16(quint32 value) {
+  return (value + 15) & ~quint32(15);
+}
+
+
+int
+main(int argc, char *argv[]) {
+  QGuiApplication app(argc, argv);
+
+  QStringList args = app.arguments();
+  args.removeFirst();
+  bool bBC1 = args.removeAll("--bc1") > 0;
+  if(args.count() != 2) {
+    fprintf(stderr, "usage: texbake [--bc1] <input image> <output.rtex>\n");
+    return 1;
+  }
+
+  QImage image(args.at(0));
+  if(image.isNull()) {
+    fprintf(stderr, "Unable to read %s\n", qPrintable(args.at(0)));
+    return 1;
+  }
+  // Same orientation the application used to obtain with mirrored()
+  image = image.convertToFormat(QImage::Format_RGBA8888).mirrored();
+
+  QVector<Level> levels;
+  Level level;
+  level.width  = image.width();
+  level.height = image.height();
+  level.rgba.resize(level.width*level.height*4);
+  for(int y=0; y<level.height; y++)
+    memcpy(level.rgba.data() + y*level.width*4, image.constScanLine(y), level.width*4);
+  levels.append(level);
+  while(level.width > 1 || level.height > 1) {
+    level = downsample(level);
+    levels.append(level);
+  }
+
+  QVector<QByteArray> data;
+  for(int i=0; i<levels.count(); i++)
+    data.append(bBC1 ? encodeBC1(levels.at(i)) : levels.at(i).rgba);
+
+  RovTextureHeader header;
+  header.magic   = rovTextureMagic;
+  header.version = rovTextureVersion;
+  header.format  = bBC1 ? rovTextureBC1 : rovTextureRGBA8;
+  header.width   = levels.first().width;
+  header.height  = levels.first().height;
+  header.levels  = levels.count();
+
+  QVector<RovTextureLevel> table(levels.count());
+  quint32 offset = alignTo16(sizeof(RovTextureHeader) + table.count()*sizeof(RovTextureLevel));
+  for(int i=0; i<table.count(); i++) {
+    table[i].offset = offset;
+    table[i].size   = data.at(i).size();
+    table[i].width  = levels.at(i).width;
+    table[i].height = levels.at(i).height;
+    offset = alignTo16(offset + table[i].size);
+  }
+
+  QFile file(args.at(1));
+  if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    fprintf(stderr, "Unable to write %s\n", qPrintable(args.at(1)));
+    return 1;
+  }
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(table.constData()), table.count()*sizeof(RovTextureLevel));
+  for(int i=0; i<data.count(); i++) {
+    file.write(QByteArray(table[i].offset - file.pos(), 0));
+    file.write(data.at(i));
+  }
+  file.close();
+
+  printf("%s: %ux%u, %u levels, %s, %lld bytes\n",
+         qPrintable(args.at(1)), header.width, header.height, header.levels,
+         bBC1 ? "DXT1" : "RGBA8", (long long)file.size());
+  return 0;
+}
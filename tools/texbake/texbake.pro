@@ -0,0 +1,26 @@
+#-------------------------------------------------
+#
+# Offline baker of the ROV textures: converts an
+# image into a ".rtex" file with a pre-flipped
+# mipmap chain, optionally S3TC (DXT1) compressed.
+#
+#   texbake [--bc1] uvUnwrapROV_2.png uvUnwrapROV_2.rtex
+#
+# Copy the result next to the JoyTest executable.
+#
+#-------------------------------------------------
+
+TARGET = texbake
+TEMPLATE = app
+CONFIG 	   += c++11 console
+CONFIG     -= app_bundle
+
+QT       += core
+QT       += gui
+
+ROOT = ../..
+INCLUDEPATH += $$ROOT
+
+SOURCES += main.cpp
+
+HEADERS  += $$ROOT/rovtexture.h
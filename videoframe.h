@@ -0,0 +1,39 @@
+#ifndef VIDEOFRAME_H
+#define VIDEOFRAME_H
+
+#include <QByteArray>
+
+
+// A decoded video frame: the planes of the JPEG as they come out of
+// the decoder, full range YCbCr, no color conversion on the CPU.
+// A frame of zero width means "no video".
+struct VideoFrame
+{
+  VideoFrame()
+    : width(0), height(0), chromaWidth(0), chromaHeight(0)
+    , sequence(-1), receivedTime(0), decodedTime(0), presentationTime(0)
+    , captureTime(-1.0) {}
+
+  int        width;       // Of the luma plane
+  int        height;
+  int        chromaWidth; // Of each of the two chroma planes
+  int        chromaHeight;
+  QByteArray planes;      // Y, then Cb, then Cr, rows tightly packed
+  qint64     sequence;
+  qint64     receivedTime;// ns on the session clock, last byte in
+  qint64     decodedTime;
+  qint64     presentationTime;// When to show it, on the session clock
+  double     captureTime; // Timestamp given by the camera in s, -1 if none
+};
+
+
+// Where the renderer takes the video from, in whatever thread
+// it runs: implementations must be thread safe.
+class VideoSource
+{
+public:
+  virtual ~VideoSource() {}
+  virtual bool takeFrame(VideoFrame& frame) = 0;// Newest frame, if any since the last call
+};
+
+#endif // VIDEOFRAME_H
@@ -0,0 +1,228 @@
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>
+
+#include "videotexture.h"
+
+#include <QOpenGLContext>
+#include <string.h>
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT   0x0080
+#endif
+
+
+static const GLbitfield persistentFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+
+VideoTexture::VideoTexture()
+  : bufferStorage(NULL)
+  , iPbo(0)
+  , lumaWidth(0)
+  , lumaHeight(0)
+  , chromaWidth(0)
+  , chromaHeight(0)
+  , bInitialized(false)
+{
+  for(int i=0; i<nBuffers; i++) {
+    pbo[i]     = 0;
+    pboSize[i] = 0;
+    pMapped[i] = NULL;
+    fences[i]  = 0;
+  }
+  textures[0] = textures[1] = textures[2] = 0;
+}
+
+
+VideoTexture::~VideoTexture() {
+}
+
+
+void
+VideoTexture::initialize() {
+  if(bInitialized) return;
+  initializeOpenGLFunctions();
+  QOpenGLContext* pContext = QOpenGLContext::currentContext();
+  if(pContext->hasExtension("GL_ARB_buffer_storage"))
+    bufferStorage = reinterpret_cast<BufferStorageFunc>(pContext->getProcAddress("glBufferStorage"));
+  glGenTextures(3, textures);
+  for(int i=0; i<3; i++) {
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  bInitialized = true;
+}
+
+
+// Needs the context current
+void
+VideoTexture::destroy() {
+  if(!bInitialized) return;
+  for(int i=0; i<nBuffers; i++)
+    releaseBuffer(i);
+  glDeleteTextures(3, textures);
+  textures[0] = textures[1] = textures[2] = 0;
+  lumaWidth = lumaHeight = chromaWidth = chromaHeight = 0;
+  bInitialized = false;
+}
+
+
+bool
+VideoTexture::isValid() const {
+  return lumaWidth > 0;
+}
+
+
+bool
+VideoTexture::isPersistent() const {
+  return bufferStorage != NULL;
+}
+
+
+int
+VideoTexture::width() const {
+  return lumaWidth;
+}
+
+
+int
+VideoTexture::height() const {
+  return lumaHeight;
+}
+
+
+// Storage is (re)defined only when the stream changes size
+void
+VideoTexture::allocate(const VideoFrame& frame) {
+  int widths[3]  = { frame.width,  frame.chromaWidth,  frame.chromaWidth  };
+  int heights[3] = { frame.height, frame.chromaHeight, frame.chromaHeight };
+  for(int i=0; i<3; i++) {
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, widths[i], heights[i], 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+  }
+  lumaWidth    = frame.width;
+  lumaHeight   = frame.height;
+  chromaWidth  = frame.chromaWidth;
+  chromaHeight = frame.chromaHeight;
+}
+
+
+void
+VideoTexture::releaseBuffer(int i) {
+  if(fences[i]) {
+    glDeleteSync(fences[i]);
+    fences[i] = 0;
+  }
+  if(pMapped[i]) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    pMapped[i] = NULL;
+  }
+  if(pbo[i])
+    glDeleteBuffers(1, &pbo[i]);
+  pbo[i]     = 0;
+  pboSize[i] = 0;
+}
+
+
+// Leaves buffer i bound. Immutable storage can't be resized: a new
+// buffer is made when the frame size changes.
+bool
+VideoTexture::ensureBuffer(int i, int size) {
+  if(pbo[i] && pboSize[i] == size) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+    return true;
+  }
+  releaseBuffer(i);
+  glGenBuffers(1, &pbo[i]);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo[i]);
+  if(bufferStorage) {
+    bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, NULL, persistentFlags);
+    pMapped[i] = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, persistentFlags);
+    if(!pMapped[i]) return false;
+  }
+  else
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+  pboSize[i] = size;
+  return true;
+}
+
+
+void
+VideoTexture::upload(const VideoFrame& frame) {
+  if(!bInitialized) return;
+  if(frame.width <= 0 || frame.planes.isEmpty()) {
+    lumaWidth = lumaHeight = chromaWidth = chromaHeight = 0;
+    return;
+  }
+  if(frame.width != lumaWidth || frame.height != lumaHeight ||
+     frame.chromaWidth != chromaWidth || frame.chromaHeight != chromaHeight)
+    allocate(frame);
+
+  int size = frame.planes.size();
+  if(fences[iPbo]) {
+    // Signaled long ago unless the GPU is three frames behind
+    glClientWaitSync(fences[iPbo], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(100000000));
+    glDeleteSync(fences[iPbo]);
+    fences[iPbo] = 0;
+  }
+  if(!ensureBuffer(iPbo, size)) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+  if(pMapped[iPbo])
+    memcpy(pMapped[iPbo], frame.planes.constData(), size_t(size));
+  else {
+    void* pBuffer = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if(!pBuffer) {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      return;
+    }
+    memcpy(pBuffer, frame.planes.constData(), size_t(size));
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+
+  const char* pOffset = NULL;// Offsets into the bound buffer
+  int widths[3]  = { lumaWidth,  chromaWidth,  chromaWidth  };
+  int heights[3] = { lumaHeight, chromaHeight, chromaHeight };
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for(int i=0; i<3; i++) {
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, widths[i], heights[i], GL_RED, GL_UNSIGNED_BYTE, pOffset);
+    pOffset += widths[i] * heights[i];
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if(pMapped[iPbo])
+    fences[iPbo] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  iPbo = (iPbo + 1) % nBuffers;
+}
+
+
+void
+VideoTexture::bind(int firstUnit) {
+  for(int i=0; i<3; i++) {
+    glActiveTexture(GLenum(GL_TEXTURE0 + firstUnit + i));
+    glBindTexture(GL_TEXTURE_2D, textures[i]);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
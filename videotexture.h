@@ -0,0 +1,59 @@
+#ifndef VIDEOTEXTURE_H
+#define VIDEOTEXTURE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include "videoframe.h"
+
+
+// Video frames on the GPU: one GL_R8 texture per YCbCr plane, fed
+// through a ring of pixel buffer objects.
+//
+// With GL_ARB_buffer_storage the buffers are mapped once, persistent
+// and coherent: a frame costs one memcpy into the mapped memory and
+// the texture updates from it, with no map/unmap and no driver side
+// staging. A fence per buffer keeps a frame from being overwritten
+// while the GPU still reads it; with three buffers it never waits in
+// practice. Without the extension every upload maps the buffer with
+// GL_MAP_INVALIDATE_BUFFER_BIT instead.
+// To be used from the thread of the current OpenGL 3.3 core context.
+class VideoTexture : protected QOpenGLFunctions_3_3_Core
+{
+public:
+  VideoTexture();
+  ~VideoTexture();
+
+  void initialize();
+  void destroy();
+  void upload(const VideoFrame& frame);// An empty frame clears the video
+  bool isValid() const;// Is there a frame to show?
+  bool isPersistent() const;
+  void bind(int firstUnit);// Y, Cb and Cr on three consecutive units
+
+  int width() const;
+  int height() const;
+
+private:
+  void allocate(const VideoFrame& frame);
+  bool ensureBuffer(int i, int size);
+  void releaseBuffer(int i);
+
+  typedef void (QOPENGLF_APIENTRYP BufferStorageFunc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+  enum { nBuffers = 3 };
+
+  BufferStorageFunc bufferStorage;// Null without GL_ARB_buffer_storage
+  GLuint pbo[nBuffers];
+  int    pboSize[nBuffers];
+  void*  pMapped[nBuffers];
+  GLsync fences[nBuffers];
+  int    iPbo;
+  GLuint textures[3];
+  int    lumaWidth;
+  int    lumaHeight;
+  int    chromaWidth;
+  int    chromaHeight;
+  bool   bInitialized;
+};
+
+#endif // VIDEOTEXTURE_H
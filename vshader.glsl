@@ -1,6 +1,8 @@
-attribute vec3 qt_Vertex;
-attribute vec3 vertexNormal_modelspace;
-attribute vec2 qt_MultiTexCoord0;
+#version 330 core
+
+layout(location = 0) in vec3 qt_Vertex;
+layout(location = 1) in vec3 vertexNormal_modelspace;
+layout(location = 2) in vec2 qt_MultiTexCoord0;
 
 // Values that stay constant for the whole mesh.
 uniform mat4 mvp_Matrix;
@@ -10,11 +12,11 @@ uniform mat4 normal_Matrix;
 uniform vec4 LightPosition_worldspace;
 
 //// Output data ; will be interpolated for each fragment.
-varying vec4 Position_worldspace;
-varying vec4 Normal_cameraspace;
-varying vec4 EyeDirection_cameraspace;
-varying vec4 LightDirection_cameraspace;
-varying vec2 qt_TexCoord0;
+out vec4 Position_worldspace;
+out vec4 Normal_cameraspace;
+out vec4 EyeDirection_cameraspace;
+out vec4 LightDirection_cameraspace;
+out vec2 qt_TexCoord0;
 
 void
 main(void) {
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Full screen triangle generated from gl_VertexID:
+// no vertex buffer is needed.
+out vec2 texCoord;
+
+void
+main(void) {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    texCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,44 @@
+#version 330 core
+
+layout(location = 0) in vec3 qt_Vertex;
+layout(location = 1) in vec3 vertexNormal_modelspace;
+layout(location = 2) in vec2 qt_MultiTexCoord0;
+
+// Values that change once per drawn instance.
+layout(location = 3) in mat4 instance_modelMatrix;
+layout(location = 7) in mat4 instance_normalMatrix;
+
+// Values that stay constant for the whole draw call.
+uniform mat4 vp_Matrix;
+uniform mat4 view_Matrix;
+uniform vec4 LightPosition_worldspace;
+
+//// Output data ; will be interpolated for each fragment.
+out vec4 Position_worldspace;
+out vec4 Normal_cameraspace;
+out vec4 EyeDirection_cameraspace;
+out vec4 LightDirection_cameraspace;
+out vec2 qt_TexCoord0;
+
+void
+main(void) {
+    // Position of the vertex, in worldspace : model_Matrix * position
+    Position_worldspace = instance_modelMatrix * vec4(qt_Vertex, 1.0);
+
+    // Calculate vertex position in screen space
+    gl_Position = vp_Matrix * Position_worldspace;
+
+    // Vector that goes from the vertex to the camera, in camera space.
+    // In camera space, the camera is at the origin (0,0,0).
+    EyeDirection_cameraspace = vec4(0, 0, 0, 1) - vec4(qt_Vertex, 1.0);
+
+    // Vector that goes from the vertex to the light, in camera space.
+    vec4 LightPosition_cameraspace = view_Matrix * LightPosition_worldspace;
+    LightDirection_cameraspace = LightPosition_cameraspace + EyeDirection_cameraspace;
+
+    // Normal of the the vertex, in camera space
+    Normal_cameraspace = view_Matrix * instance_normalMatrix * vec4(vertexNormal_modelspace, 1.0);
+
+    // Pass texture coordinate to fragment shader
+    qt_TexCoord0 = qt_MultiTexCoord0;
+}